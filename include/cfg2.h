@@ -30,13 +30,18 @@ extern "C" {
 #define CFG_TRUE 1
 #define CFG_FALSE 0
 #define CFG_CACHE_SIZE 32
+#define CFG_THREADS_MAX 64
+#define CFG_OVERLAY_MAX 16
 #define CFG_SEPARATOR_SECTION 0x01
 #define CFG_SEPARATOR_KEY_VALUE 0x02
+#define CFG_SEPARATOR_RAW 0x03
 #define CFG_COMMENT_CHAR1 ';'
 #define CFG_COMMENT_CHAR2 '#'
 #define CFG_HASH_SEED 0x811c9dc5
 #define CFG_ROOT_SECTION NULL
 #define CFG_ROOT_SECTION_HASH CFG_HASH_SEED
+#define CFG_ASYNC_THREAD 0x01
+#define CFG_ASYNC_BLOCK 0x02
 
 /* if you want to link statically on win32, define CFG_LIB_STATIC before
  * including this header. */
@@ -89,7 +94,9 @@ typedef enum {
 	/* 5  */ CFG_ERROR_FILE,
 	/* 6  */ CFG_ERROR_NOT_FOUND,
 	/* 7  */ CFG_ERROR_OUT_OF_RANGE,
-	/* 8  */ CFG_ERROR_CACHE_SIZE
+	/* 8  */ CFG_ERROR_CACHE_SIZE,
+	/* 9  */ CFG_ERROR_CONFLICT,
+	/* 10 */ CFG_ERROR_BUSY
 } cfg_status_t;
 
 /* -----------------------------------------------------------------------------
@@ -105,6 +112,123 @@ typedef struct _cfg_section_t cfg_section_t;
 /* the library's data entry */
 typedef struct _cfg_entry_t cfg_entry_t;
 
+/* a stack of library objects looked up from the top; see cfg_overlay_alloc() */
+typedef struct _cfg_overlay_t cfg_overlay_t;
+
+/* a parse running in the background; see cfg_parse_async() */
+typedef struct _cfg_parse_t cfg_parse_t;
+
+/* memory callbacks for cfg_alloc_ex(); 'ctx' is passed to every callback.
+ * all memory owned by a cfg_t object goes through them. buffers returned to
+ * the caller (cfg_buffer_write(), utilities) are always allocated with malloc().
+ * the callbacks must be thread-safe if the object is used from multiple
+ * threads. */
+typedef struct {
+	void *(*malloc_fn)(void *ctx, size_t size);
+	void *(*realloc_fn)(void *ctx, void *ptr, size_t size);
+	void (*free_fn)(void *ctx, void *ptr);
+	void *ctx;
+} cfg_allocator_t;
+
+/* a pre-hashed section / key pair; see cfg_key_make(). the fields are public
+ * so that the hashes can also be computed at compile time (see cfg2.hpp). */
+typedef struct {
+	cfg_uint32 section_hash;
+	cfg_uint32 key_hash;
+} cfg_key_t;
+
+/* callback for cfg_buffer_scan(), called for each entry in order; 'section'
+ * is CFG_ROOT_SECTION for the root section and the hashes are the same as
+ * from cfg_hash_get(). the strings are only valid during the call. return
+ * CFG_FALSE to stop the scan. */
+typedef cfg_bool (*cfg_scan_cb_t)(void *ctx, const cfg_char *section, cfg_uint32 section_hash,
+	const cfg_char *key, cfg_uint32 key_hash, const cfg_char *value);
+
+/* callback for cfg_entries_prefix() and cfg_entries_range(), called for each
+ * matching entry in key order; return CFG_FALSE to stop. */
+typedef cfg_bool (*cfg_entry_cb_t)(void *ctx, cfg_entry_t *entry);
+
+/* what the parser does with a key repeated in a section; see
+ * cfg_duplicates_set() */
+typedef enum {
+	CFG_DUPLICATES_KEEP, /* store every entry (default) */
+	CFG_DUPLICATES_FIRST, /* store only the first entry */
+	CFG_DUPLICATES_LAST /* store the first entry with the value of the last one */
+} cfg_duplicates_t;
+
+/* what cfg_merge() does with a key which is in both objects */
+typedef enum {
+	CFG_MERGE_OVERRIDE, /* take the value from the source */
+	CFG_MERGE_KEEP, /* keep the value in the destination */
+	CFG_MERGE_ERROR /* return CFG_ERROR_CONFLICT if the values differ */
+} cfg_merge_policy_t;
+
+/* the kinds of changes reported by cfg_diff() */
+typedef enum {
+	CFG_DIFF_ADDED, /* the key is only in the new object */
+	CFG_DIFF_REMOVED, /* the key is only in the old object */
+	CFG_DIFF_CHANGED /* the key has another value in the new object */
+} cfg_diff_type_t;
+
+/* callback for cfg_diff(), called for each change; 'old_entry' is NULL for an
+ * added key and 'new_entry' is NULL for a removed key. 'section' is
+ * CFG_ROOT_SECTION for the root section. return CFG_FALSE to stop. */
+typedef cfg_bool (*cfg_diff_cb_t)(void *ctx, cfg_diff_type_t type, const cfg_char *section,
+	cfg_entry_t *old_entry, cfg_entry_t *new_entry);
+
+/* callback for cfg_subscribe(), called for a key which was added, changed or
+ * removed; 'value' is NULL for a removed key and 'section' is CFG_ROOT_SECTION
+ * for the root section. the strings are only valid during the call. */
+typedef void (*cfg_change_cb_t)(void *ctx, const cfg_char *section, const cfg_char *key, const cfg_char *value);
+
+/* field types for cfg_section_bind() */
+typedef enum {
+	CFG_BIND_BOOL, /* cfg_bool */
+	CFG_BIND_INT, /* cfg_int */
+	CFG_BIND_LONG, /* cfg_long */
+	CFG_BIND_FLOAT, /* cfg_float */
+	CFG_BIND_DOUBLE, /* cfg_double */
+	CFG_BIND_STRING /* cfg_char *, pointing to the value in the library object */
+} cfg_bind_type_t;
+
+/* a field of a struct bound to a key; 'offset' is offsetof() the field and
+ * 'def' is a default value in string form, or NULL to leave the field as is. */
+typedef struct {
+	const cfg_char *key;
+	cfg_bind_type_t type;
+	size_t offset;
+	const cfg_char *def;
+} cfg_bind_t;
+
+/* the memory held by an object in bytes, from cfg_memory_stats() */
+typedef struct {
+	size_t sections; /* the section array */
+	size_t entries; /* entry arrays, key hashes and key orders */
+	size_t strings; /* keys, values and section names that are not interned */
+	size_t intern; /* the interning table and its strings */
+	size_t cache;
+	size_t index;
+	size_t other; /* the object, the lazy parsing buffer, the snapshot path and the diagnostics */
+	size_t total; /* the sum of the above */
+	size_t wasted; /* part of 'total' which is allocated but not used */
+	size_t allocations; /* the number of blocks from the allocator */
+	size_t shared; /* held together with clones; not in 'total' */
+} cfg_memory_stats_t;
+
+/* the kinds of warnings of a parse, kept by cfg_diagnostics_set() */
+typedef enum {
+	CFG_DIAGNOSTIC_NO_EQUAL_SIGN, /* a line which is not a section or a key / value pair */
+	CFG_DIAGNOSTIC_QUOTE_NOT_CLOSED /* a quote not closed at the end of a key, value or section name */
+} cfg_diagnostic_code_t;
+
+/* a warning of a parse, from cfg_diagnostics_get(); 'line' and 'column'
+ * start from 1 */
+typedef struct {
+	cfg_diagnostic_code_t code;
+	cfg_uint32 line;
+	cfg_uint32 column;
+} cfg_diagnostic_t;
+
 /* -----------------------------------------------------------------------------
  * buffer & file I/O
 */
@@ -113,6 +237,22 @@ typedef struct _cfg_entry_t cfg_entry_t;
 CFG_API
 cfg_t *cfg_alloc(void);
 
+/* allocates a new library object which uses custom memory callbacks.
+ * the allocator is copied; NULL uses malloc(), realloc() and free(). */
+CFG_API
+cfg_t *cfg_alloc_ex(const cfg_allocator_t *allocator);
+
+/* create a bump pointer allocator for parse-once workloads; memory is taken
+ * from malloc() in blocks of 'block_size' bytes (0 for 1MB) and is released
+ * only by cfg_bump_allocator_free(), after cfg_free() of all objects using it.
+ * not thread-safe. */
+CFG_API
+cfg_allocator_t *cfg_bump_allocator_alloc(cfg_uint32 block_size);
+
+/* free a bump pointer allocator and all memory allocated through it */
+CFG_API
+void cfg_bump_allocator_free(cfg_allocator_t *allocator);
+
 /* free all memory allocated by the library for a cfg_t object */
 CFG_API
 cfg_status_t cfg_free(cfg_t *st);
@@ -121,6 +261,20 @@ cfg_status_t cfg_free(cfg_t *st);
 CFG_API
 cfg_status_t cfg_buffer_parse(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_bool copy);
 
+/* like cfg_buffer_parse() for buffers of 4GB and more */
+CFG_API
+cfg_status_t cfg_buffer_parse64(cfg_t *st, cfg_char *buf, size_t sz, cfg_bool copy);
+
+/* tokenize a buffer like cfg_buffer_parse() but pass each entry to 'cb'
+ * instead of storing it; the sections and entries of the object are not
+ * changed. only the settings and the allocator of the object are used. */
+CFG_API
+cfg_status_t cfg_buffer_scan(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_bool copy, cfg_scan_cb_t cb, void *ctx);
+
+/* like cfg_buffer_scan() for buffers of 4GB and more */
+CFG_API
+cfg_status_t cfg_buffer_scan64(cfg_t *st, cfg_char *buf, size_t sz, cfg_bool copy, cfg_scan_cb_t cb, void *ctx);
+
 /* parse a file by name, passed as the 2nd parameter. non-safe for Win32's
  * UTF-16 paths! use cfg_buffer_parse() or cfg_file_ptr_parse() instead. */
 CFG_API
@@ -131,11 +285,69 @@ cfg_status_t cfg_file_parse(cfg_t *st, cfg_char *filename);
 CFG_API
 cfg_status_t cfg_file_ptr_parse(cfg_t *st, FILE *f, cfg_bool close);
 
+/* parse the regular files of directory 'dir' with names matching 'pattern'
+ * ('*' and '?'; NULL for all, hidden files only match a pattern starting with
+ * '.') and merge them into the object, in the strcmp() order of the names.
+ * the existing keys of the object are kept and a key set again by a later file
+ * takes its value; a key repeated in one file counts only once, as a lookup
+ * returns its first value. the files are read and parsed on 'nthreads' threads
+ * (0 for the number from cfg_threads_set()). if a file cannot be parsed
+ * nothing is merged and its status is returned. */
+CFG_API
+cfg_status_t cfg_dir_parse(cfg_t *st, const cfg_char *dir, const cfg_char *pattern, cfg_uint32 nthreads);
+
+/* start parsing a file into the object in the background and store a handle
+ * in 'parse'. the file is parsed into a new object, which replaces the
+ * sections and keys of 'st' once the parse succeeded; on failure 'st' keeps
+ * them. with CFG_ASYNC_THREAD in 'flags' the parse runs on a thread of the
+ * library (or at once if threads are not available); otherwise the caller
+ * runs it with cfg_parse_run() on a thread of its own. lookups and edits on
+ * 'st' (including cfg_merge(), cfg_shrink() and cfg_clone()) before the parse
+ * is done wait for it with CFG_ASYNC_BLOCK in 'flags', or else fail with
+ * CFG_ERROR_BUSY; a waiting call runs a parse not run by the caller yet.
+ * other calls on 'st' must wait for the parse, but cfg_free() may be called
+ * at any time and drops a parse not run yet. the allocator of 'st' is used on
+ * the parsing thread. returns CFG_ERROR_BUSY if another parse is pending. */
+CFG_API
+cfg_status_t cfg_parse_async(cfg_t *st, const cfg_char *filename, cfg_uint32 flags, cfg_parse_t **parse);
+
+/* run a parse started without CFG_ASYNC_THREAD on the calling thread; returns
+ * the status of the parse, or CFG_ERROR_BUSY if it was started with
+ * CFG_ASYNC_THREAD or already run, completed or dropped */
+CFG_API
+cfg_status_t cfg_parse_run(cfg_parse_t *parse);
+
+/* return CFG_ERROR_BUSY if the parse is not done yet, or its status. a done
+ * parse is completed in the object, so call this on the thread using it. */
+CFG_API
+cfg_status_t cfg_parse_poll(cfg_parse_t *parse);
+
+/* wait for a parse to finish, complete it in the object, free the handle and
+ * return the status of the parse; a parse not run yet is run on the calling
+ * thread. must be called once for each handle, also after cfg_free() of the
+ * object, which gives CFG_ERROR_BUSY for a parse it dropped. */
+CFG_API
+cfg_status_t cfg_parse_wait(cfg_parse_t *parse);
+
+/* set a directory where cfg_file_parse() keeps pre-parsed snapshots of files.
+ * a snapshot is used instead of parsing if the size, modification time and
+ * inode of the file are unchanged; otherwise the file is parsed and a new
+ * snapshot is written, unless the file was modified in the current second or
+ * its parse had warnings (see cfg_diagnostics_get()). NULL disables snapshots
+ * (default). */
+CFG_API
+cfg_status_t cfg_snapshot_dir_set(cfg_t *st, const cfg_char *dir);
+
 /* write all the sections and keys to a string buffer; allocates memory at
- * the 'out' pointer and stores the length in 'len'. */
+ * the 'out' pointer and stores the length in 'len'. returns
+ * CFG_ERROR_OUT_OF_RANGE if the length does not fit in 32bit. */
 CFG_API
 cfg_status_t cfg_buffer_write(cfg_t *st, cfg_char **out, cfg_uint32 *len);
 
+/* like cfg_buffer_write() for outputs of 4GB and more */
+CFG_API
+cfg_status_t cfg_buffer_write64(cfg_t *st, cfg_char **out, size_t *len);
+
 /* write all the sections and keys to a file. non-safe for Win32's
  * UTF-16 paths! use cfg_buffer_write() or cfg_file_ptr_write() instead. */
 CFG_API
@@ -150,6 +362,38 @@ cfg_status_t cfg_file_ptr_write(cfg_t *st, FILE *f, cfg_bool close);
 CFG_API
 cfg_status_t cfg_verbose_set(cfg_t *st, cfg_uint32 level);
 
+/* enable or disable interning of keys and section names. with interning
+ * identical names share one stored copy, so cfg_entry_key_get() returns
+ * the same pointer for equal keys and names can be compared by pointer.
+ * existing names are converted; best enabled before parsing. */
+CFG_API
+cfg_status_t cfg_intern_set(cfg_t *st, cfg_bool enable);
+
+/* enable or disable lazy parsing for the next parse. a lazy parse unescapes
+ * the buffer and hashes the section names, but keeps a copy of the buffer and
+ * parses the entries of a section on the first cfg_section_get(),
+ * cfg_entry_get() or other call that reaches the section. cfg_optimize(),
+ * writing and snapshots parse all sections. meant for large configs of which
+ * only a few sections are read. */
+CFG_API
+cfg_status_t cfg_lazy_set(cfg_t *st, cfg_bool enable);
+
+/* set what the next parse does with a key repeated in a section. with
+ * CFG_DUPLICATES_KEEP all entries are stored and which one a lookup returns
+ * can depend on the cache. with CFG_DUPLICATES_FIRST or CFG_DUPLICATES_LAST
+ * each key is stored once, at the position of its first entry, with the value
+ * of its first or last entry. a repeated key is never copied and with
+ * CFG_DUPLICATES_LAST a replaced value is freed right away. cfg_buffer_scan()
+ * still passes every entry. */
+CFG_API
+cfg_status_t cfg_duplicates_set(cfg_t *st, cfg_duplicates_t policy);
+
+/* set the number of threads (up to CFG_THREADS_MAX) used by cfg_buffer_write()
+ * and by default by cfg_dir_parse(); 0 or 1 (default) uses only the calling
+ * thread. the results do not depend on the number of threads. */
+CFG_API
+cfg_status_t cfg_threads_set(cfg_t *st, cfg_uint32 n);
+
 /* get the last status of the library object */
 CFG_API
 cfg_status_t cfg_status_get(cfg_t *st);
@@ -175,6 +419,53 @@ cfg_status_t cfg_cache_entry_add(cfg_t *st, cfg_entry_t *entry);
 CFG_API
 cfg_entry_t *cfg_cache_entry_nth(cfg_t *st, cfg_uint32 n);
 
+/* -----------------------------------------------------------------------------
+ * index
+*/
+
+/* build a minimal perfect hash index over all section / key pairs. meant for
+ * configs that are no longer modified after parsing: cfg_entry_get() and
+ * friends then cost one table read and skip the cache. adding or deleting
+ * entries or sections drops the index; call again to rebuild it. */
+CFG_API
+cfg_status_t cfg_optimize(cfg_t *st);
+
+/* -----------------------------------------------------------------------------
+ * memory
+*/
+
+/* report the memory held by the object in 'stats', without the overhead of
+ * the allocator. pending sections of a lazy parse are not parsed. */
+CFG_API
+cfg_status_t cfg_memory_stats(cfg_t *st, cfg_memory_stats_t *stats);
+
+/* copy all keys, values and section names into one block and free the single
+ * copies; also unescapes all values and drops a lazy parsing buffer no longer
+ * needed. meant for long-lived objects after many edits. entries, the cache
+ * and the index stay valid, but value, key and section name pointers obtained
+ * earlier do not. */
+CFG_API
+cfg_status_t cfg_shrink(cfg_t *st);
+
+/* -----------------------------------------------------------------------------
+ * diagnostics
+*/
+
+/* keep the last 'size' (rounded up to a power of two) warnings of a parse in
+ * a ring allocated here; 0 (default) keeps none. the parser writes them
+ * without testing if they are kept, and never to stderr. cfg_dir_parse() does
+ * not keep them. */
+CFG_API
+cfg_status_t cfg_diagnostics_set(cfg_t *st, cfg_uint32 size);
+
+/* copy up to '*n' kept warnings of the last parse, oldest first, to 'diag'
+ * and set '*n' to the number copied; cfg_buffer_scan() does not change them.
+ * 'total' (can be NULL) gets the number of warnings of the parse, which is
+ * more than the ring holds if some were overwritten and is counted even if
+ * none are kept. */
+CFG_API
+cfg_status_t cfg_diagnostics_get(cfg_t *st, cfg_diagnostic_t *diag, cfg_uint32 *n, cfg_uint32 *total);
+
 /* -----------------------------------------------------------------------------
  * sections and entries
 */
@@ -203,6 +494,23 @@ cfg_uint32 cfg_total_entries(cfg_t *st, cfg_section_t *section);
 CFG_API
 cfg_entry_t *cfg_entry_nth(cfg_t *st, cfg_section_t *section, cfg_uint32 n);
 
+/* get the nth entry from a section in key order (strcmp()); entries with the
+ * same key keep their order. the order is built on first use and dropped when
+ * entries are added to or deleted from the section. */
+CFG_API
+cfg_entry_t *cfg_entry_sorted_nth(cfg_t *st, cfg_section_t *section, cfg_uint32 n);
+
+/* call 'cb' for the entries of a section (2nd argument, can be
+ * CFG_ROOT_SECTION) whose key starts with 'prefix', in key order. costs a
+ * binary search plus the matches, once the order is built. */
+CFG_API
+cfg_status_t cfg_entries_prefix(cfg_t *st, const cfg_char *section, const cfg_char *prefix, cfg_entry_cb_t cb, void *ctx);
+
+/* like cfg_entries_prefix() for the keys in [first, last); either bound can
+ * be NULL for no bound. */
+CFG_API
+cfg_status_t cfg_entries_range(cfg_t *st, const cfg_char *section, const cfg_char *first, const cfg_char *last, cfg_entry_cb_t cb, void *ctx);
+
 /* return an entry from section (2nd argument, can be CFG_ROOT_SECTION) and
  * key (3rd argument) */
 CFG_API
@@ -240,6 +548,38 @@ cfg_char *cfg_value_get(cfg_t *st, const cfg_char *section, const cfg_char *key)
 CFG_API
 cfg_char *cfg_root_value_get(cfg_t *st, const cfg_char *key);
 
+/* make a handle for a section (can be CFG_ROOT_SECTION) and key pair. the
+ * handle only holds hashes and stays valid for any library object. */
+CFG_API
+cfg_key_t cfg_key_make(const cfg_char *section, const cfg_char *key);
+
+/* return an entry by a handle from cfg_key_make(); no hashing is done */
+CFG_API
+cfg_entry_t *cfg_key_entry_get(cfg_t *st, const cfg_key_t *key);
+
+/* retrieve a specific value by a handle from cfg_key_make() */
+CFG_API
+cfg_char *cfg_key_value_get(cfg_t *st, const cfg_key_t *key);
+
+/* retrieve the values of 'n' keys (3rd argument) from one section (can be
+ * CFG_ROOT_SECTION) into 'values'; a missing key gets NULL and the call
+ * returns CFG_ERROR_NOT_FOUND. the section is resolved once and the cache
+ * is not used. */
+CFG_API
+cfg_status_t cfg_values_get_many(cfg_t *st, const cfg_char *section, const cfg_char **keys, cfg_uint32 n, cfg_char **values);
+
+/* like cfg_values_get_many() for handles from cfg_key_make(), which can be
+ * from different sections; keep the keys of a section together. */
+CFG_API
+cfg_status_t cfg_key_values_get(cfg_t *st, const cfg_key_t *keys, cfg_uint32 n, cfg_char **values);
+
+/* fill the fields of the struct at 'ptr' from the keys of a section (can be
+ * CFG_ROOT_SECTION), as described by the 'n' fields of 'table'. the entries
+ * are walked once; fields without a key get their default. if the section
+ * is missing only the defaults are set and CFG_ERROR_NOT_FOUND is returned. */
+CFG_API
+cfg_status_t cfg_section_bind(cfg_t *st, const cfg_char *section, const cfg_bind_t *table, cfg_uint32 n, void *ptr);
+
 /* set a value for a specific key in a section; add the key if missing. */
 CFG_API
 cfg_status_t cfg_value_set(cfg_t *st, const cfg_char *section, const cfg_char *key, const cfg_char *value, cfg_bool add);
@@ -262,6 +602,119 @@ cfg_status_t cfg_section_delete(cfg_t *st, const cfg_char *section);
 CFG_API
 cfg_status_t cfg_clear(cfg_t *st);
 
+/* merge the sections and keys of 'src' into 'dst'; new sections and keys are
+ * appended in the order of 'src' and 'policy' decides about keys in both. a
+ * key repeated in a section of 'src' counts once, as a lookup returns its
+ * first value. with CFG_MERGE_ERROR nothing is merged on a conflict. with
+ * 'consume' 'src' is cleared afterwards and its keys and values are moved
+ * instead of copied if both objects use the same allocator and no interning.
+ * runs in time linear in the number of keys of both objects. */
+CFG_API
+cfg_status_t cfg_merge(cfg_t *dst, cfg_t *src, cfg_merge_policy_t policy, cfg_bool consume);
+
+/* call 'cb' for the keys added, removed or changed from 'old_st' to 'new_st';
+ * first the keys of the sections of 'old_st' in order, then the keys of the
+ * sections only in 'new_st'. sections and keys are matched by hash, and like in
+ * a lookup only the first of a repeated section or key counts. runs in time
+ * linear in the number of keys of both objects; the status is stored in
+ * 'old_st'. */
+CFG_API
+cfg_status_t cfg_diff(cfg_t *old_st, cfg_t *new_st, cfg_diff_cb_t cb, void *ctx);
+
+/* a new object with the sections, keys, values and settings of 'st' that
+ * shares their storage with 'st' through a reference count. a section is
+ * copied by an object on its first change there; keys and values are never
+ * copied. the first clone freezes 'st': it parses any lazy sections and calls
+ * cfg_shrink(), after which each clone costs a copy of the section array.
+ * the index is not cloned. entry pointers of a section obtained before its
+ * first change are not valid for lookups of that object anymore. objects
+ * which share storage can be freed on different threads. NULL on failure. */
+CFG_API
+cfg_t *cfg_clone(cfg_t *st);
+
+/* -----------------------------------------------------------------------------
+ * subscriptions
+*/
+
+/* call 'cb' when a key of 'section' (can be CFG_ROOT_SECTION) is added,
+ * changed or removed. 'key' is a key, a prefix ending with '*' (e.g. "db.*")
+ * or NULL for all keys of the section; keys and sections are matched by hash,
+ * like in a lookup. changes come from cfg_value_set(), cfg_entry_value_set(),
+ * cfg_entry_add(), the deletes, cfg_clear(), cfg_merge(), cfg_dir_parse() and
+ * parsing again, which reports only the keys that differ (see cfg_diff()) and
+ * parses all lazy sections. a change is found through
+ * a hash table of the subscriptions; without any a change costs one pointer
+ * test. */
+CFG_API
+cfg_status_t cfg_subscribe(cfg_t *st, const cfg_char *section, const cfg_char *key, cfg_change_cb_t cb, void *ctx);
+
+/* remove all subscriptions with 'cb' and 'ctx' */
+CFG_API
+cfg_status_t cfg_unsubscribe(cfg_t *st, cfg_change_cb_t cb, void *ctx);
+
+/* with 'enable' changes are queued instead of reported at the end of the
+ * call which made them, and are passed on by cfg_changes_dispatch(); a key
+ * changed again before that is reported once, with its last value. off by
+ * default; turning it off reports the queued changes. */
+CFG_API
+cfg_status_t cfg_changes_batch_set(cfg_t *st, cfg_bool enable);
+
+/* report the queued changes on the calling thread, which can be a dispatch
+ * thread while another one changes the object; does not set the status of the
+ * object for that reason. the memory callbacks must be thread-safe then. */
+CFG_API
+cfg_status_t cfg_changes_dispatch(cfg_t *st);
+
+/* -----------------------------------------------------------------------------
+ * overlays
+*/
+
+/* allocate an overlay: a stack of up to CFG_OVERLAY_MAX objects (layers) where
+ * a lookup returns the entry of the topmost layer which has the key. the
+ * layers are not copied or owned, so a layer can be parsed again in place.
+ * the first lookup builds a table of the topmost entries, which is rebuilt
+ * after entries of a layer were added, deleted or parsed again. */
+CFG_API
+cfg_overlay_t *cfg_overlay_alloc(void);
+
+/* free an overlay; the layers are not freed */
+CFG_API
+cfg_status_t cfg_overlay_free(cfg_overlay_t *overlay);
+
+/* push a layer on top of the overlay */
+CFG_API
+cfg_status_t cfg_overlay_push(cfg_overlay_t *overlay, cfg_t *layer);
+
+/* remove the top layer of the overlay */
+CFG_API
+cfg_status_t cfg_overlay_pop(cfg_overlay_t *overlay);
+
+/* get the entry for a key from the topmost layer which has it */
+CFG_API
+cfg_entry_t *cfg_overlay_entry_get(cfg_overlay_t *overlay, const cfg_char *section, const cfg_char *key);
+
+/* get the value for a key from the topmost layer which has it */
+CFG_API
+cfg_char *cfg_overlay_value_get(cfg_overlay_t *overlay, const cfg_char *section, const cfg_char *key);
+
+/* like cfg_overlay_entry_get() for a handle from cfg_key_make() */
+CFG_API
+cfg_entry_t *cfg_overlay_key_entry_get(cfg_overlay_t *overlay, const cfg_key_t *key);
+
+/* like cfg_overlay_value_get() for a handle from cfg_key_make() */
+CFG_API
+cfg_char *cfg_overlay_key_value_get(cfg_overlay_t *overlay, const cfg_key_t *key);
+
+/* set a value in the top layer, adding the key if missing; the layers below
+ * are not changed. */
+CFG_API
+cfg_status_t cfg_overlay_value_set(cfg_overlay_t *overlay, const cfg_char *section, const cfg_char *key, const cfg_char *value);
+
+/* merge all layers, from the bottom up, into a new object; for hot paths
+ * which need single layer lookups. returns NULL on failure. */
+CFG_API
+cfg_t *cfg_overlay_flatten(cfg_overlay_t *overlay);
+
 /* -----------------------------------------------------------------------------
  * utilities
 */
@@ -278,7 +731,7 @@ cfg_float cfg_value_to_float(const cfg_char *value);
 CFG_API
 cfg_double cfg_value_to_double(const cfg_char *value);
 
-/* number -> string conversations (allocate memory) */
+/* number -> string conversations (allocate memory with malloc()) */
 CFG_API
 cfg_char *cfg_bool_to_value(cfg_bool number);
 CFG_API
@@ -294,7 +747,7 @@ cfg_char *cfg_double_to_value(cfg_double number);
 CFG_API
 cfg_uint32 cfg_hash_get(const cfg_char *str);
 
-/* HEX string <-> char* buffer conversations; allocates memory! */
+/* HEX string <-> char* buffer conversations; allocates memory with malloc()! */
 CFG_API
 cfg_char *cfg_hex_to_char(const cfg_char *value);
 CFG_API
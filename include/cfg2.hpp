@@ -0,0 +1,270 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * cfg2.hpp:
+ *	header-only C++ wrapper for the library; requires C++17
+ */
+
+#ifndef CFG2_HPP
+#define CFG2_HPP
+
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "cfg2.h"
+
+namespace cfg {
+
+/* -----------------------------------------------------------------------------
+ * hashing
+*/
+
+/* the same hash as cfg_hash_get(), usable at compile time. converting 'char'
+ * straight to cfg_uint32 matches the C promotion for signed and unsigned char. */
+constexpr cfg_uint32 hash(const cfg_char *str)
+{
+	cfg_uint32 hash = CFG_HASH_SEED;
+
+	if (!str)
+		return hash;
+	while (*str) {
+		hash *= hash;
+		hash ^= static_cast<cfg_uint32>(*str++);
+	}
+	return hash;
+}
+
+/* the same handle as cfg_key_make(); 'section' can be CFG_ROOT_SECTION.
+ * assign to a constexpr variable to have it computed at compile time:
+ *	static constexpr cfg_key_t port = cfg::key("server", "port");
+ */
+constexpr cfg_key_t key(const cfg_char *section, const cfg_char *key)
+{
+	return cfg_key_t{ hash(section), hash(key) };
+}
+
+/* -----------------------------------------------------------------------------
+ * views; they point into the library object and are invalidated by parsing,
+ * adding or deleting entries and sections, like the raw pointers of the C API.
+*/
+
+inline std::string_view view(const cfg_char *str)
+{
+	return str ? std::string_view(str) : std::string_view();
+}
+
+/* convert a value with the cfg_value_to_*() utilities */
+template <typename T>
+T value_to(const cfg_char *value)
+{
+	if constexpr (std::is_same_v<T, bool>)
+		return cfg_value_to_bool(value) != CFG_FALSE;
+	else if constexpr (std::is_same_v<T, cfg_int>)
+		return cfg_value_to_int(value);
+	else if constexpr (std::is_same_v<T, cfg_long>)
+		return cfg_value_to_long(value);
+	else if constexpr (std::is_same_v<T, cfg_float>)
+		return cfg_value_to_float(value);
+	else if constexpr (std::is_same_v<T, cfg_double>)
+		return cfg_value_to_double(value);
+	else if constexpr (std::is_same_v<T, std::string_view>)
+		return view(value);
+	else if constexpr (std::is_same_v<T, std::string>)
+		return std::string(value);
+	else
+		static_assert(!sizeof(T), "cfg::value_to(): unsupported type");
+}
+
+class entry {
+public:
+	entry(cfg_t *st, cfg_entry_t *entry) noexcept : st_(st), entry_(entry) {}
+
+	std::string_view key() const noexcept { return view(cfg_entry_key_get(st_, entry_)); }
+	std::string_view value() const noexcept { return view(cfg_entry_value_get(st_, entry_)); }
+	template <typename T>
+	T as() const { return value_to<T>(cfg_entry_value_get(st_, entry_)); }
+	cfg_entry_t *get() const noexcept { return entry_; }
+
+private:
+	cfg_t *st_;
+	cfg_entry_t *entry_;
+};
+
+/* a forward iterator over the nth items of a parent (section or config) */
+template <typename Parent, typename Item>
+class nth_iterator {
+public:
+	nth_iterator(const Parent *parent, cfg_uint32 n) noexcept : parent_(parent), n_(n) {}
+
+	Item operator*() const noexcept { return parent_->nth(n_); }
+	nth_iterator &operator++() noexcept { n_++; return *this; }
+	bool operator==(const nth_iterator &other) const noexcept { return n_ == other.n_; }
+	bool operator!=(const nth_iterator &other) const noexcept { return n_ != other.n_; }
+
+private:
+	const Parent *parent_;
+	cfg_uint32 n_;
+};
+
+class section {
+public:
+	using iterator = nth_iterator<section, entry>;
+
+	section(cfg_t *st, cfg_section_t *section) noexcept : st_(st), section_(section) {}
+
+	/* empty for the root section */
+	std::string_view name() const noexcept { return view(cfg_section_name_get(st_, section_)); }
+	cfg_uint32 size() const noexcept { return cfg_total_entries(st_, section_); }
+	entry nth(cfg_uint32 n) const noexcept { return entry(st_, cfg_entry_nth(st_, section_, n)); }
+	iterator begin() const noexcept { return iterator(this, 0); }
+	iterator end() const noexcept { return iterator(this, size()); }
+	cfg_section_t *get() const noexcept { return section_; }
+
+private:
+	cfg_t *st_;
+	cfg_section_t *section_;
+};
+
+/* -----------------------------------------------------------------------------
+ * config; owns a cfg_t object. functions that change the object return the
+ * status of the C call; only allocating the object can throw (std::bad_alloc).
+*/
+
+class config {
+public:
+	using iterator = nth_iterator<config, section>;
+
+	config() : st_(cfg_alloc())
+	{
+		if (!st_)
+			throw std::bad_alloc();
+	}
+
+	/* see cfg_alloc_ex(); the allocator must outlive the object */
+	explicit config(const cfg_allocator_t *allocator) : st_(cfg_alloc_ex(allocator))
+	{
+		if (!st_)
+			throw std::bad_alloc();
+	}
+
+	/* take over an object from cfg_alloc() */
+	explicit config(cfg_t *st) noexcept : st_(st) {}
+
+	~config()
+	{
+		if (st_)
+			cfg_free(st_);
+	}
+
+	config(const config &) = delete;
+	config &operator=(const config &) = delete;
+
+	config(config &&other) noexcept : st_(std::exchange(other.st_, nullptr)) {}
+
+	config &operator=(config &&other) noexcept
+	{
+		if (this != &other) {
+			if (st_)
+				cfg_free(st_);
+			st_ = std::exchange(other.st_, nullptr);
+		}
+		return *this;
+	}
+
+	cfg_t *get() const noexcept { return st_; }
+	cfg_t *release() noexcept { return std::exchange(st_, nullptr); }
+	cfg_status_t status() const noexcept { return cfg_status_get(st_); }
+
+	/* parse a copy of 'buf' */
+	cfg_status_t parse(std::string_view buf) noexcept
+	{
+		return cfg_buffer_parse64(st_, const_cast<cfg_char *>(buf.data()), buf.size(), CFG_TRUE);
+	}
+
+	cfg_status_t parse_file(const cfg_char *filename) noexcept
+	{
+		return cfg_file_parse(st_, const_cast<cfg_char *>(filename));
+	}
+
+	/* the output is empty on error */
+	std::string write() const
+	{
+		cfg_char *out = nullptr;
+		std::size_t len = 0;
+		std::string str;
+
+		if (cfg_buffer_write64(st_, &out, &len) == CFG_STATUS_OK && out)
+			str.assign(out, len);
+		std::free(out);
+		return str;
+	}
+
+	/* raw values; std::nullopt if the entry is missing. 'section' can be
+	 * CFG_ROOT_SECTION. */
+	std::optional<std::string_view> value(const cfg_char *section, const cfg_char *key) const noexcept
+	{
+		const cfg_char *value = cfg_value_get(st_, section, key);
+		if (!value)
+			return std::nullopt;
+		return std::string_view(value);
+	}
+
+	std::optional<std::string_view> value(const cfg_key_t &key) const noexcept
+	{
+		const cfg_char *value = cfg_key_value_get(st_, &key);
+		if (!value)
+			return std::nullopt;
+		return std::string_view(value);
+	}
+
+	/* typed values; T is bool, cfg_int, cfg_long, cfg_float, cfg_double,
+	 * std::string_view or std::string. mind that the conversion itself does
+	 * not fail, like cfg_value_to_int() and friends. */
+	template <typename T>
+	std::optional<T> get(const cfg_char *section, const cfg_char *key) const
+	{
+		const cfg_char *value = cfg_value_get(st_, section, key);
+		if (!value)
+			return std::nullopt;
+		return value_to<T>(value);
+	}
+
+	template <typename T>
+	std::optional<T> get(const cfg_key_t &key) const
+	{
+		const cfg_char *value = cfg_key_value_get(st_, &key);
+		if (!value)
+			return std::nullopt;
+		return value_to<T>(value);
+	}
+
+	/* set a value; the key is added if missing */
+	cfg_status_t set(const cfg_char *section, const cfg_char *key, const cfg_char *value) noexcept
+	{
+		return cfg_value_set(st_, section, key, value, CFG_TRUE);
+	}
+
+	cfg_status_t optimize() noexcept { return cfg_optimize(st_); }
+
+	/* iteration over all sections, starting with the root section */
+	cfg_uint32 size() const noexcept { return cfg_total_sections(st_); }
+	section nth(cfg_uint32 n) const noexcept { return section(st_, cfg_section_nth(st_, n)); }
+	iterator begin() const noexcept { return iterator(this, 0); }
+	iterator end() const noexcept { return iterator(this, size()); }
+
+private:
+	cfg_t *st_;
+};
+
+} /* namespace cfg */
+
+#endif /* CFG2_HPP */
@@ -0,0 +1,131 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * alloc.c:
+ *	a bump pointer allocator for cfg_alloc_ex()
+ */
+
+#include "defines.h"
+
+#define CFG_BUMP_BLOCK_SZ (1 << 20)
+
+/* every allocation is prefixed by its size, which realloc() needs. the header
+ * is as large as the alignment of the returned pointers. */
+typedef union {
+	size_t size;
+	double align_double;
+	void *align_ptr;
+} cfg_bump_header_t;
+
+typedef struct _cfg_bump_block_t {
+	struct _cfg_bump_block_t *next;
+	cfg_bump_header_t align;
+} cfg_bump_block_t;
+
+typedef struct {
+	cfg_allocator_t allocator; /* must be the first member */
+	cfg_bump_block_t *block;
+	cfg_char *pos;
+	cfg_char *end;
+	size_t block_size;
+	cfg_char *last; /* the last allocation can be resized in place */
+} cfg_bump_t;
+
+#define CFG_BUMP_ALIGN(_size) \
+	(((_size) + sizeof(cfg_bump_header_t) - 1) / sizeof(cfg_bump_header_t) * sizeof(cfg_bump_header_t))
+
+static void *cfg_bump_malloc(void *ctx, size_t size)
+{
+	cfg_bump_t *bump = (cfg_bump_t *)ctx;
+	cfg_bump_block_t *block;
+	cfg_bump_header_t *header;
+	size_t need, block_size;
+
+	need = sizeof(cfg_bump_header_t) + CFG_BUMP_ALIGN(size);
+	if (!bump->pos || (size_t)(bump->end - bump->pos) < need) {
+		block_size = need > bump->block_size ? need : bump->block_size;
+		block = (cfg_bump_block_t *)malloc(sizeof(cfg_bump_block_t) + block_size);
+		if (!block)
+			return NULL;
+		block->next = bump->block;
+		bump->block = block;
+		bump->pos = (cfg_char *)(block + 1);
+		bump->end = bump->pos + block_size;
+	}
+	header = (cfg_bump_header_t *)bump->pos;
+	header->size = size;
+	bump->last = bump->pos;
+	bump->pos += need;
+	return (void *)(header + 1);
+}
+
+static void *cfg_bump_realloc(void *ctx, void *ptr, size_t size)
+{
+	cfg_bump_t *bump = (cfg_bump_t *)ctx;
+	cfg_bump_header_t *header;
+	void *copy;
+
+	if (!ptr)
+		return cfg_bump_malloc(ctx, size);
+	header = (cfg_bump_header_t *)ptr - 1;
+
+	/* grow or shrink the last allocation in place if it fits the block */
+	if ((cfg_char *)header == bump->last &&
+	    (size_t)(bump->end - bump->last) >= sizeof(cfg_bump_header_t) + CFG_BUMP_ALIGN(size)) {
+		header->size = size;
+		bump->pos = bump->last + sizeof(cfg_bump_header_t) + CFG_BUMP_ALIGN(size);
+		return ptr;
+	}
+	copy = cfg_bump_malloc(ctx, size);
+	if (!copy)
+		return NULL;
+	memcpy(copy, ptr, header->size < size ? header->size : size);
+	return copy;
+}
+
+/* memory is only released by cfg_bump_allocator_free(); still, the last
+ * allocation is given back as temporary buffers are often freed right away. */
+static void cfg_bump_free(void *ctx, void *ptr)
+{
+	cfg_bump_t *bump = (cfg_bump_t *)ctx;
+	cfg_bump_header_t *header = (cfg_bump_header_t *)ptr - 1;
+
+	if ((cfg_char *)header == bump->last) {
+		bump->pos = bump->last;
+		bump->last = NULL;
+	}
+}
+
+cfg_allocator_t *cfg_bump_allocator_alloc(cfg_uint32 block_size)
+{
+	cfg_bump_t *bump = (cfg_bump_t *)calloc(1, sizeof(cfg_bump_t));
+	if (!bump) {
+		fprintf(stderr, "[cfg2] cfg_bump_allocator_alloc(): cannot calloc() the allocator!\n");
+		return NULL;
+	}
+	bump->allocator.malloc_fn = cfg_bump_malloc;
+	bump->allocator.realloc_fn = cfg_bump_realloc;
+	bump->allocator.free_fn = cfg_bump_free;
+	bump->allocator.ctx = (void *)bump;
+	bump->block_size = block_size ? block_size : CFG_BUMP_BLOCK_SZ;
+	return &bump->allocator;
+}
+
+void cfg_bump_allocator_free(cfg_allocator_t *allocator)
+{
+	cfg_bump_t *bump = (cfg_bump_t *)allocator;
+	cfg_bump_block_t *block, *next;
+
+	if (!bump)
+		return;
+	for (block = bump->block; block; block = next) {
+		next = block->next;
+		free(block);
+	}
+	free(bump);
+}
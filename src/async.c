@@ -0,0 +1,197 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * async.c:
+ *	parsing a file in the background while the caller goes on with its work
+ */
+
+#include "defines.h"
+
+/* the handle is owned by the caller and can outlive the object, so it is
+ * allocated with malloc(); the rest uses the allocator of the object */
+struct _cfg_parse_t {
+	cfg_t *st; /* NULL once the parse is completed or dropped */
+	cfg_t *tree; /* the file is parsed into this and then moved into 'st' */
+	cfg_char *filename;
+	cfg_uint32 flags;
+	cfg_thread_t *thread; /* NULL on the thread of the caller */
+	cfg_event_t *done;
+	cfg_status_t status;
+	volatile cfg_uint32 claims; /* see cfg_parse_claim() */
+};
+
+/* the first caller to claim the parse runs or drops it; a parse started
+ * without CFG_ASYNC_THREAD can be run by cfg_parse_run() on another thread
+ * while the owner of the object completes or frees it */
+static cfg_bool cfg_parse_claim(cfg_parse_t *parse)
+{
+	return cfg_atomic_add(&parse->claims, 1) == 1;
+}
+
+/* parse the file; the only code which runs on the other thread. the handle
+ * can be freed as soon as 'done' is set. */
+static cfg_status_t cfg_parse_file(cfg_parse_t *parse)
+{
+	cfg_status_t ret = cfg_file_parse(parse->tree, parse->filename);
+
+	parse->status = ret;
+	cfg_event_set(parse->done);
+	return ret;
+}
+
+static void cfg_parse_job(void *arg)
+{
+	cfg_parse_file((cfg_parse_t *)arg);
+}
+
+/* replace the sections, keys and warnings of 'st' with the ones of 'tree';
+ * like a reload for subscribers */
+static void cfg_parse_adopt(cfg_t *st, cfg_t *tree)
+{
+	if (st->subs)
+		cfg_changes_begin(st);
+	cfg_clear(st);
+	cfg_tree_move(st, tree);
+	cfg_diagnostics_copy(st, tree);
+	if (st->subs)
+		cfg_changes_end(st);
+}
+
+/* not exposed in the API; wait for the pending parse of 'st', move its result
+ * into 'st' if 'adopt' and it succeeded, and release everything but the
+ * handle. a parse which nobody runs yet is run here if 'adopt', or else
+ * dropped with the status CFG_ERROR_BUSY. */
+void cfg_parse_finish(cfg_t *st, cfg_bool adopt)
+{
+	cfg_parse_t *parse = st->async;
+
+	if (!cfg_parse_claim(parse))
+		cfg_event_wait(parse->done);
+	else if (adopt)
+		cfg_parse_file(parse);
+	if (parse->thread)
+		cfg_thread_join(st, parse->thread);
+	if (adopt && parse->status == CFG_STATUS_OK)
+		cfg_parse_adopt(st, parse->tree);
+	cfg_free(parse->tree);
+	cfg_event_free(st, parse->done);
+	parse->tree = NULL;
+	parse->done = NULL;
+	parse->thread = NULL;
+	parse->st = NULL;
+	st->async = NULL;
+	if (adopt)
+		CFG_SET_STATUS(st, parse->status);
+}
+
+/* not exposed in the API; called by lookups while a parse is pending. returns
+ * CFG_ERROR_BUSY if the parse is not done and lookups do not wait for it. */
+cfg_status_t cfg_parse_check(cfg_t *st)
+{
+	if (!(st->async->flags & CFG_ASYNC_BLOCK) && !cfg_event_is_set(st->async->done))
+		return CFG_ERROR_BUSY;
+	cfg_parse_finish(st, CFG_TRUE);
+	return CFG_STATUS_OK;
+}
+
+/* a new object with the settings of 'st' to parse into */
+static cfg_t *cfg_parse_tree_alloc(cfg_t *st)
+{
+	cfg_t *tree = cfg_alloc_ex(&st->allocator);
+
+	if (!tree)
+		return NULL;
+	tree->verbose = st->verbose;
+	tree->nthreads = st->nthreads;
+	tree->lazy = st->lazy;
+	tree->duplicates = st->duplicates;
+	if ((st->snapshot_dir && cfg_snapshot_dir_set(tree, st->snapshot_dir) != CFG_STATUS_OK) ||
+		(st->intern && cfg_intern_set(tree, CFG_TRUE) != CFG_STATUS_OK) ||
+		(st->diagnostics.size && cfg_diagnostics_set(tree, st->diagnostics.size) != CFG_STATUS_OK)) {
+		cfg_free(tree);
+		return NULL;
+	}
+	return tree;
+}
+
+cfg_status_t cfg_parse_async(cfg_t *st, const cfg_char *filename, cfg_uint32 flags, cfg_parse_t **parse)
+{
+	cfg_parse_t *ptr;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_parse_async", CFG_ERROR_NULL_PTR);
+	if (!filename || !parse)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	if (st->async)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_BUSY);
+
+	ptr = (cfg_parse_t *)malloc(sizeof(cfg_parse_t));
+	if (!ptr)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	ptr->st = st;
+	ptr->flags = flags;
+	ptr->thread = NULL;
+	ptr->status = CFG_ERROR_BUSY; /* until it runs */
+	ptr->claims = 0;
+	ptr->filename = cfg_strdup(filename);
+	ptr->tree = cfg_parse_tree_alloc(st);
+	ptr->done = cfg_event_alloc(st);
+	if (!ptr->filename || !ptr->tree || !ptr->done) {
+		free(ptr->filename);
+		if (ptr->tree)
+			cfg_free(ptr->tree);
+		if (ptr->done)
+			cfg_event_free(st, ptr->done);
+		free(ptr);
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	}
+	st->async = ptr;
+	*parse = ptr;
+
+	if (flags & CFG_ASYNC_THREAD) {
+		cfg_parse_claim(ptr);
+		ptr->thread = cfg_thread_start(st, cfg_parse_job, (void *)ptr);
+		if (!ptr->thread)
+			cfg_parse_job((void *)ptr);
+	}
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+cfg_status_t cfg_parse_run(cfg_parse_t *parse)
+{
+	if (!parse)
+		return CFG_ERROR_NULL_PTR;
+	if ((parse->flags & CFG_ASYNC_THREAD) || !cfg_parse_claim(parse))
+		return CFG_ERROR_BUSY;
+	return cfg_parse_file(parse);
+}
+
+cfg_status_t cfg_parse_poll(cfg_parse_t *parse)
+{
+	if (!parse)
+		return CFG_ERROR_NULL_PTR;
+	if (parse->st) {
+		if (!cfg_event_is_set(parse->done))
+			return CFG_ERROR_BUSY;
+		cfg_parse_finish(parse->st, CFG_TRUE);
+	}
+	return parse->status;
+}
+
+cfg_status_t cfg_parse_wait(cfg_parse_t *parse)
+{
+	cfg_status_t ret;
+
+	if (!parse)
+		return CFG_ERROR_NULL_PTR;
+	if (parse->st)
+		cfg_parse_finish(parse->st, CFG_TRUE);
+	ret = parse->status;
+	free(parse->filename);
+	free(parse);
+	return ret;
+}
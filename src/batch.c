@@ -0,0 +1,94 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * batch.c:
+ *	lookups of many keys in one call
+ */
+
+#include "defines.h"
+
+/* number of keys hashed and probed together */
+#define CFG_BATCH_SZ 64
+
+/* not exposed in the API */
+cfg_section_t *cfg_key_section_get(cfg_t *st, cfg_uint32 section_hash);
+void cfg_index_entries_get(cfg_t *st, const cfg_key_t *keys, cfg_uint32 n, cfg_entry_t **entries);
+
+/* look up to CFG_BATCH_SZ keys and store their values; returns the number of
+ * missing keys. without an index '*section' keeps the last resolved section,
+ * so a run of keys from the same section resolves it once. */
+static cfg_uint32 cfg_batch_values_get(cfg_t *st, const cfg_key_t *keys, cfg_uint32 n, cfg_char **values, cfg_section_t **section)
+{
+	cfg_entry_t *entries[CFG_BATCH_SZ];
+	cfg_uint32 i, j, missing = 0;
+
+	if (st->index) {
+		cfg_index_entries_get(st, keys, n, entries);
+		for (i = 0; i < n; i++) {
+			values[i] = entries[i] ? CFG_ENTRY_VALUE(entries[i]) : NULL;
+			missing += !entries[i];
+		}
+		return missing;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!*section || (*section)->hash != keys[i].section_hash)
+			*section = cfg_key_section_get(st, keys[i].section_hash);
+		values[i] = NULL;
+		if (!*section) {
+			missing++;
+			continue;
+		}
+		j = cfg_hash_find((*section)->key_hash, (*section)->nentries, keys[i].key_hash);
+		if (j < (*section)->nentries)
+			values[i] = CFG_ENTRY_VALUE(&(*section)->entry[j]);
+		else
+			missing++;
+	}
+	return missing;
+}
+
+cfg_status_t cfg_values_get_many(cfg_t *st, const cfg_char *section, const cfg_char **keys, cfg_uint32 n, cfg_char **values)
+{
+	cfg_key_t batch[CFG_BATCH_SZ];
+	cfg_section_t *section_ptr = NULL;
+	cfg_uint32 i, j, count, section_hash, missing = 0;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_values_get_many", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
+	if (n && (!keys || !values))
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+
+	section_hash = cfg_hash_get(section);
+	for (i = 0; i < n; i += count) {
+		count = n - i < CFG_BATCH_SZ ? n - i : CFG_BATCH_SZ;
+		for (j = 0; j < count; j++) {
+			batch[j].section_hash = section_hash;
+			batch[j].key_hash = cfg_hash_get(keys[i + j]);
+		}
+		missing += cfg_batch_values_get(st, batch, count, values + i, &section_ptr);
+	}
+	CFG_SET_RETURN_STATUS(st, missing ? CFG_ERROR_NOT_FOUND : CFG_STATUS_OK);
+}
+
+cfg_status_t cfg_key_values_get(cfg_t *st, const cfg_key_t *keys, cfg_uint32 n, cfg_char **values)
+{
+	cfg_section_t *section_ptr = NULL;
+	cfg_uint32 i, count, missing = 0;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_key_values_get", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
+	if (n && (!keys || !values))
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+
+	for (i = 0; i < n; i += count) {
+		count = n - i < CFG_BATCH_SZ ? n - i : CFG_BATCH_SZ;
+		missing += cfg_batch_values_get(st, keys + i, count, values + i, &section_ptr);
+	}
+	CFG_SET_RETURN_STATUS(st, missing ? CFG_ERROR_NOT_FOUND : CFG_STATUS_OK);
+}
@@ -0,0 +1,94 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * bind.c:
+ *	filling C structs from the keys of a section
+ */
+
+#include "defines.h"
+
+/* write a converted value to the field of a struct */
+static void cfg_bind_field_set(const cfg_bind_t *field, void *ptr, const cfg_char *value)
+{
+	void *dest = (void *)((cfg_char *)ptr + field->offset);
+
+	switch (field->type) {
+	case CFG_BIND_BOOL:
+		*(cfg_bool *)dest = cfg_value_to_bool(value);
+		break;
+	case CFG_BIND_INT:
+		*(cfg_int *)dest = cfg_value_to_int(value);
+		break;
+	case CFG_BIND_LONG:
+		*(cfg_long *)dest = cfg_value_to_long(value);
+		break;
+	case CFG_BIND_FLOAT:
+		*(cfg_float *)dest = cfg_value_to_float(value);
+		break;
+	case CFG_BIND_DOUBLE:
+		*(cfg_double *)dest = cfg_value_to_double(value);
+		break;
+	case CFG_BIND_STRING:
+		*(const cfg_char **)dest = value;
+		break;
+	}
+}
+
+cfg_status_t cfg_section_bind(cfg_t *st, const cfg_char *section, const cfg_bind_t *table, cfg_uint32 n, void *ptr)
+{
+	cfg_section_t *section_ptr;
+	cfg_uint32 *slot, *hash, nslots, i, idx, h;
+	cfg_uchar *seen;
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_section_bind", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
+	if (n && (!table || !ptr))
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+
+	/* an open addressing table of field positions + 1 by key hash, at most
+	 * half full; the key hashes and a 'seen' flag per field follow it */
+	for (nslots = 16; nslots < n << 1; nslots <<= 1)
+		;
+	slot = (cfg_uint32 *)cfg_mem_calloc(st, 1, (nslots + n) * sizeof(cfg_uint32) + n);
+	if (!slot)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	hash = slot + nslots;
+	seen = (cfg_uchar *)(hash + n);
+	for (i = 0; i < n; i++) {
+		hash[i] = cfg_hash_get(table[i].key);
+		h = hash[i];
+		CFG_HASH_FMIX(h);
+		idx = h & (nslots - 1);
+		while (slot[idx])
+			idx = (idx + 1) & (nslots - 1);
+		slot[idx] = i + 1;
+	}
+
+	/* walk the entries once; the first entry with a key wins, like in a
+	 * lookup. all fields with the same key are set. */
+	section_ptr = cfg_section_get(st, section);
+	ret = section_ptr ? CFG_STATUS_OK : CFG_ERROR_NOT_FOUND;
+	for (i = 0; section_ptr && i < section_ptr->nentries; i++) {
+		h = section_ptr->key_hash[i];
+		CFG_HASH_FMIX(h);
+		for (idx = h & (nslots - 1); slot[idx]; idx = (idx + 1) & (nslots - 1)) {
+			if (hash[slot[idx] - 1] != section_ptr->key_hash[i] || seen[slot[idx] - 1])
+				continue;
+			seen[slot[idx] - 1] = CFG_TRUE;
+			cfg_bind_field_set(&table[slot[idx] - 1], ptr, CFG_ENTRY_VALUE(&section_ptr->entry[i]));
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!seen[i] && table[i].def)
+			cfg_bind_field_set(&table[i], ptr, table[i].def);
+	}
+	CFG_FREE(st, slot);
+	CFG_SET_RETURN_STATUS(st, ret);
+}
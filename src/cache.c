@@ -27,10 +27,10 @@ cfg_status_t cfg_cache_size_set(cfg_t *st, cfg_uint32 size)
 	/* check if we are setting the buffer to zero length */
 	if (!size) {
 		if (st->cache)
-			free(st->cache);
+			CFG_FREE(st, st->cache);
 		st->cache = NULL;
 	} else {
-		st->cache = (cfg_entry_t **)realloc(st->cache, size * sizeof(cfg_entry_t *));
+		st->cache = (cfg_entry_t **)CFG_REALLOC(st, st->cache, size * sizeof(cfg_entry_t *));
 		if (!st->cache)
 			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
 		/* always zero the whole cache */
@@ -50,7 +50,7 @@ cfg_status_t cfg_cache_entry_add(cfg_t *st, cfg_entry_t *entry)
 
 	/* if the size is more than 1, move all the entries by one position. */
 	if (st->cache_size > 1)
-		memcpy((void *)(st->cache + 1), (void *)st->cache, (st->cache_size - 1) * sizeof(cfg_entry_t *));
+		memmove((void *)(st->cache + 1), (void *)st->cache, (st->cache_size - 1) * sizeof(cfg_entry_t *));
 	/* write the new entry at the first position. */
 	st->cache[0] = entry;
 	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
@@ -66,20 +66,6 @@ cfg_entry_t *cfg_cache_entry_nth(cfg_t *st, cfg_uint32 n)
 	return st->cache[n];
 }
 
-/* not exposed in the API */
-void cfg_cache_entry_delete(cfg_t *st, cfg_entry_t *entry)
-{
-	cfg_uint32 i;
-	for (i = 0; i < st->cache_size; i++) {
-		if (st->cache[i] != entry)
-			continue;
-		if (i < st->cache_size - 1)
-			memcpy((void *)(st->cache + i), (void *)(st->cache + i + 1), (st->cache_size - i - 1) * sizeof(cfg_entry_t *));
-		st->cache[st->cache_size - 1] = NULL;
-		return;
-	}
-}
-
 /* not exposed in the API */
 cfg_entry_t *cfg_cache_entry_get(cfg_t *st, cfg_uint32 section_hash, cfg_uint32 key_hash)
 {
@@ -0,0 +1,314 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * clone.c:
+ *	copy-on-write clones which share the sections of a frozen object
+ */
+
+#include "defines.h"
+
+/* not exposed in the API */
+void cfg_index_free(cfg_t *st);
+
+/* not exposed in the API; is 'str' in the string block shared with clones?
+ * interned names are never freed one by one, so they are not looked for. */
+cfg_bool cfg_shared_str(cfg_t *st, const cfg_char *str)
+{
+	cfg_shared_t *shared = st->shared;
+
+	return shared && shared->strings && str >= shared->strings && str < shared->strings + shared->strings_size;
+}
+
+/* not exposed in the API; the section of 'st' which holds 'entry'. a shared
+ * entry points to a section of st->shared, so the section is searched. */
+cfg_section_t *cfg_entry_section(cfg_t *st, cfg_entry_t *entry)
+{
+	cfg_section_t *section = entry->section;
+	cfg_uint32 i;
+
+	if (!st->shared || (section >= st->section && section < st->section + st->nsections))
+		return section;
+	for (i = 0; i < st->nsections; i++) {
+		section = &st->section[i];
+		if (section->shared && entry >= section->entry && entry < section->entry + section->nentries)
+			return section;
+	}
+	return NULL;
+}
+
+/* not exposed in the API; copy the entries of a shared section before the
+ * section is changed. the keys and values stay in the shared storage. */
+cfg_status_t cfg_section_unshare(cfg_t *st, cfg_section_t *section)
+{
+	cfg_entry_t *entry = NULL;
+	cfg_uint32 i, *key_hash = NULL;
+
+	if (!section->shared)
+		return CFG_STATUS_OK;
+	if (section->nentries) {
+		entry = (cfg_entry_t *)CFG_MALLOC(st, section->nentries * sizeof(cfg_entry_t));
+		key_hash = (cfg_uint32 *)CFG_MALLOC(st, section->nentries * sizeof(cfg_uint32));
+		if (!entry || !key_hash) {
+			CFG_FREE(st, entry);
+			CFG_FREE(st, key_hash);
+			return CFG_ERROR_ALLOC;
+		}
+		memcpy((void *)entry, (void *)section->entry, section->nentries * sizeof(cfg_entry_t));
+		memcpy((void *)key_hash, (void *)section->key_hash, section->nentries * sizeof(cfg_uint32));
+		for (i = 0; i < section->nentries; i++)
+			entry[i].section = section;
+	}
+	section->entry = entry;
+	section->key_hash = key_hash;
+	section->shared = CFG_FALSE;
+
+	/* the entries moved */
+	CFG_FREE(st, section->sorted);
+	section->sorted = NULL;
+	cfg_cache_clear(st);
+	cfg_index_free(st);
+	return CFG_STATUS_OK;
+}
+
+/* not exposed in the API; copy the entries of all shared sections */
+cfg_status_t cfg_sections_unshare(cfg_t *st)
+{
+	cfg_uint32 i;
+
+	for (i = 0; i < st->nsections; i++) {
+		if (cfg_section_unshare(st, &st->section[i]) != CFG_STATUS_OK)
+			return CFG_ERROR_ALLOC;
+	}
+	return CFG_STATUS_OK;
+}
+
+/* not exposed in the API; drop the reference of 'st' to the shared storage,
+ * releasing it with the last one. the sections of 'st' must not use it
+ * anymore. */
+void cfg_shared_release(cfg_t *st)
+{
+	cfg_shared_t *shared = st->shared;
+	cfg_intern_block_t *block, *next;
+	cfg_uint32 i;
+
+	if (!shared)
+		return;
+	st->shared = NULL;
+	if (cfg_atomic_add(&shared->refs, -1))
+		return;
+	for (i = 0; i < shared->nsections; i++) {
+		CFG_FREE(st, shared->section[i].entry);
+		CFG_FREE(st, shared->section[i].key_hash);
+	}
+	CFG_FREE(st, shared->section);
+	CFG_FREE(st, shared->strings);
+	for (block = shared->block; block; block = next) {
+		next = block->next;
+		CFG_FREE(st, block);
+	}
+	CFG_FREE(st, shared->slot);
+	CFG_FREE(st, shared);
+}
+
+/* move the sections and strings of 'st' into a new shared storage; 'st'
+ * keeps a copy of its section array which points to the shared entries.
+ * the entries are not touched, so they stay where the cache and the index
+ * expect them. */
+static cfg_status_t cfg_clone_freeze(cfg_t *st)
+{
+	cfg_shared_t *shared;
+	cfg_section_t *section = NULL;
+	cfg_uint32 i;
+
+	/* all values are unescaped here, as shared entries are never changed */
+	if (cfg_sections_materialize(st) != CFG_STATUS_OK || cfg_shrink(st) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	shared = (cfg_shared_t *)cfg_mem_calloc(st, 1, sizeof(cfg_shared_t));
+	if (!shared)
+		return CFG_ERROR_ALLOC;
+	if (st->nsections) {
+		section = (cfg_section_t *)CFG_MALLOC(st, st->nsections * sizeof(cfg_section_t));
+		if (!section) {
+			CFG_FREE(st, shared);
+			return CFG_ERROR_ALLOC;
+		}
+	}
+	if (st->intern) {
+		shared->slot = (cfg_intern_slot_t *)CFG_MALLOC(st, st->intern->nslots * sizeof(cfg_intern_slot_t));
+		if (!shared->slot) {
+			CFG_FREE(st, section);
+			CFG_FREE(st, shared);
+			return CFG_ERROR_ALLOC;
+		}
+		memcpy((void *)shared->slot, (void *)st->intern->slot, st->intern->nslots * sizeof(cfg_intern_slot_t));
+		shared->nslots = st->intern->nslots;
+		shared->count = st->intern->count;
+		shared->block = st->intern->block;
+		st->intern->block = NULL;
+		st->intern->pos = NULL;
+		st->intern->end = NULL;
+	}
+
+	if (st->nsections)
+		memcpy((void *)section, (void *)st->section, st->nsections * sizeof(cfg_section_t));
+	for (i = 0; i < st->nsections; i++) {
+		st->section[i].sorted = NULL; /* stays with the copy */
+		section[i].shared = CFG_TRUE;
+	}
+	shared->refs = 1;
+	shared->nsections = st->nsections;
+	shared->section = st->section;
+	shared->strings = st->strings;
+	shared->strings_size = st->strings_size;
+	st->section = section;
+	st->strings = NULL;
+	st->strings_size = 0;
+	st->shared = shared;
+	return CFG_STATUS_OK;
+}
+
+/* a copy of a key, value or name of 'st' for 'clone'; shared strings are not
+ * copied */
+static cfg_char *cfg_clone_str(cfg_t *clone, cfg_char *str, cfg_bool name)
+{
+	if (!str || cfg_shared_str(clone, str))
+		return str;
+	return name ? cfg_name_dup(clone, str, NULL) : cfg_mem_strdup(clone, str);
+}
+
+/* copy a section of 'st' which is not shared; its entries were changed since
+ * 'st' was frozen */
+static cfg_status_t cfg_clone_section(cfg_t *clone, cfg_section_t *to, cfg_section_t *from)
+{
+	cfg_entry_t *entry;
+	cfg_uint32 j;
+
+	to->entry = (cfg_entry_t *)cfg_mem_calloc(clone, from->nentries, sizeof(cfg_entry_t));
+	to->key_hash = (cfg_uint32 *)CFG_MALLOC(clone, from->nentries * sizeof(cfg_uint32));
+	if (!to->entry || !to->key_hash)
+		return CFG_ERROR_ALLOC;
+	memcpy((void *)to->key_hash, (void *)from->key_hash, from->nentries * sizeof(cfg_uint32));
+	/* the count is raised per entry, so a partial copy stays freeable */
+	for (j = 0; j < from->nentries; j++) {
+		entry = &to->entry[j];
+		entry->key_hash = from->entry[j].key_hash;
+		entry->flags = from->entry[j].flags;
+		entry->section = to;
+		entry->key = cfg_clone_str(clone, from->entry[j].key, CFG_TRUE);
+		if (!entry->key)
+			return CFG_ERROR_ALLOC;
+		entry->value = cfg_clone_str(clone, from->entry[j].value, CFG_FALSE);
+		to->nentries++;
+		if (!entry->value)
+			return CFG_ERROR_ALLOC;
+	}
+	return CFG_STATUS_OK;
+}
+
+/* copy the settings of 'st' and its interning table as it was frozen */
+static cfg_status_t cfg_clone_settings(cfg_t *clone, cfg_t *st)
+{
+	clone->verbose = st->verbose;
+	clone->nthreads = st->nthreads;
+	clone->lazy = st->lazy;
+	clone->duplicates = st->duplicates;
+	if (cfg_cache_size_set(clone, st->cache_size) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	if (st->snapshot_dir && cfg_snapshot_dir_set(clone, st->snapshot_dir) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	if (st->diagnostics.size && cfg_diagnostics_set(clone, st->diagnostics.size) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	if (!st->intern)
+		return CFG_STATUS_OK;
+	if (cfg_intern_set(clone, CFG_TRUE) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	/* the table of a storage frozen with interning off stays empty; then no
+	 * section is shared, as enabling it copied all sections */
+	if (st->shared->slot) {
+		CFG_FREE(clone, clone->intern->slot);
+		clone->intern->slot = (cfg_intern_slot_t *)CFG_MALLOC(clone, st->shared->nslots * sizeof(cfg_intern_slot_t));
+		if (!clone->intern->slot) {
+			clone->intern->nslots = 0;
+			return CFG_ERROR_ALLOC;
+		}
+		memcpy((void *)clone->intern->slot, (void *)st->shared->slot, st->shared->nslots * sizeof(cfg_intern_slot_t));
+		clone->intern->nslots = st->shared->nslots;
+		clone->intern->count = st->shared->count;
+	}
+	return CFG_STATUS_OK;
+}
+
+cfg_t *cfg_clone(cfg_t *st)
+{
+	cfg_t *clone;
+	cfg_section_t *to, *from;
+	cfg_uint32 i;
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_clone", NULL);
+	CFG_CHECK_ASYNC_RETURN(st, NULL);
+
+	if (!st->shared) {
+		ret = cfg_clone_freeze(st);
+		if (ret != CFG_STATUS_OK) {
+			CFG_SET_STATUS(st, ret);
+			return NULL;
+		}
+	}
+	clone = cfg_alloc_ex(&st->allocator);
+	if (!clone) {
+		CFG_SET_STATUS(st, CFG_ERROR_ALLOC);
+		return NULL;
+	}
+	clone->shared = st->shared;
+	cfg_atomic_add(&st->shared->refs, 1);
+	ret = cfg_clone_settings(clone, st);
+	if (ret != CFG_STATUS_OK)
+		goto exit;
+
+	if (st->nsections) {
+		clone->section = (cfg_section_t *)CFG_MALLOC(clone, st->nsections * sizeof(cfg_section_t));
+		if (!clone->section) {
+			ret = CFG_ERROR_ALLOC;
+			goto exit;
+		}
+	}
+	/* a section is counted once it is consistent, so a partial clone can be
+	 * freed */
+	for (i = 0; i < st->nsections; i++) {
+		from = &st->section[i];
+		to = &clone->section[i];
+		*to = *from;
+		to->sorted = NULL;
+		to->name = cfg_clone_str(clone, from->name, CFG_TRUE);
+		if (from->name && !to->name) {
+			ret = CFG_ERROR_ALLOC;
+			break;
+		}
+		if (!from->shared) {
+			to->nentries = 0;
+			to->entry = NULL;
+			to->key_hash = NULL;
+		}
+		clone->nsections++;
+		if (!from->shared && from->nentries) {
+			ret = cfg_clone_section(clone, to, from);
+			if (ret != CFG_STATUS_OK)
+				break;
+		}
+	}
+
+exit:
+	if (ret != CFG_STATUS_OK) {
+		cfg_free(clone);
+		CFG_SET_STATUS(st, ret);
+		return NULL;
+	}
+	CFG_SET_STATUS(st, CFG_STATUS_OK);
+	return clone;
+}
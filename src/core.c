@@ -12,10 +12,17 @@
 
 #include "defines.h"
 
+/* not exposed in the API */
+void cfg_index_free(cfg_t *st);
+cfg_status_t cfg_snapshot_stamp_get(const cfg_char *filename, cfg_snapshot_stamp_t *stamp);
+cfg_status_t cfg_snapshot_load(cfg_t *st, const cfg_char *filename, const cfg_snapshot_stamp_t *stamp);
+cfg_status_t cfg_snapshot_save(cfg_t *st, const cfg_char *filename, const cfg_snapshot_stamp_t *stamp);
+
 static void cfg_init(cfg_t *st)
 {
 	st->separator_key_value = CFG_SEPARATOR_KEY_VALUE;
 	st->separator_section = CFG_SEPARATOR_SECTION;
+	st->separator_raw = CFG_SEPARATOR_RAW;
 	st->comment_char1 = CFG_COMMENT_CHAR1;
 	st->comment_char2 = CFG_COMMENT_CHAR2;
 
@@ -27,20 +34,73 @@ static void cfg_init(cfg_t *st)
 
 	st->cache = NULL;
 	st->cache_size = CFG_CACHE_SIZE;
+
+	st->index = NULL;
+	st->snapshot_dir = NULL;
+	st->intern = NULL;
+	st->nthreads = 1;
+	st->generation = 0;
+	st->lazy = CFG_FALSE;
+	st->lazy_buf = NULL;
+	st->lazy_size = 0;
+	st->duplicates = CFG_DUPLICATES_KEEP;
+	st->strings = NULL;
+	st->strings_size = 0;
+	st->shared = NULL;
+	st->diagnostics.ring = &st->diagnostics.scratch;
+	st->diagnostics.size = 0;
+	st->diagnostics.mask = 0;
+	st->diagnostics.count = 0;
 }
 
-cfg_t *cfg_alloc(void)
+static void *cfg_default_malloc(void *ctx, size_t size)
+{
+	(void)ctx;
+	return malloc(size);
+}
+
+static void *cfg_default_realloc(void *ctx, void *ptr, size_t size)
 {
-	cfg_t *st = (cfg_t *)calloc(1, sizeof(cfg_t));
+	(void)ctx;
+	return realloc(ptr, size);
+}
+
+static void cfg_default_free(void *ctx, void *ptr)
+{
+	(void)ctx;
+	free(ptr);
+}
+
+static const cfg_allocator_t cfg_default_allocator = {
+	cfg_default_malloc,
+	cfg_default_realloc,
+	cfg_default_free,
+	NULL
+};
+
+cfg_t *cfg_alloc_ex(const cfg_allocator_t *allocator)
+{
+	cfg_t *st;
+
+	if (!allocator)
+		allocator = &cfg_default_allocator;
+	st = (cfg_t *)allocator->malloc_fn(allocator->ctx, sizeof(cfg_t));
 	if (!st) {
-		fprintf(stderr, "[cfg2] cfg_alloc(): cannot calloc() a cfg_t object!\n");
+		fprintf(stderr, "[cfg2] cfg_alloc_ex(): cannot allocate a cfg_t object!\n");
 		return NULL;
 	}
+	memset((void *)st, 0, sizeof(cfg_t));
+	st->allocator = *allocator;
 	cfg_init(st);
 	cfg_cache_size_set(st, st->cache_size);
 	return st;
 }
 
+cfg_t *cfg_alloc(void)
+{
+	return cfg_alloc_ex(NULL);
+}
+
 cfg_status_t cfg_verbose_set(cfg_t *st, cfg_uint32 level)
 {
 	CFG_CHECK_ST_RETURN(st, "cfg_verbose_set", CFG_ERROR_NULL_PTR);
@@ -48,6 +108,15 @@ cfg_status_t cfg_verbose_set(cfg_t *st, cfg_uint32 level)
 	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
 }
 
+cfg_status_t cfg_duplicates_set(cfg_t *st, cfg_duplicates_t policy)
+{
+	CFG_CHECK_ST_RETURN(st, "cfg_duplicates_set", CFG_ERROR_NULL_PTR);
+	if (policy > CFG_DUPLICATES_LAST)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_OUT_OF_RANGE);
+	st->duplicates = policy;
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
 cfg_status_t cfg_status_get(cfg_t *st)
 {
 	CFG_CHECK_ST_RETURN(st, "cfg_status_get", CFG_ERROR_NULL_PTR);
@@ -60,58 +129,224 @@ static void cfg_memory_free(cfg_t *st)
 	cfg_entry_t *entry;
 	cfg_uint32 i, j;
 
+	cfg_index_free(st);
 	for (i = 0; i < st->nsections; i++) {
 		section = &st->section[i];
+		cfg_name_free(st, section->name);
+		CFG_FREE(st, section->sorted);
+		if (section->shared)
+			continue;
 		for (j = 0; j < section->nentries; j++) {
 			entry = &section->entry[j];
-			free(entry->key);
-			free(entry->value);
+			cfg_name_free(st, entry->key);
+			cfg_str_free(st, entry->value);
 		}
-		free(section->name);
-		free(section->entry);
+		CFG_FREE(st, section->entry);
+		CFG_FREE(st, section->key_hash);
 	}
-	free(st->section);
+	CFG_FREE(st, st->section);
 	st->section = NULL;
 	st->nsections = 0;
+	CFG_FREE(st, st->lazy_buf);
+	st->lazy_buf = NULL;
+	CFG_FREE(st, st->strings);
+	st->strings = NULL;
+	st->strings_size = 0;
+	cfg_shared_release(st);
+	cfg_intern_clear(st);
 
 	if (st->cache) {
-		free(st->cache);
+		CFG_FREE(st, st->cache);
 		st->cache = NULL;
 	}
 }
 
+/* not exposed in the API; move the sections and strings of 'from' into 'to',
+ * which has none. both use the same allocator and interning setting. the
+ * cache and index of 'from' must be dropped afterwards. */
+void cfg_tree_move(cfg_t *to, cfg_t *from)
+{
+	cfg_intern_t *intern;
+
+	to->section = from->section;
+	to->nsections = from->nsections;
+	to->lazy_buf = from->lazy_buf;
+	to->lazy_size = from->lazy_size;
+	to->strings = from->strings;
+	to->strings_size = from->strings_size;
+	to->shared = from->shared;
+	from->section = NULL;
+	from->nsections = 0;
+	from->lazy_buf = NULL;
+	from->strings = NULL;
+	from->strings_size = 0;
+	from->shared = NULL;
+	/* the interned names go along; 'from' gets the empty table of 'to' */
+	intern = to->intern;
+	to->intern = from->intern;
+	from->intern = intern;
+}
+
 cfg_status_t cfg_clear(cfg_t *st)
 {
+	cfg_status_t ret;
+
 	CFG_CHECK_ST_RETURN(st, "cfg_clear", CFG_ERROR_NULL_PTR);
+	/* subscribers get the removed keys, or the changes of a reload at its end */
+	if (st->subs) {
+		cfg_changes_begin(st);
+		cfg_changes_save(st);
+	}
 	cfg_memory_free(st);
-	return cfg_cache_size_set(st, st->cache_size);
+	st->diagnostics.count = 0;
+	ret = cfg_cache_size_set(st, st->cache_size);
+	if (st->subs)
+		cfg_changes_end(st);
+	return ret;
 }
 
 cfg_status_t cfg_free(cfg_t *st)
 {
 	CFG_CHECK_ST_RETURN(st, "cfg_free", CFG_ERROR_NULL_PTR);
+	/* the parse still uses the allocator of 'st' */
+	if (st->async)
+		cfg_parse_finish(st, CFG_FALSE);
+	cfg_subs_free(st);
 	cfg_memory_free(st);
-	free(st);
+	cfg_intern_free(st);
+	CFG_FREE(st, st->snapshot_dir);
+	cfg_diagnostics_free(st);
+	st->allocator.free_fn(st->allocator.ctx, (void *)st);
 	return CFG_STATUS_OK;
 }
 
-static void cfg_raw_buffer_parse(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_uint32 sections, cfg_uint32 **entries)
+/* sections with up to this many entries are checked for duplicate keys
+ * without a table */
+#define CFG_DUPLICATES_SCAN_MAX 32
+
+/* not exposed in the API; parse the 'nentries' entries of a section from a
+ * converted buffer, starting at 'p'. returns the position after the last
+ * entry. the separators are restored, so the buffer can be parsed again.
+ * a broken buffer can end before all entries; 'nentries' is then reduced.
+ * unless all duplicates are kept, each key is looked up among the entries
+ * stored so far before anything is allocated for it. */
+cfg_char *cfg_raw_section_parse(cfg_t *st, cfg_section_t *section, cfg_char *p)
 {
-	cfg_uint32 idx_section = 0;
-	cfg_uint32 idx_entry = 0;
+	cfg_merge_table_t table;
 	cfg_entry_t *entry;
-	cfg_char *p, *end;
+	cfg_char *end, *key, c;
+	cfg_uint32 i, n, k, flags, hash, *slot = NULL;
+	void *ptr;
+
+	/* without a table the stored key hashes are scanned */
+	table.slot = NULL;
+	if (st->duplicates != CFG_DUPLICATES_KEEP && section->nentries > CFG_DUPLICATES_SCAN_MAX)
+		cfg_merge_table_init(st, &table, section->nentries);
+
+	for (i = n = 0; n < section->nentries && *p; n++) {
+		/* parse key */
+		end = p;
+		end++;
+		while (*end && *end != st->separator_key_value && *end != st->separator_raw)
+			end++;
+		if (!*end)
+			break;
+		flags = *end == st->separator_raw ? CFG_ENTRY_RAW : 0;
+		*end = '\0';
+		key = p;
+		k = i;
+		if (st->duplicates != CFG_DUPLICATES_KEEP) {
+			hash = cfg_hash_get(key);
+			if (table.slot) {
+				slot = cfg_merge_table_find(&table, section->key_hash, hash);
+				k = *slot ? *slot - 1 : i;
+			} else {
+				k = cfg_hash_find(section->key_hash, i, hash);
+			}
+		}
+		entry = &section->entry[k];
+		if (k == i) {
+			entry->section = section;
+			entry->key = cfg_name_dup(st, key, &entry->key_hash);
+			section->key_hash[i] = entry->key_hash;
+			if (table.slot)
+				*slot = i + 1;
+		}
+		*end = flags ? st->separator_raw : st->separator_key_value;
+		end++;
+		p = end;
+
+		/* parse value; a repeated key keeps its first value or takes the
+		 * new one in place */
+		while (*end && *end != st->separator_key_value)
+			end++;
+		if (k == i || st->duplicates == CFG_DUPLICATES_LAST) {
+			if (k != i)
+				cfg_str_free(st, entry->value);
+			c = *end;
+			*end = '\0';
+			entry->flags = flags;
+			entry->value = cfg_mem_strdup(st, p);
+			*end = c;
+		}
+		if (k == i)
+			i++;
+		p = *end ? end + 1 : end;
+	}
+	CFG_FREE(st, table.slot);
+
+	/* trim the arrays if keys were dropped */
+	if (i && i < n) {
+		ptr = CFG_REALLOC(st, section->entry, i * sizeof(cfg_entry_t));
+		if (ptr)
+			section->entry = (cfg_entry_t *)ptr;
+		ptr = CFG_REALLOC(st, section->key_hash, i * sizeof(cfg_uint32));
+		if (ptr)
+			section->key_hash = (cfg_uint32 *)ptr;
+	}
+	section->nentries = i;
+	return p;
+}
+
+/* skip the 'n' entries of a section in a converted buffer, like
+ * cfg_raw_section_parse() */
+static cfg_char *cfg_raw_section_skip(cfg_t *st, cfg_char *p, cfg_uint32 n)
+{
+	for (; n && *p; n--) {
+		p++;
+		while (*p && *p != st->separator_key_value && *p != st->separator_raw)
+			p++;
+		if (!*p)
+			break;
+		p++;
+		while (*p && *p != st->separator_key_value)
+			p++;
+		if (*p)
+			p++;
+	}
+	return p;
+}
+
+static void cfg_raw_buffer_parse(cfg_t *st, cfg_char *buf, size_t sz, cfg_uint32 sections, cfg_uint32 **entries)
+{
+	cfg_char *p, *end, c;
 	cfg_uint32 i, *entry_ptr;
 	cfg_section_t *section;
 
-	/* allocate section and entry buffers */
+	/* allocate section and entry buffers. in lazy mode only the position
+	 * and the number of entries of each section are kept (see lazy.c). */
 	entry_ptr = *entries;
 	st->nsections = sections;
-	st->section = (cfg_section_t *)malloc(sections * sizeof(cfg_section_t));
+	st->section = (cfg_section_t *)CFG_MALLOC(st, sections * sizeof(cfg_section_t));
 	for (i = 0; i < sections; i++) {
 		section = &st->section[i];
-		section->nentries = entry_ptr[i];
-		section->entry = !section->nentries ? NULL : (cfg_entry_t *)malloc(section->nentries * sizeof(cfg_entry_t));
+		section->nentries = st->lazy_buf ? 0 : entry_ptr[i];
+		section->entry = !section->nentries ? NULL : (cfg_entry_t *)CFG_MALLOC(st, section->nentries * sizeof(cfg_entry_t));
+		section->key_hash = !section->nentries ? NULL : (cfg_uint32 *)CFG_MALLOC(st, section->nentries * sizeof(cfg_uint32));
+		section->sorted = NULL;
+		section->raw = NULL;
+		section->nraw = st->lazy_buf ? entry_ptr[i] : 0;
+		section->shared = CFG_FALSE;
 	}
 
 	/* prepare the root section */
@@ -119,86 +354,155 @@ static void cfg_raw_buffer_parse(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_ui
 	section->name = CFG_ROOT_SECTION;
 	section->hash = CFG_ROOT_SECTION_HASH;
 
-	for (p = buf; p < buf + sz; p++) {
+	p = buf;
+	for (i = 0; i < sections; i++) {
 		/* store a new section */
-		if (*p == st->separator_section) {
+		if (i) {
+			while (p < buf + sz && *p && *p != st->separator_section)
+				p++;
+			/* a broken buffer can end before all sections */
+			if (p >= buf + sz || !*p) {
+				st->nsections = i;
+				for (; i < sections; i++) {
+					CFG_FREE(st, st->section[i].entry);
+					CFG_FREE(st, st->section[i].key_hash);
+				}
+				break;
+			}
 			p++;
 			end = p;
-			while (*end != st->separator_section)
+			while (*end && *end != st->separator_section)
 				end++;
+			c = *end;
 			*end = '\0';
-			idx_entry = 0;
-			idx_section++;
-			section = &st->section[idx_section];
-			section->name = cfg_strdup(p);
-			section->hash = cfg_hash_get(p);
-			*end = st->separator_section;
-			p = end;
-			/* if next character is not a section start skip */
-			if (*(p + 1) != st->separator_section)
-				p++;
+			section = &st->section[i];
+			section->name = cfg_name_dup(st, p, &section->hash);
+			*end = c;
+			p = c ? end + 1 : end;
 		}
+		if (section->nraw) {
+			section->raw = p;
+			p = cfg_raw_section_skip(st, p, section->nraw);
+		} else {
+			p = cfg_raw_section_parse(st, section, p);
+		}
+	}
+}
 
-		/* nentries is reached skip */
-		if (idx_entry == section->nentries)
-			continue;
-
-		/* a new entry */
-		entry = &section->entry[idx_entry];
-		entry->section = section;
-		idx_entry++;
+/* copy the value after the '=' at 'src' to 'dest' as is, if it is on a single
+ * line and none of its characters end an entry or start a section. if it has
+ * escapes, quotes or whitespace the separator before it becomes 'separator_raw'
+ * and it is unescaped on its first read (cfg_entry_value_unescape()). returns
+ * the last character used, or 'src' to leave the value to the caller. */
+static cfg_char *cfg_raw_value_copy(cfg_t *st, cfg_char *src, cfg_char *end, cfg_char **dest)
+{
+	cfg_char *p;
+	cfg_bool raw = CFG_FALSE, quote = CFG_FALSE;
 
-		/* parse key */
-		end = p;
-		end++;
-		while (*end != st->separator_key_value)
-			end++;
-		*end = '\0';
+	for (p = src + 1; p < end && *p != '\n' && *p != '\r'; p++) {
+		switch (*p) {
+		case '\\':
+			/* line continuations are left to the caller */
+			if (++p == end || *p == '\n' || *p == '\r' || *p == ' ' ||
+			    *p == st->separator_section || *p == st->separator_key_value || *p == st->separator_raw)
+				return src;
+			raw = CFG_TRUE;
+			break;
+		case '"':
+			quote = !quote;
+			raw = CFG_TRUE;
+			break;
+		case ' ':
+		case '\t':
+			raw = CFG_TRUE;
+			break;
+		case '[':
+		case ']':
+		case '=':
+			return src;
+		default:
+			if (*p == st->separator_section || *p == st->separator_key_value || *p == st->separator_raw)
+				return src;
+		}
+	}
+	/* the caller warns about the quote */
+	if (quote)
+		return src;
 
-		entry->key = cfg_strdup(p);
-		*end = st->separator_key_value;
-		end++;
-		p = end;
+	if (raw)
+		*(*dest - 1) = st->separator_raw;
+	memmove(*dest, src + 1, p - src - 1);
+	*dest += p - src - 1;
+	return p - 1;
+}
 
-		entry->key_hash = cfg_hash_get(entry->key);
+/* not exposed in the API; unescape a value copied by cfg_raw_value_copy() in
+ * place, the same way as cfg_raw_buffer_convert() */
+cfg_char *cfg_entry_value_unescape(cfg_entry_t *entry)
+{
+	cfg_char *src, *dest;
+	cfg_bool escape = CFG_FALSE, quote = CFG_FALSE;
 
-		/* parse value */
-		while (*end != st->separator_key_value)
-			end++;
-		*end = '\0';
-		entry->value = cfg_strdup(p);
-		*end = st->separator_key_value;
-		p = end;
+	entry->flags &= ~CFG_ENTRY_RAW;
+	for (src = dest = entry->value; *src; src++) {
+		if (escape) {
+			escape = CFG_FALSE;
+			*dest++ = *src == 'n' ? '\n' : *src;
+			continue;
+		}
+		switch (*src) {
+		case '\\':
+			escape = CFG_TRUE;
+			continue;
+		case '"':
+			quote = !quote;
+			continue;
+		case ' ':
+		case '\t':
+			if (!quote)
+				continue;
+		}
+		*dest++ = *src;
 	}
+	*dest = '\0';
+	return entry->value;
 }
 
 #define CFG_UNESCAPE_CHECK_QUOTE() \
-	if (quote && st->verbose > 0) \
-		fprintf(stderr, "%s: WARNING: quote not closed at line %d\n", fname, line); \
+	if (quote) \
+		cfg_diagnostic_add(diag, CFG_DIAGNOSTIC_QUOTE_NOT_CLOSED, line, (cfg_uint32)(src - line_start + 1)); \
 	quote = CFG_FALSE;
 
-/* unescape all special characters (like \n) in a string and convert to a raw buffer */
-static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, cfg_uint32 buf_sz, cfg_uint32 *sections, cfg_uint32 **entries)
+/* unescape all special characters (like \n) in a string and convert to a raw
+ * buffer; the warnings replace the ones in 'diag' */
+static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, size_t buf_sz, cfg_uint32 *sections, cfg_uint32 **entries,
+	cfg_diagnostics_t *diag)
 {
 	static const cfg_char *fname = "[cfg2] cfg_raw_buffer_convert()";
-	cfg_uint32 line = 0, allocated, *entry_ptr, tmp_sz;
-	cfg_char *src, *dest, last_char = 0;
+	cfg_uint32 line = 0, allocated, *entry_ptr;
+	size_t tmp_sz;
+	cfg_char *src, *dest, *line_start = buf, last_char = 0;
 	cfg_bool escape = CFG_FALSE;
 	cfg_bool quote = CFG_FALSE;
 	cfg_bool line_eq_sign = CFG_FALSE;
 	cfg_bool multiline = CFG_FALSE;
 	cfg_bool section_line = CFG_FALSE;
+	/* separators written, for knowing if cfg_raw_buffer_parse() will see
+	 * a '=' as the end of a key */
+	cfg_uint32 nseparators = 0, nsection_separators = 0;
+
+	diag->count = 0;
 
 	/* prepare the root section */
 	allocated = 1;
-	*entries = (cfg_uint32 *)malloc(allocated * sizeof(cfg_uint32));
+	*entries = (cfg_uint32 *)CFG_MALLOC(st, allocated * sizeof(cfg_uint32));
 	entry_ptr = *entries;
 	entry_ptr[0] = 0;
 	*sections = 1;
 
 	for (src = dest = buf; src < buf + buf_sz; src++) {
 		/* convert separators to spaces, if found */
-		if (*src == st->separator_section || *src == st->separator_key_value) {
+		if (*src == st->separator_section || *src == st->separator_key_value || *src == st->separator_raw) {
 			*src = ' ';
 			continue;
 		}
@@ -210,12 +514,14 @@ static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, cfg_uint32 buf_sz,
 		/* start of a line */
 		if (last_char == '\n' || src == buf) {
 			line++;
+			line_start = src;
 			if (!multiline)
 				line_eq_sign = CFG_FALSE;
 			/* skip empty lines */
 			while (*src == '\n' || *src == ' ' || *src == '\t') {
 				if (*src == '\n') {
 					line++;
+					line_start = src + 1;
 					line_eq_sign = CFG_FALSE;
 				}
 				src++;
@@ -227,6 +533,7 @@ static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, cfg_uint32 buf_sz,
 				while (*src != '\n')
 					src++;
 				src++;
+				line_start = src;
 			}
 		}
 
@@ -259,22 +566,25 @@ static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, cfg_uint32 buf_sz,
 				continue;
 			case '=':
 				CFG_UNESCAPE_CHECK_QUOTE();
-				line_eq_sign = CFG_TRUE;
 				entry_ptr[*sections - 1]++;
 				*dest = st->separator_key_value;
 				dest++;
+				if (!line_eq_sign && !section_line && !(nseparators & 1) && !(nsection_separators & 1))
+					src = cfg_raw_value_copy(st, src, buf + buf_sz, &dest);
+				nseparators++;
+				line_eq_sign = CFG_TRUE;
 				continue;
 			case '\n':
 				multiline = CFG_FALSE;
 				if (!section_line) {
 					if (!line_eq_sign && !quote) {
-						if (st->verbose > 0)
-							fprintf(stderr, "%s: WARNING: no equal sign at line %d\n", fname, line);
+						cfg_diagnostic_add(diag, CFG_DIAGNOSTIC_NO_EQUAL_SIGN, line, (cfg_uint32)(src - line_start + 1));
 						continue;
 					}
 					CFG_UNESCAPE_CHECK_QUOTE();
 					*dest = st->separator_key_value;
 					dest++;
+					nseparators++;
 				}
 				section_line = CFG_FALSE;
 				continue;
@@ -283,9 +593,9 @@ static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, cfg_uint32 buf_sz,
 				if ((*sections + 1) > allocated) {
 					allocated <<= 1;
 					tmp_sz = allocated * sizeof(cfg_uint32);
-					*entries = (cfg_uint32 *)realloc(*entries, tmp_sz);
+					*entries = (cfg_uint32 *)CFG_REALLOC(st, *entries, tmp_sz);
 					if (!*entries) {
-						fprintf(stderr, "%s: ERROR: cannot realloc() %d bytes\n", fname, tmp_sz);
+						fprintf(stderr, "%s: ERROR: cannot realloc() %lu bytes\n", fname, (unsigned long)tmp_sz);
 						return;
 					}
 				}
@@ -296,6 +606,8 @@ static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, cfg_uint32 buf_sz,
 				CFG_UNESCAPE_CHECK_QUOTE();
 				*dest = st->separator_section;
 				dest++;
+				nseparators = 0;
+				nsection_separators++;
 				continue;
 			}
 		}
@@ -308,26 +620,31 @@ static void cfg_raw_buffer_convert(cfg_t *st, cfg_char *buf, cfg_uint32 buf_sz,
 	}
 	*dest = '\0';
 	tmp_sz = *sections * sizeof(cfg_uint32);
-	*entries = (cfg_uint32 *)realloc(*entries, tmp_sz); /* trim */
+	*entries = (cfg_uint32 *)CFG_REALLOC(st, *entries, tmp_sz); /* trim */
 	if (!*entries) {
-		fprintf(stderr, "%s: ERROR: cannot realloc() %d bytes\n", fname, tmp_sz);
+		fprintf(stderr, "%s: ERROR: cannot realloc() %lu bytes\n", fname, (unsigned long)tmp_sz);
 		return;
 	}
-	if (st->verbose > 1)
-		fprintf(stderr, "%s:\n%s\n", fname, buf);
 }
 
 cfg_status_t cfg_buffer_parse(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_bool copy)
+{
+	return cfg_buffer_parse64(st, buf, sz, copy);
+}
+
+cfg_status_t cfg_buffer_parse64(cfg_t *st, cfg_char *buf, size_t sz, cfg_bool copy)
 {
 	cfg_status_t ret;
 	cfg_char *newbuf;
 	cfg_uint32 sections, *entries = NULL;
 
-	CFG_CHECK_ST_RETURN(st, "cfg_buffer_parse", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ST_RETURN(st, "cfg_buffer_parse64", CFG_ERROR_NULL_PTR);
 
-	/* set buffer */
-	if (copy) {
-		newbuf = (cfg_char *)malloc(sz + 1);
+	/* set buffer; lazy parsing keeps its own copy */
+	if (copy || st->lazy) {
+		if (sz == (size_t)-1)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_OUT_OF_RANGE);
+		newbuf = (cfg_char *)CFG_MALLOC(st, sz + 1);
 		if (!newbuf)
 			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
 		memcpy(newbuf, buf, sz);
@@ -336,26 +653,125 @@ cfg_status_t cfg_buffer_parse(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_bool
 		newbuf = buf;
 	}
 
-	/* clear old keys */
+	/* clear old keys; subscribers get the changes once the new ones are in */
+	if (st->subs)
+		cfg_changes_begin(st);
 	ret = cfg_clear(st);
-	if (ret != CFG_STATUS_OK)
-		CFG_SET_RETURN_STATUS(st, ret);
+	if (ret == CFG_STATUS_OK) {
+		cfg_raw_buffer_convert(st, newbuf, sz, &sections, &entries, &st->diagnostics);
+		if (st->lazy) {
+			st->lazy_buf = newbuf;
+			st->lazy_size = sz + 1;
+		}
+		cfg_raw_buffer_parse(st, newbuf, sz, sections, &entries);
+		CFG_FREE(st, entries);
+	}
+	if (st->subs)
+		cfg_changes_end(st);
+
+	if (copy && !st->lazy)
+		CFG_FREE(st, newbuf);
+	else if (ret != CFG_STATUS_OK && newbuf != buf)
+		CFG_FREE(st, newbuf);
+	CFG_SET_RETURN_STATUS(st, ret);
+}
+
+/* pass the entries of a raw buffer to a callback; the separators after each
+ * name and value are replaced with NUL characters. keys and section names are
+ * hashed while searching for their end. */
+static void cfg_raw_buffer_scan(cfg_t *st, cfg_char *buf, cfg_scan_cb_t cb, void *ctx)
+{
+	cfg_char *p = buf, *section = CFG_ROOT_SECTION, *key, *value;
+	cfg_uint32 section_hash = CFG_ROOT_SECTION_HASH, key_hash;
+	cfg_entry_t entry; /* only for unescaping values */
+
+	while (*p) {
+		/* a new section */
+		if (*p == st->separator_section) {
+			section = ++p;
+			section_hash = CFG_HASH_SEED;
+			for (; *p && *p != st->separator_section; p++) {
+				section_hash *= section_hash;
+				section_hash ^= *p;
+			}
+			if (!*p)
+				return;
+			*p++ = '\0';
+			continue;
+		}
+
+		key = p;
+		key_hash = CFG_HASH_SEED;
+		for (; *p && *p != st->separator_key_value && *p != st->separator_raw; p++) {
+			key_hash *= key_hash;
+			key_hash ^= *p;
+		}
+		if (!*p)
+			return;
+		entry.flags = *p == st->separator_raw ? CFG_ENTRY_RAW : 0;
+		*p++ = '\0';
+
+		/* the last value may end the buffer without a separator */
+		value = entry.value = p;
+		while (*p && *p != st->separator_key_value)
+			p++;
+		if (*p)
+			*p++ = '\0';
+		if (entry.flags & CFG_ENTRY_RAW)
+			cfg_entry_value_unescape(&entry);
+
+		if (!cb(ctx, section, section_hash, key, key_hash, value))
+			return;
+	}
+}
+
+cfg_status_t cfg_buffer_scan(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_bool copy, cfg_scan_cb_t cb, void *ctx)
+{
+	return cfg_buffer_scan64(st, buf, sz, copy, cb, ctx);
+}
+
+cfg_status_t cfg_buffer_scan64(cfg_t *st, cfg_char *buf, size_t sz, cfg_bool copy, cfg_scan_cb_t cb, void *ctx)
+{
+	cfg_char *newbuf;
+	cfg_uint32 sections, *entries = NULL;
+	cfg_diagnostics_t diag;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_buffer_scan64", CFG_ERROR_NULL_PTR);
+	if (!buf || !cb)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+
+	if (copy) {
+		if (sz == (size_t)-1)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_OUT_OF_RANGE);
+		newbuf = (cfg_char *)CFG_MALLOC(st, sz + 1);
+		if (!newbuf)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+		memcpy(newbuf, buf, sz);
+		newbuf[sz] = '\0';
+	} else {
+		newbuf = buf;
+	}
 
-	cfg_raw_buffer_convert(st, newbuf, sz, &sections, &entries);
-	cfg_raw_buffer_parse(st, newbuf, sz, sections, &entries);
-	free(entries);
+	/* the warnings of a scan are not kept; the ones of the last parse stay */
+	diag.ring = &diag.scratch;
+	diag.mask = 0;
+	cfg_raw_buffer_convert(st, newbuf, sz, &sections, &entries, &diag);
+	CFG_FREE(st, entries);
+	cfg_raw_buffer_scan(st, newbuf, cb, ctx);
 
 	if (copy)
-		free(newbuf);
-	CFG_SET_RETURN_STATUS(st, ret);
+		CFG_FREE(st, newbuf);
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
 }
 
 #define F_READ_BLOCK_SZ 1024
 
-static cfg_uint32 cfg_get_file_size(FILE *f)
+/* not exposed in the API; reads 'f' to the end instead of using ftell(),
+ * as a long cannot hold the size of large files on all targets */
+size_t cfg_get_file_size(FILE *f)
 {
 	char buf[F_READ_BLOCK_SZ];
-	cfg_uint32 sz_bytes, sz = 0;
+	size_t sz_bytes, sz = 0;
 
 	while (CFG_TRUE) {
 		sz_bytes = fread(buf, 1, F_READ_BLOCK_SZ, f);
@@ -371,7 +787,7 @@ static cfg_uint32 cfg_get_file_size(FILE *f)
 cfg_status_t cfg_file_ptr_parse(cfg_t *st, FILE *f, cfg_bool close)
 {
 	cfg_char *buf;
-	cfg_uint32 sz = 0;
+	size_t sz = 0;
 	cfg_status_t ret;
 
 	CFG_CHECK_ST_RETURN(st, "cfg_file_ptr_parse", CFG_ERROR_NULL_PTR);
@@ -383,7 +799,9 @@ cfg_status_t cfg_file_ptr_parse(cfg_t *st, FILE *f, cfg_bool close)
 	if (!sz)
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_FREAD);
 
-	buf = (cfg_char *)malloc(sz);
+	/* the buffer is parsed in place, which terminates it after the last
+	 * character if nothing was removed from it */
+	buf = (cfg_char *)CFG_MALLOC(st, sz + 1);
 	if (!buf) {
 		if (close)
 			fclose(f);
@@ -392,163 +810,285 @@ cfg_status_t cfg_file_ptr_parse(cfg_t *st, FILE *f, cfg_bool close)
 	if (fread(buf, 1, sz, f) != sz) {
 		if (close)
 			fclose(f);
-		free(buf);
+		CFG_FREE(st, buf);
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_FREAD);
 	}
+	buf[sz] = '\0';
 	if (close)
 		fclose(f);
 
-	ret = cfg_buffer_parse(st, buf, sz, CFG_FALSE);
-	free(buf);
+	ret = cfg_buffer_parse64(st, buf, sz, CFG_FALSE);
+	CFG_FREE(st, buf);
 	return ret;
 }
 
 cfg_status_t cfg_file_parse(cfg_t *st, cfg_char *filename)
 {
 	FILE *f;
+	cfg_snapshot_stamp_t stamp;
+	cfg_bool snapshot;
+	cfg_status_t ret;
+
 	CFG_CHECK_ST_RETURN(st, "cfg_file_parse", CFG_ERROR_NULL_PTR);
-	/* read file */
-	f = fopen(filename, "r");
-	return cfg_file_ptr_parse(st, f, CFG_TRUE);
+
+	/* a snapshot which fails to load is followed by a parse; subscribers get
+	 * the changes of both at the end */
+	if (st->subs)
+		cfg_changes_begin(st);
+
+	/* try a snapshot of the same file version first. the stamp is taken
+	 * before reading, so a file changed while parsing gets a stale stamp. */
+	snapshot = st->snapshot_dir && cfg_snapshot_stamp_get(filename, &stamp) == CFG_STATUS_OK;
+	if (snapshot && cfg_snapshot_load(st, filename, &stamp) == CFG_STATUS_OK) {
+		ret = CFG_STATUS_OK;
+	} else {
+		/* read file */
+		f = fopen(filename, "r");
+		ret = cfg_file_ptr_parse(st, f, CFG_TRUE);
+		/* a snapshot does not keep the warnings, so a file with warnings is
+		 * always parsed */
+		if (ret == CFG_STATUS_OK && snapshot && !st->diagnostics.count)
+			cfg_snapshot_save(st, filename, &stamp);
+	}
+	if (st->subs)
+		cfg_changes_end(st);
+	CFG_SET_RETURN_STATUS(st, ret);
 }
 
-/* characters to escape: '[', ']', '=', '"', '\', '\n' */
-static cfg_char *cfg_escape(cfg_char *str, cfg_uint32 *len)
+/* characters to escape: '[', ']', '=', '"', '\n' */
+static size_t cfg_escape_len(const cfg_char *str)
 {
-	cfg_uint32 n;
-	cfg_char *src = str, *dest, *buf;
+	size_t n = 0;
 
-	*len = 0;
-	if (!src)
-		return cfg_strdup("");
-	n = strlen(src);
-	if (!n)
-		return cfg_strdup("");
-	buf = (cfg_char *)malloc(n * 2 + 1);
-	dest = buf;
+	if (!str)
+		return 0;
+	for (; *str; str++) {
+		switch (*str) {
+		case '[':
+		case ']':
+		case '=':
+		case '"':
+		case '\n':
+			n++;
+		}
+		n++;
+	}
+	return n;
+}
 
-	while (*src) {
-		switch (*src) {
+/* write the escaped 'str' to 'dest'; returns the end of the written string */
+static cfg_char *cfg_escape(cfg_char *dest, const cfg_char *str)
+{
+	if (!str)
+		return dest;
+	for (; *str; str++) {
+		switch (*str) {
 		case '[':
 		case ']':
 		case '=':
 		case '"':
-			*dest = '\\';
-			dest++;
-			*dest = *src;
+			*dest++ = '\\';
+			*dest++ = *str;
 			break;
 		case '\n':
-			*dest = '\\';
-			dest++;
-			*dest = 'n';
+			*dest++ = '\\';
+			*dest++ = 'n';
 			break;
 		default:
-			*dest = *src;
+			*dest++ = *str;
 		}
-		dest++;
-		src++;
 	}
-	*dest = '\0';
-	*len = dest - buf;
-	return buf;
+	return dest;
 }
 
-static cfg_char* cfg_entry_string(cfg_entry_t *entry, cfg_uint32 *len)
+/* the size of a section in the output; the root section has no header */
+static size_t cfg_section_write_len(cfg_section_t *section, cfg_bool header)
 {
-	cfg_char *buf, *key, *value;
-	cfg_uint32 key_len, value_len;
+	size_t sz = 0;
+	cfg_uint32 i;
 
-	key = cfg_escape(entry->key, &key_len);
-	value = cfg_escape(entry->value, &value_len);
+	if (header)
+		sz += cfg_escape_len(section->name) + 3; /* '[', ']', '\n' */
+	for (i = 0; i < section->nentries; i++) {
+		sz += cfg_escape_len(section->entry[i].key);
+		sz += cfg_escape_len(CFG_ENTRY_VALUE(&section->entry[i]));
+		sz += 6; /* 4x '"', '=', '\n' */
+	}
+	return sz;
+}
 
-	*len = key_len + value_len + 6;  /* 4x '"', '=', '\n' */
-	buf = (cfg_char *)malloc(*len + 1);
-	if (!buf)
-		return NULL;
+static cfg_char *cfg_section_write(cfg_t *st, cfg_char *dest, cfg_uint32 i)
+{
+	static const cfg_char *fname = "[cfg2] cfg_buffer_write():";
+	cfg_section_t *section = &st->section[i];
+	cfg_uint32 j;
 
-	buf[0] = '\0';
-	strcat(buf, "\"");
-	strcat(buf, key);
-	strcat(buf, "\"=\"");
-	strcat(buf, value);
-	strcat(buf, "\"\n");
+	if (i) { /* skip the root section name */
+		if (st->verbose > 0)
+			fprintf(stderr, "%s writing section header %d\n", fname, i);
+		*dest++ = '[';
+		dest = cfg_escape(dest, section->name);
+		*dest++ = ']';
+		*dest++ = '\n';
+	}
+	for (j = 0; j < section->nentries; j++) {
+		if (st->verbose > 0)
+			fprintf(stderr, "%s writing section %d, entry %d\n", fname, i, j);
+		*dest++ = '"';
+		dest = cfg_escape(dest, section->entry[j].key);
+		*dest++ = '"';
+		*dest++ = '=';
+		*dest++ = '"';
+		dest = cfg_escape(dest, CFG_ENTRY_VALUE(&section->entry[j]));
+		*dest++ = '"';
+		*dest++ = '\n';
+	}
+	return dest;
+}
 
-	free(key);
-	free(value);
-	return buf;
+/* minimum number of entries and output bytes per writer thread */
+#define CFG_WRITE_JOB_ENTRIES 4096
+#define CFG_WRITE_JOB_BYTES (256 * 1024)
+
+/* a range of sections written by one thread */
+typedef struct {
+	cfg_t *st;
+	cfg_uint32 first, last;
+	size_t *offset;
+	cfg_char *out;
+} cfg_write_job_t;
+
+/* phase one: the size of each section in the range */
+static void cfg_write_job_size(void *arg)
+{
+	cfg_write_job_t *job = (cfg_write_job_t *)arg;
+	cfg_uint32 i;
+
+	for (i = job->first; i < job->last; i++)
+		job->offset[i] = cfg_section_write_len(&job->st->section[i], i != 0);
 }
 
-cfg_status_t cfg_buffer_write(cfg_t *st, cfg_char **out, cfg_uint32 *len)
+/* phase two: each section goes straight to its offset in the output */
+static void cfg_write_job_write(void *arg)
 {
-	static const cfg_char *fname = "[cfg2] cfg_buffer_write():";
-	cfg_uint32 i, j, sz, n, allocated;
-	cfg_char *str, *ptr;
-	cfg_section_t *section;
-	cfg_entry_t *entry;
+	cfg_write_job_t *job = (cfg_write_job_t *)arg;
+	cfg_uint32 i;
+
+	for (i = job->first; i < job->last; i++)
+		cfg_section_write(job->st, job->out + job->offset[i], i);
+}
 
-	sz = 1;
-	allocated = 512;
-	*out = (cfg_char *)malloc(allocated);
-	*out[0] = '\0'; /* ensure an empty '\0' terminated buffer */
+/* write the object to a buffer of at most 'max' bytes, without the '\0' */
+static cfg_status_t cfg_buffer_write_max(cfg_t *st, cfg_char **out, size_t *len, size_t max)
+{
+	cfg_write_job_t job[CFG_THREADS_MAX];
+	cfg_uint32 i, t, n;
+	size_t *offset, sz, nentries = 0, total = 0;
+
+	if (cfg_sections_materialize(st) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
 
+	offset = (size_t *)CFG_MALLOC(st, (st->nsections + 1) * sizeof(size_t));
+	if (!offset)
+		return CFG_ERROR_ALLOC;
+
+	/* size the sections, with the entries split evenly between threads */
+	for (i = 0; i < st->nsections; i++)
+		nentries += st->section[i].nentries;
+	n = 1 + nentries / CFG_WRITE_JOB_ENTRIES;
+	if (n > st->nthreads)
+		n = st->nthreads;
+	if (n > st->nsections)
+		n = st->nsections;
+	for (i = 0, t = 0, sz = 0; t < n; t++) {
+		job[t].st = st;
+		job[t].offset = offset;
+		job[t].first = i;
+		for (; i < st->nsections && (t == n - 1 || sz < nentries * (t + 1) / n); i++)
+			sz += st->section[i].nentries + 1;
+		job[t].last = i;
+	}
+	cfg_threads_run(st, cfg_write_job_size, (void *)job, sizeof(cfg_write_job_t), n);
+
+	/* sizes to offsets */
 	for (i = 0; i < st->nsections; i++) {
-		if (i) { /* skip the root section name */
-			if (st->verbose > 0)
-				fprintf(stderr, "%s writing section header %d\n", fname, i);
-			str = cfg_escape(st->section[i].name, &n);
-			n += 3; /* [, ], \n */
-			if (sz + n > allocated) {
-				allocated <<= 1;
-				*out = (cfg_char *)realloc(*out, allocated);
-				if (!*out)
-					CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
-			}
-			ptr = *out + sz - 1;
-			sz += n;
-			strcat(ptr, "[");
-			strcat(ptr + 1, str);
-			strcat(ptr + n - 2, "]\n");
-			free(str);
-		}
-		section = &st->section[i];
-		for (j = 0; j < section->nentries; j++) {
-			if (st->verbose > 0)
-				fprintf(stderr, "%s writing section %d, entry %d\n", fname, i, j);
-			entry = &section->entry[j];
-			str = cfg_entry_string(entry, &n);
-			if (!str)
-				CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
-			if (sz + n > allocated) {
-				allocated <<= 1;
-				*out = (cfg_char *)realloc(*out, allocated);
-				if (!*out)
-					CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
-			}
-			ptr = *out + sz - 1;
-			sz += n;
-			strcat(ptr, str);
-			free(str);
-		}
+		sz = offset[i];
+		offset[i] = total;
+		total += sz;
 	}
-	*out = (cfg_char *)realloc(*out, sz); /* trim */
-	if (!*out)
-		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
-	*len = sz - 1; /* exclude the '\0' character */
-	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+	offset[i] = total;
+	if (total > max) {
+		CFG_FREE(st, offset);
+		return CFG_ERROR_OUT_OF_RANGE;
+	}
+
+	/* the output belongs to the caller and is always allocated with malloc() */
+	*out = (cfg_char *)malloc(total + 1);
+	if (!*out) {
+		CFG_FREE(st, offset);
+		return CFG_ERROR_ALLOC;
+	}
+
+	/* write the sections, with the output bytes split evenly between threads */
+	n = 1 + total / CFG_WRITE_JOB_BYTES;
+	if (n > st->nthreads)
+		n = st->nthreads;
+	if (n > st->nsections)
+		n = st->nsections;
+	for (i = 0, t = 0; t < n; t++) {
+		job[t].out = *out;
+		job[t].first = i;
+		while (i < st->nsections && (t == n - 1 || offset[i] < total / n * (t + 1)))
+			i++;
+		job[t].last = i;
+	}
+	cfg_threads_run(st, cfg_write_job_write, (void *)job, sizeof(cfg_write_job_t), n);
+
+	(*out)[total] = '\0';
+	*len = total; /* exclude the '\0' character */
+	CFG_FREE(st, offset);
+	return CFG_STATUS_OK;
+}
+
+cfg_status_t cfg_buffer_write(cfg_t *st, cfg_char **out, cfg_uint32 *len)
+{
+	cfg_status_t ret;
+	size_t sz;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_buffer_write", CFG_ERROR_NULL_PTR);
+	if (!out || !len)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	ret = cfg_buffer_write_max(st, out, &sz, 0xfffffffe);
+	if (ret == CFG_STATUS_OK)
+		*len = (cfg_uint32)sz;
+	CFG_SET_RETURN_STATUS(st, ret);
+}
+
+cfg_status_t cfg_buffer_write64(cfg_t *st, cfg_char **out, size_t *len)
+{
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_buffer_write64", CFG_ERROR_NULL_PTR);
+	if (!out || !len)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	/* leave room for the '\0' */
+	ret = cfg_buffer_write_max(st, out, len, (size_t)-2);
+	CFG_SET_RETURN_STATUS(st, ret);
 }
 
 cfg_status_t cfg_file_ptr_write(cfg_t *st, FILE *f, cfg_bool close)
 {
-	cfg_char *buf;
-	cfg_uint32 sz = 0, sz_write = 0;
+	cfg_char *buf = NULL;
+	size_t sz = 0, sz_write = 0;
 	cfg_status_t ret;
 
 	CFG_CHECK_ST_RETURN(st, "cfg_file_ptr_write", CFG_ERROR_NULL_PTR);
 	if (!f)
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_FILE);
 
-	ret = cfg_buffer_write(st, &buf, &sz);
+	ret = cfg_buffer_write64(st, &buf, &sz);
 	if (ret != CFG_STATUS_OK || !buf || !sz) {
+		free(buf);
 		if (close)
 			fclose(f);
 		return ret;
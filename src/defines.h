@@ -16,15 +16,164 @@
 #define CFG_SET_STATUS(st, _status) \
 	{ st->status = _status; }
 
+/* all memory owned by a cfg_t goes through its allocator */
+#define CFG_MALLOC(st, _size) \
+	((st)->allocator.malloc_fn((st)->allocator.ctx, (_size)))
+
+#define CFG_REALLOC(st, _ptr, _size) \
+	((st)->allocator.realloc_fn((st)->allocator.ctx, (void *)(_ptr), (_size)))
+
+#define CFG_FREE(st, _ptr) \
+	((_ptr) ? (st)->allocator.free_fn((st)->allocator.ctx, (void *)(_ptr)) : (void)0)
+
+/* hint the CPU to load a cache line that is read soon */
+#if defined(__GNUC__)
+#	define CFG_PREFETCH(_ptr) __builtin_prefetch((const void *)(_ptr))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#	include <xmmintrin.h>
+#	define CFG_PREFETCH(_ptr) _mm_prefetch((const char *)(_ptr), _MM_HINT_T0)
+#else
+#	define CFG_PREFETCH(_ptr) ((void)0)
+#endif
+
+/* murmur3 finalizer; spreads the bits of a library hash for table slots */
+#define CFG_HASH_FMIX(h) \
+	h ^= h >> 16; \
+	h *= 0x85ebca6b; \
+	h ^= h >> 13; \
+	h *= 0xc2b2ae35; \
+	h ^= h >> 16;
+
 #define CFG_CHECK_ST_RETURN(st, _fname, _ret) \
 	if (!st) { \
 		fprintf(stderr, "[cfg2] %s(): %s\n", _fname, "the cfg_t pointer cannot bet NULL!"); \
 		return _ret; \
 	}
 
+/* a lookup during a parse of cfg_parse_async() waits for it or fails; see
+ * async.c */
+#define CFG_CHECK_ASYNC_RETURN(st, _ret) \
+	if (st->async && cfg_parse_check(st) != CFG_STATUS_OK) { \
+		st->status = CFG_ERROR_BUSY; \
+		return _ret; \
+	}
+
+/* a thread; see thread.c */
+typedef struct _cfg_thread_t cfg_thread_t;
+typedef void (*cfg_thread_func_t)(void *arg);
+
+/* a flag threads can wait for and a lock; see thread.c */
+typedef struct _cfg_event_t cfg_event_t;
+typedef struct _cfg_mutex_t cfg_mutex_t;
+
+/* minimal perfect hash index; see index.c */
+typedef struct {
+	cfg_uint32 nbuckets;
+	cfg_uint32 nslots;
+	cfg_int *disp;
+	cfg_entry_t **slot;
+} cfg_index_t;
+
+/* identifies a version of a file for its snapshot; see snapshot.c */
+typedef struct {
+	cfg_long size;
+	cfg_long mtime;
+	cfg_long inode;
+	cfg_bool recent; /* modified in the second of the stamp; not stored */
+} cfg_snapshot_stamp_t;
+
+/* a string interning table; see intern.c */
+typedef struct {
+	cfg_uint32 hash;
+	cfg_uint32 len;
+	cfg_char *str;
+} cfg_intern_slot_t;
+
+typedef struct _cfg_intern_block_t {
+	struct _cfg_intern_block_t *next;
+	size_t size; /* of the strings after the header */
+} cfg_intern_block_t;
+
+typedef struct {
+	cfg_uint32 nslots;
+	cfg_uint32 count;
+	cfg_intern_slot_t *slot;
+	cfg_intern_block_t *block;
+	cfg_char *pos;
+	cfg_char *end;
+} cfg_intern_t;
+
+/* the sections, strings and interned names of an object frozen by
+ * cfg_clone(), shared by it and its clones; see clone.c */
+typedef struct {
+	cfg_uint32 refs;
+	cfg_uint32 nsections;
+	cfg_section_t *section; /* the entries of shared sections point to these */
+	cfg_char *strings; /* keys, values and names compacted by cfg_shrink() */
+	size_t strings_size;
+	cfg_intern_block_t *block; /* interned keys and names */
+	cfg_uint32 nslots; /* the interning table when frozen, copied by clones */
+	cfg_uint32 count;
+	cfg_intern_slot_t *slot;
+} cfg_shared_t;
+
+/* a subscription of cfg_subscribe(); see subscribe.c */
+typedef struct {
+	cfg_uint32 section_hash;
+	cfg_uint32 key_hash; /* 0 for a prefix */
+	cfg_char *prefix; /* NULL for a single key */
+	size_t prefix_len;
+	cfg_change_cb_t cb;
+	void *ctx;
+	cfg_int next; /* in the same bucket; -1 ends it */
+} cfg_sub_t;
+
+/* a change waiting to be reported; the section name and key follow it */
+typedef struct _cfg_change_t {
+	struct _cfg_change_t *next;
+	cfg_change_cb_t cb;
+	void *ctx;
+	cfg_uint32 section_hash;
+	cfg_uint32 key_hash;
+	cfg_char *section; /* NULL for the root section */
+	cfg_char *key;
+	cfg_char *value; /* NULL for a removed key */
+} cfg_change_t;
+
+typedef struct {
+	cfg_uint32 nsubs;
+	cfg_uint32 nprefix; /* prefix subscriptions are looked for only if any */
+	cfg_sub_t *sub;
+	cfg_uint32 nbuckets; /* a power of two */
+	cfg_int *bucket; /* the first subscription by section / key hash */
+	cfg_bool batch;
+	cfg_uint32 reload; /* the depth of calls which parse again */
+	struct _cfg_t *saved; /* the keys before a reload, to find the changes */
+	cfg_mutex_t *mutex; /* for the queue below */
+	cfg_change_t *first;
+	cfg_change_t *last;
+	cfg_uint32 nchanges;
+	cfg_uint32 nslots; /* a power of two; 0 without a table */
+	cfg_change_t **slot; /* the queued changes by hash, for coalescing */
+} cfg_subs_t;
+
+/* the warnings of the last parse; see diagnostics.c. without a ring 'ring'
+ * points to 'scratch' and 'mask' is 0, so the parser writes a warning
+ * without testing if it is kept */
+typedef struct {
+	cfg_diagnostic_t *ring;
+	cfg_uint32 size; /* a power of two; 0 if none are kept */
+	cfg_uint32 mask;
+	cfg_uint32 count; /* can be more than 'size' */
+	cfg_diagnostic_t scratch;
+} cfg_diagnostics_t;
+
 struct _cfg_t {
+	cfg_allocator_t allocator;
+
 	cfg_char separator_section;
 	cfg_char separator_key_value;
+	cfg_char separator_raw; /* ends a key followed by a value not unescaped yet */
 	cfg_char comment_char1;
 	cfg_char comment_char2;
 
@@ -35,6 +184,43 @@ struct _cfg_t {
 	cfg_section_t *section;
 
 	cfg_entry_t **cache;
+	cfg_index_t *index;
+	cfg_char *snapshot_dir;
+	cfg_intern_t *intern;
+	cfg_uint32 nthreads;
+	cfg_uint32 generation; /* changed with every move or removal of entries; see cfg_index_free() */
+	cfg_bool lazy;
+	cfg_char *lazy_buf; /* the converted buffer of the last lazy parse */
+	size_t lazy_size; /* the allocated size of 'lazy_buf' */
+	cfg_duplicates_t duplicates;
+	cfg_char *strings; /* keys, values and names compacted by cfg_shrink() */
+	size_t strings_size;
+	cfg_shared_t *shared;
+	cfg_parse_t *async; /* a parse of cfg_parse_async() not completed yet */
+	cfg_subs_t *subs; /* NULL without subscriptions */
+	cfg_diagnostics_t diagnostics;
+};
+
+/* an open addressing table of positions + 1 by hash, at most half full;
+ * see merge.c */
+typedef struct {
+	cfg_uint32 nslots; /* a power of two */
+	cfg_uint32 *slot;
+} cfg_merge_table_t;
+
+/* the topmost entry for a section / key pair in an overlay; see overlay.c */
+typedef struct {
+	cfg_uint32 section_hash;
+	cfg_uint32 key_hash;
+	cfg_entry_t *entry; /* NULL for an empty slot */
+} cfg_overlay_slot_t;
+
+struct _cfg_overlay_t {
+	cfg_uint32 nlayers;
+	cfg_t *layer[CFG_OVERLAY_MAX]; /* from the bottom up */
+	cfg_uint32 generation[CFG_OVERLAY_MAX]; /* of the layers when 'slot' was built */
+	cfg_uint32 nslots; /* a power of two; 0 without a table */
+	cfg_overlay_slot_t *slot;
 };
 
 struct _cfg_section_t {
@@ -42,13 +228,92 @@ struct _cfg_section_t {
 	cfg_uint32 nentries;
 	cfg_char *name;
 	cfg_entry_t *entry;
+	cfg_uint32 *key_hash; /* the key hashes of 'entry' in a separate array for fast scanning */
+	cfg_entry_t **sorted; /* the entries in key order, built on demand; see sorted.c */
+	cfg_char *raw; /* the 'nraw' entries not parsed yet in lazy mode; see lazy.c */
+	cfg_uint32 nraw;
+	cfg_bool shared; /* 'entry' and 'key_hash' belong to st->shared; see clone.c */
 };
 
+/* entry flags */
+#define CFG_ENTRY_RAW 0x01 /* the value is not unescaped yet */
+
 struct _cfg_entry_t {
 	cfg_uint32 key_hash;
+	cfg_uint32 flags; /* fills the padding before 'key' on 64bit */
 	cfg_char *key;
 	cfg_char *value;
 	cfg_section_t *section;
 };
 
+/* utils.c; not exposed in the API */
+void *cfg_mem_calloc(cfg_t *st, size_t n, size_t size);
+cfg_char *cfg_mem_strdup(cfg_t *st, const cfg_char *str);
+void cfg_str_free(cfg_t *st, cfg_char *str);
+cfg_uint32 cfg_hash_find(const cfg_uint32 *hashes, cfg_uint32 n, cfg_uint32 hash);
+
+/* intern.c; not exposed in the API */
+cfg_char *cfg_name_dup(cfg_t *st, const cfg_char *str, cfg_uint32 *hash);
+void cfg_name_free(cfg_t *st, cfg_char *str);
+cfg_char *cfg_intern_get(cfg_t *st, const cfg_char *str, cfg_uint32 len, cfg_uint32 hash);
+void cfg_intern_clear(cfg_t *st);
+void cfg_intern_free(cfg_t *st);
+
+/* core.c; not exposed in the API */
+cfg_char *cfg_entry_value_unescape(cfg_entry_t *entry);
+void cfg_tree_move(cfg_t *to, cfg_t *from);
+size_t cfg_get_file_size(FILE *f);
+
+/* the value of an entry, unescaping a raw value on its first read */
+#define CFG_ENTRY_VALUE(_entry) \
+	((_entry)->flags & CFG_ENTRY_RAW ? cfg_entry_value_unescape(_entry) : (_entry)->value)
+
+/* thread.c; not exposed in the API */
+cfg_thread_t *cfg_thread_start(cfg_t *st, cfg_thread_func_t func, void *arg);
+void cfg_thread_join(cfg_t *st, cfg_thread_t *thread);
+void cfg_threads_run(cfg_t *st, cfg_thread_func_t func, void *args, size_t size, cfg_uint32 n);
+cfg_uint32 cfg_atomic_add(volatile cfg_uint32 *value, cfg_int delta);
+cfg_event_t *cfg_event_alloc(cfg_t *st);
+void cfg_event_free(cfg_t *st, cfg_event_t *event);
+void cfg_event_set(cfg_event_t *event);
+cfg_bool cfg_event_is_set(cfg_event_t *event);
+void cfg_event_wait(cfg_event_t *event);
+cfg_mutex_t *cfg_mutex_alloc(cfg_t *st);
+void cfg_mutex_free(cfg_t *st, cfg_mutex_t *mutex);
+void cfg_mutex_lock(cfg_mutex_t *mutex);
+void cfg_mutex_unlock(cfg_mutex_t *mutex);
+
+/* merge.c; not exposed in the API */
+cfg_status_t cfg_merge_table_init(cfg_t *st, cfg_merge_table_t *table, cfg_uint32 n);
+cfg_uint32 *cfg_merge_table_find(cfg_merge_table_t *table, const cfg_uint32 *hashes, cfg_uint32 hash);
+cfg_status_t cfg_tree_merge(cfg_t *dst, cfg_t *src, cfg_merge_policy_t policy, cfg_bool consume);
+
+/* lazy.c; not exposed in the API */
+cfg_status_t cfg_section_materialize(cfg_t *st, cfg_section_t *section);
+cfg_status_t cfg_sections_materialize(cfg_t *st);
+
+/* clone.c; not exposed in the API */
+cfg_bool cfg_shared_str(cfg_t *st, const cfg_char *str);
+cfg_section_t *cfg_entry_section(cfg_t *st, cfg_entry_t *entry);
+cfg_status_t cfg_section_unshare(cfg_t *st, cfg_section_t *section);
+cfg_status_t cfg_sections_unshare(cfg_t *st);
+void cfg_shared_release(cfg_t *st);
+
+/* subscribe.c; not exposed in the API */
+void cfg_change_notify(cfg_t *st, cfg_section_t *section, cfg_entry_t *entry, const cfg_char *value);
+void cfg_changes_flush(cfg_t *st);
+void cfg_changes_begin(cfg_t *st);
+void cfg_changes_save(cfg_t *st);
+void cfg_changes_end(cfg_t *st);
+void cfg_subs_free(cfg_t *st);
+
+/* diagnostics.c; not exposed in the API */
+void cfg_diagnostic_add(cfg_diagnostics_t *diagnostics, cfg_diagnostic_code_t code, cfg_uint32 line, cfg_uint32 column);
+void cfg_diagnostics_copy(cfg_t *to, cfg_t *from);
+void cfg_diagnostics_free(cfg_t *st);
+
+/* async.c; not exposed in the API */
+cfg_status_t cfg_parse_check(cfg_t *st);
+void cfg_parse_finish(cfg_t *st, cfg_bool adopt);
+
 #endif
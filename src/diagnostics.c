@@ -0,0 +1,100 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * diagnostics.c:
+ *	the warnings of a parse, kept in a ring instead of printed
+ */
+
+#include "defines.h"
+
+/* not exposed in the API; called by the parser for each warning. the ring is
+ * written even if it is the scratch slot, so there is nothing to test. */
+void cfg_diagnostic_add(cfg_diagnostics_t *diagnostics, cfg_diagnostic_code_t code, cfg_uint32 line, cfg_uint32 column)
+{
+	cfg_diagnostic_t *diag = &diagnostics->ring[diagnostics->count++ & diagnostics->mask];
+
+	diag->code = code;
+	diag->line = line;
+	diag->column = column;
+}
+
+/* the number of warnings held by the ring of 'st' */
+static cfg_uint32 cfg_diagnostics_held(cfg_t *st)
+{
+	return st->diagnostics.count < st->diagnostics.size ? st->diagnostics.count : st->diagnostics.size;
+}
+
+/* not exposed in the API; replace the warnings of 'to' with the ones of
+ * 'from', e.g. after moving the keys of a parse between objects. the rings
+ * are indexed by the count, so the newest ones are copied to the same slots. */
+void cfg_diagnostics_copy(cfg_t *to, cfg_t *from)
+{
+	cfg_uint32 i, n = cfg_diagnostics_held(from);
+
+	if (n > to->diagnostics.size)
+		n = to->diagnostics.size;
+	for (i = from->diagnostics.count - n; i != from->diagnostics.count; i++)
+		to->diagnostics.ring[i & to->diagnostics.mask] = from->diagnostics.ring[i & from->diagnostics.mask];
+	to->diagnostics.count = from->diagnostics.count;
+}
+
+/* not exposed in the API; also sets the object up without a ring */
+void cfg_diagnostics_free(cfg_t *st)
+{
+	if (st->diagnostics.size)
+		CFG_FREE(st, st->diagnostics.ring);
+	st->diagnostics.ring = &st->diagnostics.scratch;
+	st->diagnostics.size = 0;
+	st->diagnostics.mask = 0;
+}
+
+cfg_status_t cfg_diagnostics_set(cfg_t *st, cfg_uint32 size)
+{
+	cfg_diagnostic_t *ring;
+	cfg_uint32 n = 1;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_diagnostics_set", CFG_ERROR_NULL_PTR);
+	if (size > 0x80000000u)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_OUT_OF_RANGE);
+
+	st->diagnostics.count = 0;
+	if (!size) {
+		cfg_diagnostics_free(st);
+		CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+	}
+	while (n < size)
+		n <<= 1;
+	ring = (cfg_diagnostic_t *)CFG_MALLOC(st, n * sizeof(cfg_diagnostic_t));
+	if (!ring)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	cfg_diagnostics_free(st);
+	st->diagnostics.ring = ring;
+	st->diagnostics.size = n;
+	st->diagnostics.mask = n - 1;
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+cfg_status_t cfg_diagnostics_get(cfg_t *st, cfg_diagnostic_t *diag, cfg_uint32 *n, cfg_uint32 *total)
+{
+	cfg_uint32 i, first, held;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_diagnostics_get", CFG_ERROR_NULL_PTR);
+	if (!n || (*n && !diag))
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
+
+	held = cfg_diagnostics_held(st);
+	first = st->diagnostics.count - held;
+	if (*n > held)
+		*n = held;
+	for (i = 0; i < *n; i++)
+		diag[i] = st->diagnostics.ring[(first + i) & st->diagnostics.mask];
+	if (total)
+		*total = st->diagnostics.count;
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
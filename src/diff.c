@@ -0,0 +1,198 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * diff.c:
+ *	the added, removed and changed keys between two objects
+ */
+
+#include "defines.h"
+
+/* sections with up to this many entries are searched without a table */
+#define CFG_DIFF_SCAN_MAX 32
+
+/* the positions of the keys of one section by hash */
+typedef struct {
+	cfg_section_t *section;
+	cfg_merge_table_t table; /* no slots for a short section */
+} cfg_diff_keys_t;
+
+/* state of one diff */
+typedef struct {
+	cfg_t *st; /* for memory */
+	cfg_diff_cb_t cb;
+	void *ctx;
+	cfg_bool stop;
+} cfg_diff_t;
+
+static cfg_status_t cfg_diff_keys_init(cfg_t *st, cfg_diff_keys_t *keys, cfg_section_t *section)
+{
+	cfg_uint32 i, *slot;
+
+	keys->section = section;
+	keys->table.slot = NULL;
+	if (!section || section->nentries <= CFG_DIFF_SCAN_MAX)
+		return CFG_STATUS_OK;
+	if (cfg_merge_table_init(st, &keys->table, section->nentries) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	for (i = 0; i < section->nentries; i++) {
+		slot = cfg_merge_table_find(&keys->table, section->key_hash, section->key_hash[i]);
+		if (!*slot)
+			*slot = i + 1;
+	}
+	return CFG_STATUS_OK;
+}
+
+/* the position of the first entry with 'hash'; 'nentries' if there is none */
+static cfg_uint32 cfg_diff_keys_find(cfg_diff_keys_t *keys, cfg_uint32 hash)
+{
+	cfg_uint32 *slot;
+
+	if (!keys->table.slot)
+		return cfg_hash_find(keys->section->key_hash, keys->section->nentries, hash);
+	slot = cfg_merge_table_find(&keys->table, keys->section->key_hash, hash);
+	return *slot ? *slot - 1 : keys->section->nentries;
+}
+
+/* compare two values without unescaping them if possible: equal raw values
+ * are equal once unescaped too */
+static cfg_bool cfg_diff_value_equal(cfg_entry_t *a, cfg_entry_t *b)
+{
+	if (a->value == b->value)
+		return CFG_TRUE;
+	if (!((a->flags ^ b->flags) & CFG_ENTRY_RAW) && !strcmp(a->value, b->value))
+		return CFG_TRUE;
+	if (!((a->flags | b->flags) & CFG_ENTRY_RAW))
+		return CFG_FALSE;
+	return !strcmp(CFG_ENTRY_VALUE(a), CFG_ENTRY_VALUE(b));
+}
+
+/* report the keys of a section of 'old' (can be NULL) and the same section of
+ * 'new' (can be NULL); only the first entry of a repeated key counts. */
+static cfg_status_t cfg_diff_section(cfg_diff_t *d, cfg_section_t *old_section, cfg_section_t *new_section)
+{
+	cfg_diff_keys_t old_keys, new_keys;
+	const cfg_char *name = old_section ? old_section->name : new_section->name;
+	cfg_uchar *seen = NULL;
+	cfg_uint32 i, k;
+	cfg_entry_t *entry;
+
+	if (cfg_diff_keys_init(d->st, &old_keys, old_section) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	if (cfg_diff_keys_init(d->st, &new_keys, new_section) != CFG_STATUS_OK) {
+		CFG_FREE(d->st, old_keys.table.slot);
+		return CFG_ERROR_ALLOC;
+	}
+	if (old_section && new_section && new_section->nentries) {
+		seen = (cfg_uchar *)cfg_mem_calloc(d->st, 1, new_section->nentries);
+		if (!seen) {
+			CFG_FREE(d->st, old_keys.table.slot);
+			CFG_FREE(d->st, new_keys.table.slot);
+			return CFG_ERROR_ALLOC;
+		}
+	}
+
+	for (i = 0; old_section && i < old_section->nentries && !d->stop; i++) {
+		entry = &old_section->entry[i];
+		if (cfg_diff_keys_find(&old_keys, entry->key_hash) != i)
+			continue;
+		k = new_section ? cfg_diff_keys_find(&new_keys, entry->key_hash) : 0;
+		if (!new_section || k == new_section->nentries) {
+			d->stop = !d->cb(d->ctx, CFG_DIFF_REMOVED, name, entry, NULL);
+			continue;
+		}
+		seen[k] = CFG_TRUE;
+		if (!cfg_diff_value_equal(entry, &new_section->entry[k]))
+			d->stop = !d->cb(d->ctx, CFG_DIFF_CHANGED, name, entry, &new_section->entry[k]);
+	}
+	for (k = 0; new_section && k < new_section->nentries && !d->stop; k++) {
+		entry = &new_section->entry[k];
+		if ((seen && seen[k]) || cfg_diff_keys_find(&new_keys, entry->key_hash) != k)
+			continue;
+		d->stop = !d->cb(d->ctx, CFG_DIFF_ADDED, name, NULL, entry);
+	}
+
+	CFG_FREE(d->st, seen);
+	CFG_FREE(d->st, old_keys.table.slot);
+	CFG_FREE(d->st, new_keys.table.slot);
+	return CFG_STATUS_OK;
+}
+
+/* the section hashes of 'st' and a table of the first position of each */
+static cfg_status_t cfg_diff_sections_init(cfg_t *st, cfg_t *mem, cfg_merge_table_t *table, cfg_uint32 **hash)
+{
+	cfg_uint32 i, *slot;
+
+	*hash = (cfg_uint32 *)CFG_MALLOC(mem, (st->nsections + 1) * sizeof(cfg_uint32));
+	if (!*hash)
+		return CFG_ERROR_ALLOC;
+	if (cfg_merge_table_init(mem, table, st->nsections) != CFG_STATUS_OK) {
+		CFG_FREE(mem, *hash);
+		return CFG_ERROR_ALLOC;
+	}
+	for (i = 0; i < st->nsections; i++) {
+		(*hash)[i] = st->section[i].hash;
+		slot = cfg_merge_table_find(table, *hash, (*hash)[i]);
+		if (!*slot)
+			*slot = i + 1;
+	}
+	return CFG_STATUS_OK;
+}
+
+cfg_status_t cfg_diff(cfg_t *old_st, cfg_t *new_st, cfg_diff_cb_t cb, void *ctx)
+{
+	cfg_merge_table_t old_table, new_table;
+	cfg_uint32 i, k, *slot, *old_hash, *new_hash;
+	cfg_uchar *seen;
+	cfg_diff_t d;
+	cfg_status_t ret = CFG_STATUS_OK;
+
+	CFG_CHECK_ST_RETURN(old_st, "cfg_diff", CFG_ERROR_NULL_PTR);
+	if (!new_st || !cb)
+		CFG_SET_RETURN_STATUS(old_st, CFG_ERROR_NULL_PTR);
+	if (cfg_sections_materialize(old_st) != CFG_STATUS_OK || cfg_sections_materialize(new_st) != CFG_STATUS_OK)
+		CFG_SET_RETURN_STATUS(old_st, CFG_ERROR_ALLOC);
+
+	if (cfg_diff_sections_init(old_st, old_st, &old_table, &old_hash) != CFG_STATUS_OK)
+		CFG_SET_RETURN_STATUS(old_st, CFG_ERROR_ALLOC);
+	if (cfg_diff_sections_init(new_st, old_st, &new_table, &new_hash) != CFG_STATUS_OK) {
+		CFG_FREE(old_st, old_hash);
+		CFG_FREE(old_st, old_table.slot);
+		CFG_SET_RETURN_STATUS(old_st, CFG_ERROR_ALLOC);
+	}
+	seen = (cfg_uchar *)cfg_mem_calloc(old_st, 1, new_st->nsections + 1);
+	if (!seen)
+		ret = CFG_ERROR_ALLOC;
+
+	d.st = old_st;
+	d.cb = cb;
+	d.ctx = ctx;
+	d.stop = CFG_FALSE;
+
+	/* the sections of 'old' in order, then the sections only in 'new'; like in
+	 * a lookup only the first section with a name counts */
+	for (i = 0; i < old_st->nsections && ret == CFG_STATUS_OK && !d.stop; i++) {
+		if (*cfg_merge_table_find(&old_table, old_hash, old_hash[i]) != i + 1)
+			continue;
+		slot = cfg_merge_table_find(&new_table, new_hash, old_hash[i]);
+		if (*slot)
+			seen[*slot - 1] = CFG_TRUE;
+		ret = cfg_diff_section(&d, &old_st->section[i], *slot ? &new_st->section[*slot - 1] : NULL);
+	}
+	for (k = 0; k < new_st->nsections && ret == CFG_STATUS_OK && !d.stop; k++) {
+		if (seen[k] || *cfg_merge_table_find(&new_table, new_hash, new_hash[k]) != k + 1)
+			continue;
+		ret = cfg_diff_section(&d, NULL, &new_st->section[k]);
+	}
+
+	CFG_FREE(old_st, seen);
+	CFG_FREE(old_st, old_hash);
+	CFG_FREE(old_st, old_table.slot);
+	CFG_FREE(old_st, new_hash);
+	CFG_FREE(old_st, new_table.slot);
+	CFG_SET_RETURN_STATUS(old_st, ret);
+}
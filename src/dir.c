@@ -0,0 +1,228 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * dir.c:
+ *	parsing all matching files of a directory on a pool of threads
+ */
+
+#include <stdio.h>
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <dirent.h>
+#endif
+#include "defines.h"
+
+/* a file of the directory and the object it is parsed into */
+typedef struct {
+	cfg_char *path;
+	const cfg_char *name; /* points into 'path' */
+	cfg_bool empty;
+	cfg_t *tree;
+	cfg_status_t status;
+} cfg_dir_file_t;
+
+/* the files parsed by one thread: 'first', 'first + step', ... */
+typedef struct {
+	cfg_t *st;
+	cfg_dir_file_t *file;
+	cfg_uint32 nfiles;
+	cfg_uint32 first;
+	cfg_uint32 step;
+} cfg_dir_job_t;
+
+/* match a file name against a pattern with '*' and '?' */
+static cfg_bool cfg_dir_match(const cfg_char *pattern, const cfg_char *name)
+{
+	const cfg_char *star = NULL, *retry = NULL;
+
+	/* like a shell glob, hidden files match only a pattern starting with '.' */
+	if (*name == '.' && *pattern != '.')
+		return CFG_FALSE;
+	while (*name) {
+		if (*pattern == '*') {
+			star = ++pattern;
+			retry = name;
+		} else if (*pattern == '?' || *pattern == *name) {
+			pattern++;
+			name++;
+		} else if (star) {
+			pattern = star;
+			name = ++retry;
+		} else {
+			return CFG_FALSE;
+		}
+	}
+	while (*pattern == '*')
+		pattern++;
+	return !*pattern;
+}
+
+/* add 'dir/name' to the list of files */
+static cfg_status_t cfg_dir_file_add(cfg_t *st, cfg_dir_file_t **file, cfg_uint32 *nfiles, cfg_uint32 *allocated,
+	const cfg_char *dir, const cfg_char *name)
+{
+	cfg_dir_file_t *ptr;
+	size_t len = strlen(dir);
+
+	if (*nfiles == *allocated) {
+		*allocated = *allocated ? *allocated << 1 : 64;
+		ptr = (cfg_dir_file_t *)CFG_REALLOC(st, *file, *allocated * sizeof(cfg_dir_file_t));
+		if (!ptr)
+			return CFG_ERROR_ALLOC;
+		*file = ptr;
+	}
+	ptr = &(*file)[*nfiles];
+	ptr->path = (cfg_char *)CFG_MALLOC(st, len + strlen(name) + 2);
+	if (!ptr->path)
+		return CFG_ERROR_ALLOC;
+	sprintf(ptr->path, "%s/%s", dir, name);
+	ptr->name = ptr->path + len + 1;
+	ptr->empty = CFG_FALSE;
+	ptr->tree = NULL;
+	ptr->status = CFG_STATUS_OK;
+	(*nfiles)++;
+	return CFG_STATUS_OK;
+}
+
+/* list the regular files of 'dir' which match 'pattern' */
+static cfg_status_t cfg_dir_list(cfg_t *st, const cfg_char *dir, const cfg_char *pattern, cfg_dir_file_t **file, cfg_uint32 *nfiles)
+{
+	cfg_uint32 allocated = 0;
+	cfg_status_t ret = CFG_STATUS_OK;
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE handle;
+	cfg_char *search;
+
+	search = (cfg_char *)CFG_MALLOC(st, strlen(dir) + 3);
+	if (!search)
+		return CFG_ERROR_ALLOC;
+	sprintf(search, "%s\\*", dir);
+	handle = FindFirstFileA(search, &data);
+	CFG_FREE(st, search);
+	if (handle == INVALID_HANDLE_VALUE)
+		return CFG_ERROR_FILE;
+	do {
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY || !cfg_dir_match(pattern, data.cFileName))
+			continue;
+		ret = cfg_dir_file_add(st, file, nfiles, &allocated, dir, data.cFileName);
+		if (ret == CFG_STATUS_OK)
+			(*file)[*nfiles - 1].empty = !data.nFileSizeLow && !data.nFileSizeHigh;
+	} while (ret == CFG_STATUS_OK && FindNextFileA(handle, &data));
+	FindClose(handle);
+#else
+	DIR *d;
+	struct dirent *ent;
+	struct stat info;
+
+	d = opendir(dir);
+	if (!d)
+		return CFG_ERROR_FILE;
+	while (ret == CFG_STATUS_OK && (ent = readdir(d))) {
+		if (!cfg_dir_match(pattern, ent->d_name))
+			continue;
+		ret = cfg_dir_file_add(st, file, nfiles, &allocated, dir, ent->d_name);
+		if (ret != CFG_STATUS_OK)
+			break;
+		if (stat((*file)[*nfiles - 1].path, &info) || !S_ISREG(info.st_mode)) {
+			(*nfiles)--;
+			CFG_FREE(st, (*file)[*nfiles].path);
+			continue;
+		}
+		(*file)[*nfiles - 1].empty = !info.st_size;
+	}
+	closedir(d);
+#endif
+	return ret;
+}
+
+static int cfg_dir_file_cmp(const void *a, const void *b)
+{
+	return strcmp(((const cfg_dir_file_t *)a)->name, ((const cfg_dir_file_t *)b)->name);
+}
+
+/* parse the files of a job, each into an object of its own */
+static void cfg_dir_job(void *arg)
+{
+	cfg_dir_job_t *job = (cfg_dir_job_t *)arg;
+	cfg_dir_file_t *file;
+	cfg_uint32 i;
+
+	for (i = job->first; i < job->nfiles; i += job->step) {
+		file = &job->file[i];
+		/* the allocator of 'st' may not be thread-safe; malloc() is */
+		file->tree = cfg_alloc();
+		if (!file->tree) {
+			file->status = CFG_ERROR_ALLOC;
+			continue;
+		}
+		file->tree->verbose = job->st->verbose;
+		file->tree->duplicates = job->st->duplicates;
+		if (job->st->snapshot_dir)
+			cfg_snapshot_dir_set(file->tree, job->st->snapshot_dir);
+		/* cfg_file_parse() does not accept empty files */
+		if (!file->empty)
+			file->status = cfg_file_parse(file->tree, file->path);
+	}
+}
+
+cfg_status_t cfg_dir_parse(cfg_t *st, const cfg_char *dir, const cfg_char *pattern, cfg_uint32 nthreads)
+{
+	static const cfg_char *fname = "[cfg2] cfg_dir_parse():";
+	cfg_dir_job_t job[CFG_THREADS_MAX];
+	cfg_dir_file_t *file = NULL;
+	cfg_uint32 i, n, nfiles = 0;
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_dir_parse", CFG_ERROR_NULL_PTR);
+	if (!dir)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	if (!pattern)
+		pattern = "*";
+
+	ret = cfg_dir_list(st, dir, pattern, &file, &nfiles);
+	if (ret == CFG_STATUS_OK && nfiles) {
+		qsort((void *)file, nfiles, sizeof(cfg_dir_file_t), cfg_dir_file_cmp);
+
+		n = nthreads ? nthreads : st->nthreads;
+		if (n > CFG_THREADS_MAX)
+			n = CFG_THREADS_MAX;
+		if (n > nfiles)
+			n = nfiles;
+		for (i = 0; i < n; i++) {
+			job[i].st = st;
+			job[i].file = file;
+			job[i].nfiles = nfiles;
+			job[i].first = i;
+			job[i].step = n;
+		}
+		cfg_threads_run(st, cfg_dir_job, (void *)job, sizeof(cfg_dir_job_t), n);
+
+		/* nothing is merged if a file cannot be parsed */
+		for (i = 0; i < nfiles && ret == CFG_STATUS_OK; i++) {
+			ret = file[i].status;
+			if (ret != CFG_STATUS_OK && st->verbose > 0)
+				fprintf(stderr, "%s cannot parse %s (%d)\n", fname, file[i].path, ret);
+		}
+		for (i = 0; i < nfiles && ret == CFG_STATUS_OK; i++)
+			ret = cfg_tree_merge(st, file[i].tree, CFG_MERGE_OVERRIDE, CFG_TRUE);
+		if (st->subs)
+			cfg_changes_flush(st);
+	}
+
+	for (i = 0; i < nfiles; i++) {
+		if (file[i].tree)
+			cfg_free(file[i].tree);
+		CFG_FREE(st, file[i].path);
+	}
+	CFG_FREE(st, file);
+	CFG_SET_RETURN_STATUS(st, ret);
+}
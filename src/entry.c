@@ -14,22 +14,52 @@
 
 /* not exposed in the API */
 cfg_entry_t *cfg_cache_entry_get(cfg_t *st, cfg_uint32 section_hash, cfg_uint32 key_hash);
-void cfg_cache_entry_delete(cfg_t *st, cfg_entry_t *entry);
+void cfg_index_free(cfg_t *st);
+cfg_entry_t *cfg_index_entry_get(cfg_t *st, cfg_uint32 section_hash, cfg_uint32 key_hash);
+
+/* not exposed in the API; point the entries of all sections starting from 'n'
+ * back to their section. needed after the section buffer has been moved. */
+void cfg_sections_relink(cfg_t *st, cfg_uint32 n)
+{
+	cfg_section_t *section;
+	cfg_uint32 j;
+
+	for (; n < st->nsections; n++) {
+		section = &st->section[n];
+		/* shared entries point to the sections of st->shared */
+		if (section->shared)
+			continue;
+		for (j = 0; j < section->nentries; j++)
+			section->entry[j].section = section;
+	}
+}
+
+/* parse the pending entries of a lazy section before handing it out */
+static cfg_section_t *cfg_section_ready(cfg_t *st, cfg_section_t *section)
+{
+	if (section->raw && cfg_section_materialize(st, section) != CFG_STATUS_OK) {
+		CFG_SET_STATUS(st, CFG_ERROR_ALLOC);
+		return NULL;
+	}
+	return section;
+}
 
 cfg_uint32 cfg_total_sections(cfg_t *st)
 {
 	CFG_CHECK_ST_RETURN(st, "cfg_total_sections", 0);
+	CFG_CHECK_ASYNC_RETURN(st, 0);
 	return st->nsections;
 }
 
 cfg_section_t *cfg_section_nth(cfg_t *st, cfg_uint32 n)
 {
 	CFG_CHECK_ST_RETURN(st, "cfg_section_nth", NULL);
+	CFG_CHECK_ASYNC_RETURN(st, NULL);
 	if (n > st->nsections - 1) {
 		CFG_SET_STATUS(st, CFG_ERROR_OUT_OF_RANGE);
 		return NULL;
 	}
-	return &st->section[n];
+	return cfg_section_ready(st, &st->section[n]);
 }
 
 cfg_char *cfg_section_name_get(cfg_t *st, cfg_section_t *section)
@@ -66,23 +96,66 @@ cfg_entry_t *cfg_entry_nth(cfg_t *st, cfg_section_t *section, cfg_uint32 n)
 	return &section->entry[n];
 }
 
-cfg_section_t *cfg_section_get(cfg_t *st, const cfg_char *section)
+/* find a named section by hash; the root section is skipped */
+static cfg_section_t *cfg_section_hash_get(cfg_t *st, cfg_uint32 section_hash)
 {
-	cfg_uint32 i, section_hash;
-
-	CFG_CHECK_ST_RETURN(st, "cfg_section_get", NULL);
-	if (section == CFG_ROOT_SECTION) {
-		CFG_SET_STATUS(st, CFG_STATUS_OK);
-		return &st->section[0];
-	} else {
-		section_hash = cfg_hash_get(section);
-	}
+	cfg_uint32 i;
 
 	for (i = 1; i < st->nsections; i++) {
 		if (st->section[i].hash != section_hash)
 			continue;
 		CFG_SET_STATUS(st, CFG_STATUS_OK);
-		return &st->section[i];
+		return cfg_section_ready(st, &st->section[i]);
+	}
+	CFG_SET_STATUS(st, CFG_ERROR_NOT_FOUND);
+	return NULL;
+}
+
+/* an object which was never parsed has no root section yet */
+static cfg_section_t *cfg_section_root_get(cfg_t *st)
+{
+	if (!st->nsections) {
+		CFG_SET_STATUS(st, CFG_ERROR_NOT_FOUND);
+		return NULL;
+	}
+	CFG_SET_STATUS(st, CFG_STATUS_OK);
+	return cfg_section_ready(st, &st->section[0]);
+}
+
+/* not exposed in the API; find a section by the hash of a key handle, where
+ * CFG_ROOT_SECTION_HASH is the root section */
+cfg_section_t *cfg_key_section_get(cfg_t *st, cfg_uint32 section_hash)
+{
+	if (section_hash == CFG_ROOT_SECTION_HASH)
+		return cfg_section_root_get(st);
+	return cfg_section_hash_get(st, section_hash);
+}
+
+cfg_section_t *cfg_section_get(cfg_t *st, const cfg_char *section)
+{
+	CFG_CHECK_ST_RETURN(st, "cfg_section_get", NULL);
+	CFG_CHECK_ASYNC_RETURN(st, NULL);
+	if (section == CFG_ROOT_SECTION)
+		return cfg_section_root_get(st);
+	return cfg_section_hash_get(st, cfg_hash_get(section));
+}
+
+/* find an entry of a section by key hash; checks the cache first */
+static cfg_entry_t *cfg_section_entry_get(cfg_t *st, cfg_section_t *section, cfg_uint32 key_hash)
+{
+	cfg_entry_t *entry;
+	cfg_uint32 i;
+
+	entry = cfg_cache_entry_get(st, section->hash, key_hash);
+	if (entry)
+		return entry;
+
+	i = cfg_hash_find(section->key_hash, section->nentries, key_hash);
+	if (i < section->nentries) {
+		entry = &section->entry[i];
+		cfg_cache_entry_add(st, entry);
+		CFG_SET_STATUS(st, CFG_STATUS_OK);
+		return entry;
 	}
 	CFG_SET_STATUS(st, CFG_ERROR_NOT_FOUND);
 	return NULL;
@@ -91,36 +164,60 @@ cfg_section_t *cfg_section_get(cfg_t *st, const cfg_char *section)
 cfg_entry_t *cfg_entry_get(cfg_t *st, const cfg_char *section, const cfg_char *key)
 {
 	cfg_section_t *section_ptr;
-	cfg_uint32 key_hash, i;
 	cfg_entry_t *entry;
 
 	CFG_CHECK_ST_RETURN(st, "cfg_entry_get", NULL);
+	CFG_CHECK_ASYNC_RETURN(st, NULL);
 	if (!key) {
 		CFG_SET_STATUS(st, CFG_ERROR_NULL_PTR);
 		return NULL;
 	}
 
+	/* the index replaces both the section lookup and the cache */
+	if (st->index) {
+		entry = cfg_index_entry_get(st, section == CFG_ROOT_SECTION ? CFG_ROOT_SECTION_HASH : cfg_hash_get(section), cfg_hash_get(key));
+		CFG_SET_STATUS(st, entry ? CFG_STATUS_OK : CFG_ERROR_NOT_FOUND);
+		return entry;
+	}
+
 	section_ptr = cfg_section_get(st, section);
 	if (!section_ptr)
 		return NULL;
+	return cfg_section_entry_get(st, section_ptr, cfg_hash_get(key));
+}
 
-	key_hash = cfg_hash_get(key);
+cfg_key_t cfg_key_make(const cfg_char *section, const cfg_char *key)
+{
+	cfg_key_t handle;
 
-	/* check for value in cache first */
-	entry = cfg_cache_entry_get(st, section_ptr->hash, key_hash);
-	if (entry)
-		return entry;
+	/* cfg_hash_get(CFG_ROOT_SECTION) is CFG_ROOT_SECTION_HASH */
+	handle.section_hash = cfg_hash_get(section);
+	handle.key_hash = cfg_hash_get(key);
+	return handle;
+}
 
-	for (i = 0; i < section_ptr->nentries; i++) {
-		entry = &section_ptr->entry[i];
-		if (key_hash != entry->key_hash)
-			continue;
-		cfg_cache_entry_add(st, entry);
-		CFG_SET_STATUS(st, CFG_STATUS_OK);
+cfg_entry_t *cfg_key_entry_get(cfg_t *st, const cfg_key_t *key)
+{
+	cfg_section_t *section_ptr;
+	cfg_entry_t *entry;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_key_entry_get", NULL);
+	CFG_CHECK_ASYNC_RETURN(st, NULL);
+	if (!key) {
+		CFG_SET_STATUS(st, CFG_ERROR_NULL_PTR);
+		return NULL;
+	}
+
+	if (st->index) {
+		entry = cfg_index_entry_get(st, key->section_hash, key->key_hash);
+		CFG_SET_STATUS(st, entry ? CFG_STATUS_OK : CFG_ERROR_NOT_FOUND);
 		return entry;
 	}
-	CFG_SET_STATUS(st, CFG_ERROR_NOT_FOUND);
-	return NULL;
+
+	section_ptr = cfg_key_section_get(st, key->section_hash);
+	if (!section_ptr)
+		return NULL;
+	return cfg_section_entry_get(st, section_ptr, key->key_hash);
 }
 
 cfg_entry_t *cfg_root_entry_get(cfg_t *st, const cfg_char *key)
@@ -128,58 +225,96 @@ cfg_entry_t *cfg_root_entry_get(cfg_t *st, const cfg_char *key)
 	return cfg_entry_get(st, CFG_ROOT_SECTION, key);
 }
 
+/* append a new entry to a section */
+static cfg_entry_t *cfg_section_entry_append(cfg_t *st, cfg_section_t *section, const cfg_char *key, cfg_uint32 key_hash, const cfg_char *value)
+{
+	cfg_entry_t *entry, *old;
+	cfg_uint32 *key_hashes;
+
+	if (cfg_section_unshare(st, section) != CFG_STATUS_OK)
+		return NULL;
+	old = section->entry;
+	CFG_FREE(st, section->sorted);
+	section->sorted = NULL;
+	key_hashes = (cfg_uint32 *)CFG_REALLOC(st, section->key_hash, (section->nentries + 1) * sizeof(cfg_uint32));
+	if (!key_hashes)
+		return NULL;
+	section->key_hash = key_hashes;
+	entry = (cfg_entry_t *)CFG_REALLOC(st, section->entry, (section->nentries + 1) * sizeof(cfg_entry_t));
+	if (!entry)
+		return NULL;
+	section->entry = entry;
+	/* the cache may point to the old entry buffer */
+	if (section->entry != old)
+		cfg_cache_clear(st);
+
+	entry = &section->entry[section->nentries];
+	entry->section = section;
+	entry->key = cfg_name_dup(st, key, NULL);
+	entry->key_hash = key_hash;
+	entry->flags = 0;
+	entry->value = cfg_mem_strdup(st, value);
+	section->key_hash[section->nentries] = key_hash;
+	section->nentries++;
+	return entry;
+}
+
 cfg_entry_t *cfg_entry_add(cfg_t *st, const cfg_char *section, const cfg_char *key, const cfg_char *value)
 {
-	cfg_uint32 key_hash;
+	cfg_uint32 key_hash, n;
 	cfg_entry_t *entry;
-	cfg_section_t *section_ptr;
+	cfg_section_t *section_ptr, *old_section;
 
 	CFG_CHECK_ST_RETURN(st, "cfg_entry_add", NULL);
+	CFG_CHECK_ASYNC_RETURN(st, NULL);
 
 	entry = cfg_entry_get(st, section, key);
 	if (entry) {
 		cfg_entry_value_set(st, entry, value);
 		return entry;
 	}
+	cfg_index_free(st);
 
 	key_hash = cfg_hash_get(key);
 	section_ptr = cfg_section_get(st, section);
 
-	/* create a new section and add the entry to it */
+	/* create a new section and add the entry to it. an object which was
+	 * never parsed gets the root section first. */
 	if (!section_ptr) {
-		st->section = (cfg_section_t *)realloc(st->section, (st->nsections + 1) * sizeof(cfg_section_t));
+		n = st->nsections || section == CFG_ROOT_SECTION ? 1 : 2;
+		old_section = st->section;
+		st->section = (cfg_section_t *)CFG_REALLOC(st, st->section, (st->nsections + n) * sizeof(cfg_section_t));
 		if (!st->section) {
 			CFG_SET_STATUS(st, CFG_ERROR_ALLOC);
 			return NULL;
 		}
-		section_ptr = &st->section[st->nsections];
-		section_ptr->name = cfg_strdup(section);
-		section_ptr->hash = cfg_hash_get(section);
-		section_ptr->nentries = 1;
-		section_ptr->entry = (cfg_entry_t *)malloc(sizeof(cfg_entry_t));
-		entry = &section_ptr->entry[0];
-		entry->section = section_ptr;
-		entry->key = cfg_strdup(key);
-		entry->key_hash = key_hash;
-		entry->value = cfg_strdup(value);
-		st->nsections++;
-		cfg_cache_entry_add(st, entry);
-		CFG_SET_STATUS(st, CFG_STATUS_OK);
-		return entry;
+		if (st->section != old_section)
+			cfg_sections_relink(st, 0);
+		for (; n; n--) {
+			section_ptr = &st->section[st->nsections];
+			section_ptr->name = cfg_name_dup(st, n == 1 ? section : CFG_ROOT_SECTION, &section_ptr->hash);
+			section_ptr->nentries = 0;
+			section_ptr->entry = NULL;
+			section_ptr->key_hash = NULL;
+			section_ptr->sorted = NULL;
+			section_ptr->raw = NULL;
+			section_ptr->nraw = 0;
+			section_ptr->shared = CFG_FALSE;
+			st->nsections++;
+		}
 	}
 
-	/* add entry to an existing section */
-	section_ptr->entry = (cfg_entry_t *)realloc(section_ptr->entry, (section_ptr->nentries + 1) * sizeof(cfg_section_t));
-	if (!section_ptr->entry) {
+	/* add entry to the section */
+	entry = cfg_section_entry_append(st, section_ptr, key, key_hash, value);
+	if (!entry) {
 		CFG_SET_STATUS(st, CFG_ERROR_ALLOC);
 		return NULL;
 	}
-	entry = &section_ptr->entry[section_ptr->nentries];
-	entry->section = section_ptr;
-	entry->key = cfg_strdup(key);
-	entry->key_hash = key_hash;
-	entry->value = cfg_strdup(value);
-	section_ptr->nentries++;
+	cfg_cache_entry_add(st, entry);
+	if (st->subs) {
+		cfg_change_notify(st, section_ptr, entry, entry->value);
+		cfg_changes_flush(st);
+	}
 	CFG_SET_STATUS(st, CFG_STATUS_OK);
 	return entry;
 }
@@ -192,7 +327,7 @@ cfg_entry_t *cfg_root_entry_add(cfg_t *st, const cfg_char *key, const cfg_char *
 cfg_char *cfg_value_get(cfg_t *st, const cfg_char *section, const cfg_char *key)
 {
 	cfg_entry_t *entry = cfg_entry_get(st, section, key);
-	return entry ? entry->value : NULL;
+	return entry ? CFG_ENTRY_VALUE(entry) : NULL;
 }
 
 cfg_char *cfg_root_value_get(cfg_t *st, const cfg_char *key)
@@ -200,6 +335,12 @@ cfg_char *cfg_root_value_get(cfg_t *st, const cfg_char *key)
 	return cfg_value_get(st, CFG_ROOT_SECTION, key);
 }
 
+cfg_char *cfg_key_value_get(cfg_t *st, const cfg_key_t *key)
+{
+	cfg_entry_t *entry = cfg_key_entry_get(st, key);
+	return entry ? CFG_ENTRY_VALUE(entry) : NULL;
+}
+
 cfg_char *cfg_entry_key_get(cfg_t *st, cfg_entry_t *entry)
 {
 	CFG_CHECK_ST_RETURN(st, "cfg_entry_key_get", NULL);
@@ -217,18 +358,39 @@ cfg_char *cfg_entry_value_get(cfg_t *st, cfg_entry_t *entry)
 		CFG_SET_STATUS(st, CFG_ERROR_NULL_PTR);
 		return NULL;
 	}
-	return entry->value;
+	return CFG_ENTRY_VALUE(entry);
 }
 
 cfg_status_t cfg_entry_value_set(cfg_t *st, cfg_entry_t *entry, const cfg_char *value)
 {
+	cfg_section_t *section;
+	cfg_uint32 idx;
+	cfg_bool changed;
+
 	CFG_CHECK_ST_RETURN(st, "cfg_entry_value_set", CFG_ERROR_NULL_PTR);
 	if (!entry || !value)
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
-	free(entry->value);
-	entry->value = cfg_strdup(value);
+	/* a shared entry is set in the copy of its section */
+	if (st->shared) {
+		section = cfg_entry_section(st, entry);
+		if (!section)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
+		idx = entry - &section->entry[0];
+		if (cfg_section_unshare(st, section) != CFG_STATUS_OK)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+		entry = &section->entry[idx];
+	}
+	/* subscribers only hear about a different value */
+	changed = st->subs && strcmp(CFG_ENTRY_VALUE(entry), value);
+	cfg_str_free(st, entry->value);
+	entry->flags &= ~CFG_ENTRY_RAW;
+	entry->value = cfg_mem_strdup(st, value);
 	if (!entry->value)
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	if (changed) {
+		cfg_change_notify(st, entry->section, entry, entry->value);
+		cfg_changes_flush(st);
+	}
 	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
 }
 
@@ -239,6 +401,7 @@ cfg_status_t cfg_value_set(cfg_t *st, const cfg_char *section, const cfg_char *k
 	cfg_section_t *section_ptr;
 
 	CFG_CHECK_ST_RETURN(st, "cfg_value_set", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
 
 	if (!key || !value)
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
@@ -254,12 +417,11 @@ cfg_status_t cfg_value_set(cfg_t *st, const cfg_char *section, const cfg_char *k
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
 
 	/* look for the entry in the existing section */
-	for (i = 0; i < section_ptr->nentries; i++) {
+	i = cfg_hash_find(section_ptr->key_hash, section_ptr->nentries, key_hash);
+	if (i < section_ptr->nentries) {
 		entry = &section_ptr->entry[i];
-		if (key_hash == entry->key_hash) {
-			cfg_cache_entry_add(st, entry);
-			return cfg_entry_value_set(st, entry, value);
-		}
+		cfg_cache_entry_add(st, entry);
+		return cfg_entry_value_set(st, entry, value);
 	}
 
 	CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
@@ -279,27 +441,44 @@ cfg_status_t cfg_entry_delete(cfg_t *st, cfg_entry_t *entry)
 	if (!entry)
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
 
-	section = entry->section;
-	free(entry->key);
-	free(entry->value);
-
-	/* delete from the cache */
-	cfg_cache_entry_delete(st, entry);
-
+	section = cfg_entry_section(st, entry);
+	if (!section)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
 	idx = entry - &section->entry[0];
-	if (idx < section->nentries - 1)
-		memcpy((void *)&section->entry[idx], (void *)&section->entry[idx + 1], (section->nentries - idx - 1) * sizeof(cfg_entry_t));
+	if (cfg_section_unshare(st, section) != CFG_STATUS_OK)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	entry = &section->entry[idx];
+	if (st->subs)
+		cfg_change_notify(st, section, entry, NULL);
+	cfg_name_free(st, entry->key);
+	cfg_str_free(st, entry->value);
+
+	/* the following entries are shifted, so the cache and the indexes have to go */
+	cfg_cache_clear(st);
+	cfg_index_free(st);
+	CFG_FREE(st, section->sorted);
+	section->sorted = NULL;
+
+	if (idx < section->nentries - 1) {
+		memmove((void *)&section->entry[idx], (void *)&section->entry[idx + 1], (section->nentries - idx - 1) * sizeof(cfg_entry_t));
+		memmove((void *)&section->key_hash[idx], (void *)&section->key_hash[idx + 1], (section->nentries - idx - 1) * sizeof(cfg_uint32));
+	}
 
 	section->nentries--;
 	if (section->nentries) {
-		section->entry = (cfg_entry_t *)realloc(section->entry, section->nentries * sizeof(cfg_entry_t));
-		if (!section->entry)
+		section->entry = (cfg_entry_t *)CFG_REALLOC(st, section->entry, section->nentries * sizeof(cfg_entry_t));
+		section->key_hash = (cfg_uint32 *)CFG_REALLOC(st, section->key_hash, section->nentries * sizeof(cfg_uint32));
+		if (!section->entry || !section->key_hash)
 			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
 	} else {
-		free(section->entry);
+		CFG_FREE(st, section->entry);
+		CFG_FREE(st, section->key_hash);
 		section->entry = NULL;
+		section->key_hash = NULL;
 	}
 
+	if (st->subs)
+		cfg_changes_flush(st);
 	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
 }
 
@@ -310,26 +489,47 @@ cfg_status_t cfg_section_delete(cfg_t *st, const cfg_char *section)
 	cfg_entry_t *entry;
 
 	CFG_CHECK_ST_RETURN(st, "cfg_section_delete", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
 
 	section_ptr = cfg_section_get(st, section);
 	if (!section_ptr)
 		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
 
-	for (i = 0; i < section_ptr->nentries; i++) {
+	/* reported once the section is gone */
+	for (i = 0; i < section_ptr->nentries && st->subs; i++)
+		cfg_change_notify(st, section_ptr, &section_ptr->entry[i], NULL);
+	for (i = 0; i < section_ptr->nentries && !section_ptr->shared; i++) {
 		entry = &section_ptr->entry[i];
-		free(entry->key);
-		free(entry->value);
+		cfg_name_free(st, entry->key);
+		cfg_str_free(st, entry->value);
+	}
+	if (!section_ptr->shared) {
+		CFG_FREE(st, section_ptr->entry);
+		CFG_FREE(st, section_ptr->key_hash);
 	}
+	CFG_FREE(st, section_ptr->sorted);
+	section_ptr->shared = CFG_FALSE;
+	section_ptr->entry = NULL;
+	section_ptr->key_hash = NULL;
+	section_ptr->sorted = NULL;
+	section_ptr->nentries = 0;
 
-	free(section_ptr->name);
-	free(section_ptr->entry);
+	cfg_cache_clear(st);
+	cfg_index_free(st);
 
+	/* the root section is always present */
 	idx = section_ptr - &st->section[0];
-	if (idx < st->nsections - 1)
-		memcpy((void *)&st->section[idx], (void *)&st->section[idx + 1], (st->nsections - idx - 1) * sizeof(cfg_section_t));
-	st->nsections--;
-	st->section = (cfg_section_t *)realloc(st->section, st->nsections * sizeof(cfg_section_t));
-	if (!st->section)
-		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	if (idx) {
+		cfg_name_free(st, section_ptr->name);
+		if (idx < st->nsections - 1)
+			memmove((void *)&st->section[idx], (void *)&st->section[idx + 1], (st->nsections - idx - 1) * sizeof(cfg_section_t));
+		st->nsections--;
+		st->section = (cfg_section_t *)CFG_REALLOC(st, st->section, st->nsections * sizeof(cfg_section_t));
+		if (!st->section)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+		cfg_sections_relink(st, 0);
+	}
+	if (st->subs)
+		cfg_changes_flush(st);
 	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
 }
@@ -0,0 +1,288 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * index.c:
+ *	minimal perfect hash index over all section / key pairs
+ */
+
+#include "defines.h"
+
+/* maximum number of displacement seeds tried for a single bucket */
+#define CFG_INDEX_MAX_SEED 0x00ffffff
+
+/* number of keys probed together by cfg_index_entries_get() */
+#define CFG_INDEX_BATCH 64
+
+typedef struct {
+	cfg_uint32 section_hash;
+	cfg_uint32 key_hash;
+	cfg_entry_t *entry;
+} cfg_index_key_t;
+
+/* mix a section / key hash pair with a seed. for a fixed seed and section
+ * the mapping of key hashes is a bijection, so keys of the same section
+ * never collide before the modulo. */
+static cfg_uint32 cfg_index_mix(cfg_uint32 section_hash, cfg_uint32 key_hash, cfg_uint32 seed)
+{
+	cfg_uint32 h = section_hash ^ (seed * 0x9e3779b9);
+	CFG_HASH_FMIX(h);
+	h ^= key_hash;
+	CFG_HASH_FMIX(h);
+	return h;
+}
+
+/* not exposed in the API; called by every change which moves or drops entries */
+void cfg_index_free(cfg_t *st)
+{
+	st->generation++;
+	if (!st->index)
+		return;
+	CFG_FREE(st, st->index->disp);
+	CFG_FREE(st, st->index->slot);
+	CFG_FREE(st, st->index);
+	st->index = NULL;
+}
+
+/* not exposed in the API */
+cfg_entry_t *cfg_index_entry_get(cfg_t *st, cfg_uint32 section_hash, cfg_uint32 key_hash)
+{
+	cfg_index_t *index = st->index;
+	cfg_entry_t *entry;
+	cfg_int disp;
+	cfg_uint32 pos;
+
+	if (!index->nslots)
+		return NULL;
+	disp = index->disp[cfg_index_mix(section_hash, key_hash, 0) % index->nbuckets];
+	if (!disp)
+		return NULL;
+	if (disp < 0)
+		pos = (cfg_uint32)(-disp - 1);
+	else
+		pos = cfg_index_mix(section_hash, key_hash, (cfg_uint32)disp) % index->nslots;
+	entry = index->slot[pos];
+	if (entry->key_hash != key_hash || entry->section->hash != section_hash)
+		return NULL;
+	return entry;
+}
+
+/* not exposed in the API; look up 'n' keys, storing an entry or NULL for each.
+ * the probes run in passes over groups of keys, prefetching what the next
+ * pass reads for all keys of the group before reading any of it. */
+void cfg_index_entries_get(cfg_t *st, const cfg_key_t *keys, cfg_uint32 n, cfg_entry_t **entries)
+{
+	cfg_index_t *index = st->index;
+	cfg_uint32 pos[CFG_INDEX_BATCH], i, count;
+	const cfg_key_t *key;
+	cfg_entry_t *entry;
+	cfg_int disp;
+
+	if (!index->nslots) {
+		for (i = 0; i < n; i++)
+			entries[i] = NULL;
+		return;
+	}
+	for (; n; n -= count, keys += count, entries += count) {
+		count = n < CFG_INDEX_BATCH ? n : CFG_INDEX_BATCH;
+		for (i = 0; i < count; i++) {
+			pos[i] = cfg_index_mix(keys[i].section_hash, keys[i].key_hash, 0) % index->nbuckets;
+			CFG_PREFETCH(&index->disp[pos[i]]);
+		}
+		/* an empty bucket is marked with an out of range slot */
+		for (i = 0; i < count; i++) {
+			key = &keys[i];
+			disp = index->disp[pos[i]];
+			if (!disp)
+				pos[i] = index->nslots;
+			else if (disp < 0)
+				pos[i] = (cfg_uint32)(-disp - 1);
+			else
+				pos[i] = cfg_index_mix(key->section_hash, key->key_hash, (cfg_uint32)disp) % index->nslots;
+			CFG_PREFETCH(&index->slot[pos[i]]);
+		}
+		for (i = 0; i < count; i++) {
+			entries[i] = pos[i] < index->nslots ? index->slot[pos[i]] : NULL;
+			if (entries[i])
+				CFG_PREFETCH(entries[i]);
+		}
+		for (i = 0; i < count; i++) {
+			entry = entries[i];
+			if (entry && (entry->key_hash != keys[i].key_hash || entry->section->hash != keys[i].section_hash))
+				entries[i] = NULL;
+		}
+	}
+}
+
+/* place all keys of a bucket with a common displacement seed; returns the seed
+ * or zero on failure. */
+static cfg_int cfg_index_bucket_place(cfg_index_t *index, cfg_index_key_t *keys, cfg_uint32 *bucket, cfg_uint32 size, cfg_uint32 *pos)
+{
+	cfg_uint32 seed, i, j;
+	cfg_index_key_t *key;
+
+	for (seed = 1; seed <= CFG_INDEX_MAX_SEED; seed++) {
+		for (i = 0; i < size; i++) {
+			key = &keys[bucket[i]];
+			pos[i] = cfg_index_mix(key->section_hash, key->key_hash, seed) % index->nslots;
+			if (index->slot[pos[i]])
+				break;
+			for (j = 0; j < i; j++) {
+				if (pos[j] == pos[i])
+					break;
+			}
+			if (j < i)
+				break;
+		}
+		if (i < size)
+			continue;
+		for (i = 0; i < size; i++)
+			index->slot[pos[i]] = keys[bucket[i]].entry;
+		return (cfg_int)seed;
+	}
+	return 0;
+}
+
+cfg_status_t cfg_optimize(cfg_t *st)
+{
+	cfg_index_t *index = NULL;
+	cfg_index_key_t *keys = NULL, *key;
+	cfg_uint32 *order = NULL, *start = NULL, *by_size = NULL, *size_start = NULL, pos[64];
+	cfg_uint32 i, j, k, n, b, size, max_size, unique, free_slot;
+	cfg_section_t *section;
+	cfg_status_t ret = CFG_ERROR_ALLOC;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_optimize", CFG_ERROR_NULL_PTR);
+	cfg_index_free(st);
+	if (cfg_sections_materialize(st) != CFG_STATUS_OK)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+
+	n = 0;
+	for (i = 0; i < st->nsections; i++)
+		n += st->section[i].nentries;
+
+	index = (cfg_index_t *)cfg_mem_calloc(st, 1, sizeof(cfg_index_t));
+	if (!index)
+		goto exit;
+	index->nbuckets = n ? n : 1;
+	keys = (cfg_index_key_t *)CFG_MALLOC(st, (n + 1) * sizeof(cfg_index_key_t));
+	order = (cfg_uint32 *)CFG_MALLOC(st, (n + 1) * sizeof(cfg_uint32));
+	start = (cfg_uint32 *)cfg_mem_calloc(st, index->nbuckets + 1, sizeof(cfg_uint32));
+	index->disp = (cfg_int *)cfg_mem_calloc(st, index->nbuckets, sizeof(cfg_int));
+	if (!keys || !order || !start || !index->disp)
+		goto exit;
+
+	/* collect the keys and count sort them by bucket, keeping the entry order
+	 * stable so that the first of any duplicates wins like in a linear scan */
+	k = 0;
+	for (i = 0; i < st->nsections; i++) {
+		section = &st->section[i];
+		for (j = 0; j < section->nentries; j++, k++) {
+			key = &keys[k];
+			key->section_hash = section->hash;
+			key->key_hash = section->entry[j].key_hash;
+			key->entry = &section->entry[j];
+			start[cfg_index_mix(key->section_hash, key->key_hash, 0) % index->nbuckets + 1]++;
+		}
+	}
+	for (b = 0; b < index->nbuckets; b++)
+		start[b + 1] += start[b];
+	for (k = 0; k < n; k++) {
+		key = &keys[k];
+		b = cfg_index_mix(key->section_hash, key->key_hash, 0) % index->nbuckets;
+		order[start[b]++] = k;
+	}
+	for (b = index->nbuckets; b > 0; b--)
+		start[b] = start[b - 1];
+	start[0] = 0;
+
+	/* drop duplicate pairs; they always share a bucket */
+	unique = 0;
+	max_size = 0;
+	for (b = 0; b < index->nbuckets; b++) {
+		size = 0;
+		for (i = start[b]; i < start[b + 1]; i++) {
+			key = &keys[order[i]];
+			for (j = start[b]; j < start[b] + size; j++) {
+				if (keys[order[j]].key_hash == key->key_hash && keys[order[j]].section_hash == key->section_hash)
+					break;
+			}
+			if (j < start[b] + size)
+				continue;
+			order[start[b] + size] = order[i];
+			size++;
+		}
+		if (size > max_size)
+			max_size = size;
+		unique += size;
+		/* keep the bucket size in 'disp' until the bucket is placed */
+		index->disp[b] = (cfg_int)size;
+	}
+
+	index->nslots = unique;
+	index->slot = (cfg_entry_t **)cfg_mem_calloc(st, unique + 1, sizeof(cfg_entry_t *));
+	by_size = (cfg_uint32 *)CFG_MALLOC(st, (index->nbuckets + 1) * sizeof(cfg_uint32));
+	size_start = (cfg_uint32 *)cfg_mem_calloc(st, max_size + 2, sizeof(cfg_uint32));
+	if (!index->slot || !by_size || !size_start)
+		goto exit;
+	/* a bucket with more keys than 'pos' holds is not placed, like a bucket
+	 * for which no seed is found */
+	if (max_size > sizeof(pos) / sizeof(pos[0])) {
+		ret = CFG_ERROR_OUT_OF_RANGE;
+		goto exit;
+	}
+
+	/* count sort the non-empty buckets by size, largest first */
+	for (b = 0; b < index->nbuckets; b++)
+		size_start[max_size - (cfg_uint32)index->disp[b]]++;
+	for (i = max_size + 1; i > 0; i--)
+		size_start[i] = size_start[i - 1];
+	size_start[0] = 0;
+	for (i = 0; i < max_size + 1; i++)
+		size_start[i + 1] += size_start[i];
+	for (b = 0; b < index->nbuckets; b++)
+		by_size[size_start[max_size - (cfg_uint32)index->disp[b]]++] = b;
+
+	/* displace the multi-key buckets first; single keys go straight to the
+	 * remaining free slots and store the negated slot position instead */
+	free_slot = 0;
+	for (i = 0; i < index->nbuckets; i++) {
+		b = by_size[i];
+		size = (cfg_uint32)index->disp[b];
+		if (!size)
+			break;
+		if (size > 1) {
+			index->disp[b] = cfg_index_bucket_place(index, keys, &order[start[b]], size, pos);
+			if (!index->disp[b]) {
+				ret = CFG_ERROR_OUT_OF_RANGE;
+				goto exit;
+			}
+			continue;
+		}
+		while (index->slot[free_slot])
+			free_slot++;
+		index->slot[free_slot] = keys[order[start[b]]].entry;
+		index->disp[b] = -(cfg_int)free_slot - 1;
+	}
+
+	st->index = index;
+	index = NULL;
+	ret = CFG_STATUS_OK;
+
+exit:
+	if (index) {
+		CFG_FREE(st, index->disp);
+		CFG_FREE(st, index->slot);
+		CFG_FREE(st, index);
+	}
+	CFG_FREE(st, keys);
+	CFG_FREE(st, order);
+	CFG_FREE(st, start);
+	CFG_FREE(st, by_size);
+	CFG_FREE(st, size_start);
+	CFG_SET_RETURN_STATUS(st, ret);
+}
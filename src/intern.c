@@ -0,0 +1,242 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * intern.c:
+ *	string interning for keys and section names
+ */
+
+#include "defines.h"
+
+#define CFG_INTERN_SLOTS 1024
+#define CFG_INTERN_BLOCK_SZ (64 * 1024)
+
+static cfg_uint32 cfg_intern_slot_idx(cfg_intern_t *intern, cfg_uint32 hash)
+{
+	CFG_HASH_FMIX(hash);
+	return hash & (intern->nslots - 1);
+}
+
+static cfg_status_t cfg_intern_grow(cfg_t *st)
+{
+	cfg_intern_t *intern = st->intern;
+	cfg_intern_slot_t *old = intern->slot, *slot;
+	cfg_uint32 i, idx, nslots = intern->nslots;
+
+	intern->slot = (cfg_intern_slot_t *)cfg_mem_calloc(st, nslots << 1, sizeof(cfg_intern_slot_t));
+	if (!intern->slot) {
+		intern->slot = old;
+		return CFG_ERROR_ALLOC;
+	}
+	intern->nslots = nslots << 1;
+	for (i = 0; i < nslots; i++) {
+		slot = &old[i];
+		if (!slot->str)
+			continue;
+		idx = cfg_intern_slot_idx(intern, slot->hash);
+		while (intern->slot[idx].str)
+			idx = (idx + 1) & (intern->nslots - 1);
+		intern->slot[idx] = *slot;
+	}
+	CFG_FREE(st, old);
+	return CFG_STATUS_OK;
+}
+
+/* copy a string into the current block of the string pool */
+static cfg_char *cfg_intern_store(cfg_t *st, const cfg_char *str, cfg_uint32 len)
+{
+	cfg_intern_t *intern = st->intern;
+	cfg_intern_block_t *block;
+	cfg_uint32 block_size;
+	cfg_char *copy;
+
+	if (!intern->pos || (cfg_uint32)(intern->end - intern->pos) < len + 1) {
+		block_size = len + 1 > CFG_INTERN_BLOCK_SZ ? len + 1 : CFG_INTERN_BLOCK_SZ;
+		block = (cfg_intern_block_t *)CFG_MALLOC(st, sizeof(cfg_intern_block_t) + block_size);
+		if (!block)
+			return NULL;
+		block->next = intern->block;
+		block->size = block_size;
+		intern->block = block;
+		intern->pos = (cfg_char *)(block + 1);
+		intern->end = intern->pos + block_size;
+	}
+	copy = intern->pos;
+	memcpy((void *)copy, (void *)str, len);
+	copy[len] = '\0';
+	intern->pos += len + 1;
+	return copy;
+}
+
+/* not exposed in the API; return the interned copy of a string of known length
+ * and hash, adding it if missing */
+cfg_char *cfg_intern_get(cfg_t *st, const cfg_char *str, cfg_uint32 len, cfg_uint32 hash)
+{
+	cfg_intern_t *intern = st->intern;
+	cfg_intern_slot_t *slot;
+	cfg_uint32 idx;
+
+	idx = cfg_intern_slot_idx(intern, hash);
+	while (CFG_TRUE) {
+		slot = &intern->slot[idx];
+		if (!slot->str)
+			break;
+		if (slot->hash == hash && slot->len == len && !memcmp(slot->str, str, len))
+			return slot->str;
+		idx = (idx + 1) & (intern->nslots - 1);
+	}
+
+	/* keep the load factor under 1/2 */
+	if ((intern->count + 1) << 1 > intern->nslots) {
+		if (cfg_intern_grow(st) != CFG_STATUS_OK)
+			return NULL;
+		return cfg_intern_get(st, str, len, hash);
+	}
+	slot->str = cfg_intern_store(st, str, len);
+	if (!slot->str)
+		return NULL;
+	slot->hash = hash;
+	slot->len = len;
+	intern->count++;
+	return slot->str;
+}
+
+/* not exposed in the API; duplicate a key or section name and return its hash.
+ * with interning the copy is shared and must not be freed directly. */
+cfg_char *cfg_name_dup(cfg_t *st, const cfg_char *str, cfg_uint32 *hash)
+{
+	const cfg_char *ptr;
+	cfg_uint32 h;
+
+	if (!st->intern) {
+		if (hash)
+			*hash = cfg_hash_get(str);
+		return cfg_mem_strdup(st, str);
+	}
+	if (!str) {
+		if (hash)
+			*hash = cfg_hash_get(str);
+		return NULL;
+	}
+	/* hash and measure the string in one pass */
+	h = CFG_HASH_SEED;
+	for (ptr = str; *ptr; ptr++) {
+		h *= h;
+		h ^= *ptr;
+	}
+	if (hash)
+		*hash = h;
+	return cfg_intern_get(st, str, ptr - str, h);
+}
+
+/* not exposed in the API */
+void cfg_name_free(cfg_t *st, cfg_char *str)
+{
+	if (!st->intern)
+		cfg_str_free(st, str);
+}
+
+/* not exposed in the API; drop all interned strings but keep interning on */
+void cfg_intern_clear(cfg_t *st)
+{
+	cfg_intern_t *intern = st->intern;
+	cfg_intern_block_t *block, *next;
+
+	if (!intern)
+		return;
+	for (block = intern->block; block; block = next) {
+		next = block->next;
+		CFG_FREE(st, block);
+	}
+	intern->block = NULL;
+	intern->pos = NULL;
+	intern->end = NULL;
+	intern->count = 0;
+	memset((void *)intern->slot, 0, intern->nslots * sizeof(cfg_intern_slot_t));
+}
+
+/* not exposed in the API; release all interned strings */
+void cfg_intern_free(cfg_t *st)
+{
+	cfg_intern_t *intern = st->intern;
+
+	if (!intern)
+		return;
+	cfg_intern_clear(st);
+	CFG_FREE(st, intern->slot);
+	CFG_FREE(st, intern);
+	st->intern = NULL;
+}
+
+/* copy all keys and section names in or out of the interning table, depending
+ * on st->intern; 'interned' tells if the current copies are interned */
+static cfg_status_t cfg_intern_convert(cfg_t *st, cfg_bool interned)
+{
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	cfg_uint32 i, j;
+	cfg_char *str;
+
+	/* the keys of shared entries cannot be changed in place */
+	if (cfg_sections_unshare(st) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	for (i = 0; i < st->nsections; i++) {
+		section = &st->section[i];
+		if (section->name) {
+			str = cfg_name_dup(st, section->name, NULL);
+			if (!str)
+				return CFG_ERROR_ALLOC;
+			if (!interned)
+				cfg_str_free(st, section->name);
+			section->name = str;
+		}
+		for (j = 0; j < section->nentries; j++) {
+			entry = &section->entry[j];
+			str = cfg_name_dup(st, entry->key, NULL);
+			if (!str)
+				return CFG_ERROR_ALLOC;
+			if (!interned)
+				cfg_str_free(st, entry->key);
+			entry->key = str;
+		}
+	}
+	return CFG_STATUS_OK;
+}
+
+cfg_status_t cfg_intern_set(cfg_t *st, cfg_bool enable)
+{
+	cfg_intern_t *old;
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_intern_set", CFG_ERROR_NULL_PTR);
+	if (!enable == !st->intern)
+		CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+
+	/* disable: copy the names out of the table before releasing it. on
+	 * failure the table is kept, as some names still point into it. */
+	if (!enable) {
+		old = st->intern;
+		st->intern = NULL;
+		ret = cfg_intern_convert(st, CFG_TRUE);
+		st->intern = old;
+		if (ret == CFG_STATUS_OK)
+			cfg_intern_free(st);
+		CFG_SET_RETURN_STATUS(st, ret);
+	}
+
+	st->intern = (cfg_intern_t *)cfg_mem_calloc(st, 1, sizeof(cfg_intern_t));
+	if (!st->intern)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	st->intern->nslots = CFG_INTERN_SLOTS;
+	st->intern->slot = (cfg_intern_slot_t *)cfg_mem_calloc(st, CFG_INTERN_SLOTS, sizeof(cfg_intern_slot_t));
+	if (!st->intern->slot) {
+		cfg_intern_free(st);
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	}
+	ret = cfg_intern_convert(st, CFG_FALSE);
+	CFG_SET_RETURN_STATUS(st, ret);
+}
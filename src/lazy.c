@@ -0,0 +1,63 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * lazy.c:
+ *	parsing the entries of a section on first use
+ */
+
+#include "defines.h"
+
+/* not exposed in the API */
+cfg_char *cfg_raw_section_parse(cfg_t *st, cfg_section_t *section, cfg_char *p);
+
+cfg_status_t cfg_lazy_set(cfg_t *st, cfg_bool enable)
+{
+	CFG_CHECK_ST_RETURN(st, "cfg_lazy_set", CFG_ERROR_NULL_PTR);
+	st->lazy = enable;
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+/* parse the pending entries of a section */
+cfg_status_t cfg_section_materialize(cfg_t *st, cfg_section_t *section)
+{
+	if (!section->raw)
+		return CFG_STATUS_OK;
+	section->entry = (cfg_entry_t *)CFG_MALLOC(st, section->nraw * sizeof(cfg_entry_t));
+	section->key_hash = (cfg_uint32 *)CFG_MALLOC(st, section->nraw * sizeof(cfg_uint32));
+	if (!section->entry || !section->key_hash) {
+		CFG_FREE(st, section->entry);
+		CFG_FREE(st, section->key_hash);
+		section->entry = NULL;
+		section->key_hash = NULL;
+		return CFG_ERROR_ALLOC;
+	}
+	section->nentries = section->nraw;
+	cfg_raw_section_parse(st, section, section->raw);
+	section->raw = NULL;
+	section->nraw = 0;
+	return CFG_STATUS_OK;
+}
+
+/* parse all pending sections, for functions that walk every entry */
+cfg_status_t cfg_sections_materialize(cfg_t *st)
+{
+	cfg_uint32 i;
+	cfg_status_t ret;
+
+	if (!st->lazy_buf)
+		return CFG_STATUS_OK;
+	for (i = 0; i < st->nsections; i++) {
+		ret = cfg_section_materialize(st, &st->section[i]);
+		if (ret != CFG_STATUS_OK)
+			return ret;
+	}
+	/* nothing points into the buffer anymore */
+	CFG_FREE(st, st->lazy_buf);
+	st->lazy_buf = NULL;
+	return CFG_STATUS_OK;
+}
@@ -0,0 +1,209 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * memory.c:
+ *	memory accounting and compacting the strings of an object
+ */
+
+#include "defines.h"
+
+/* is 'str' in the string block of cfg_shrink()? */
+static cfg_bool cfg_memory_in_block(cfg_t *st, const cfg_char *str)
+{
+	return st->strings && str >= st->strings && str < st->strings + st->strings_size;
+}
+
+/* add a key, value or name which is not interned to 'stats' */
+static void cfg_memory_str_add(cfg_t *st, cfg_memory_stats_t *stats, const cfg_char *str, size_t *live)
+{
+	if (!str || cfg_shared_str(st, str))
+		return;
+	if (cfg_memory_in_block(st, str)) {
+		*live += strlen(str) + 1;
+		return;
+	}
+	stats->strings += strlen(str) + 1;
+	stats->allocations++;
+}
+
+cfg_status_t cfg_memory_stats(cfg_t *st, cfg_memory_stats_t *stats)
+{
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	cfg_intern_block_t *block;
+	cfg_shared_t *shared;
+	cfg_uint32 i, j;
+	size_t live = 0;
+	cfg_bool pending = CFG_FALSE;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_memory_stats", CFG_ERROR_NULL_PTR);
+	if (!stats)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	memset((void *)stats, 0, sizeof(cfg_memory_stats_t));
+
+	stats->other = sizeof(cfg_t);
+	stats->allocations = 1;
+	if (st->section) {
+		stats->sections = st->nsections * sizeof(cfg_section_t);
+		stats->allocations++;
+	}
+	/* pending sections of a lazy parse are only counted in the lazy buffer */
+	for (i = 0; i < st->nsections; i++) {
+		section = &st->section[i];
+		pending |= section->raw != NULL;
+		if (!st->intern)
+			cfg_memory_str_add(st, stats, section->name, &live);
+		if (section->sorted) {
+			stats->entries += section->nentries * sizeof(cfg_entry_t *);
+			stats->allocations++;
+		}
+		if (section->shared)
+			continue;
+		if (section->entry) {
+			stats->entries += section->nentries * (sizeof(cfg_entry_t) + sizeof(cfg_uint32));
+			stats->allocations += 2;
+		}
+		for (j = 0; j < section->nentries; j++) {
+			entry = &section->entry[j];
+			if (!st->intern)
+				cfg_memory_str_add(st, stats, entry->key, &live);
+			cfg_memory_str_add(st, stats, entry->value, &live);
+		}
+	}
+	if (st->strings) {
+		stats->strings += st->strings_size;
+		stats->wasted += st->strings_size - live;
+		stats->allocations++;
+	}
+
+	if (st->shared) {
+		shared = st->shared;
+		stats->shared = sizeof(cfg_shared_t) + shared->nsections * sizeof(cfg_section_t) + shared->strings_size +
+			shared->nslots * sizeof(cfg_intern_slot_t);
+		for (i = 0; i < shared->nsections; i++)
+			stats->shared += shared->section[i].nentries * (sizeof(cfg_entry_t) + sizeof(cfg_uint32));
+		for (block = shared->block; block; block = block->next)
+			stats->shared += sizeof(cfg_intern_block_t) + block->size;
+	}
+	if (st->intern) {
+		stats->intern = sizeof(cfg_intern_t) + st->intern->nslots * sizeof(cfg_intern_slot_t);
+		stats->allocations += 2;
+		for (block = st->intern->block; block; block = block->next) {
+			stats->intern += sizeof(cfg_intern_block_t) + block->size;
+			stats->allocations++;
+		}
+		stats->wasted += st->intern->end - st->intern->pos;
+	}
+	if (st->cache) {
+		stats->cache = st->cache_size * sizeof(cfg_entry_t *);
+		stats->allocations++;
+	}
+	if (st->index) {
+		stats->index = sizeof(cfg_index_t) + st->index->nbuckets * sizeof(cfg_int) +
+			(st->index->nslots + 1) * sizeof(cfg_entry_t *);
+		stats->allocations += 3;
+	}
+	if (st->snapshot_dir) {
+		stats->other += strlen(st->snapshot_dir) + 1;
+		stats->allocations++;
+	}
+	if (st->diagnostics.size) {
+		stats->other += st->diagnostics.size * sizeof(cfg_diagnostic_t);
+		stats->allocations++;
+	}
+	if (st->lazy_buf) {
+		stats->other += st->lazy_size;
+		stats->allocations++;
+		/* kept until cfg_shrink() or a call that parses all sections */
+		if (!pending)
+			stats->wasted += st->lazy_size;
+	}
+
+	stats->total = stats->sections + stats->entries + stats->strings + stats->intern +
+		stats->cache + stats->index + stats->other;
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+/* the size of a string in the block of cfg_shrink(); strings shared with
+ * clones stay where they are */
+static size_t cfg_shrink_len(cfg_t *st, const cfg_char *str)
+{
+	return !str || cfg_shared_str(st, str) ? 0 : strlen(str) + 1;
+}
+
+/* copy a string to 'p' and free the old copy */
+static cfg_char *cfg_shrink_str(cfg_t *st, cfg_char **str, cfg_char *p)
+{
+	size_t len;
+
+	if (!*str || cfg_shared_str(st, *str))
+		return p;
+	len = strlen(*str) + 1;
+	memcpy((void *)p, (void *)*str, len);
+	cfg_str_free(st, *str);
+	*str = p;
+	return p + len;
+}
+
+cfg_status_t cfg_shrink(cfg_t *st)
+{
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	cfg_char *block, *p;
+	cfg_uint32 i, j;
+	size_t size = 0;
+	cfg_bool pending = CFG_FALSE;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_shrink", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
+
+	/* unescape the raw values first, as that changes their length */
+	for (i = 0; i < st->nsections; i++) {
+		section = &st->section[i];
+		pending |= section->raw != NULL;
+		if (!st->intern)
+			size += cfg_shrink_len(st, section->name);
+		/* shared entries are never raw */
+		for (j = 0; j < section->nentries && !section->shared; j++) {
+			entry = &section->entry[j];
+			if (!st->intern)
+				size += cfg_shrink_len(st, entry->key);
+			size += cfg_shrink_len(st, CFG_ENTRY_VALUE(entry));
+		}
+	}
+
+	/* the arrays are allocated to their exact size, so only the strings move;
+	 * the entries keep their addresses and the cache and index stay valid */
+	block = NULL;
+	if (size) {
+		block = (cfg_char *)CFG_MALLOC(st, size);
+		if (!block)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+		p = block;
+		for (i = 0; i < st->nsections; i++) {
+			section = &st->section[i];
+			if (!st->intern)
+				p = cfg_shrink_str(st, &section->name, p);
+			for (j = 0; j < section->nentries && !section->shared; j++) {
+				entry = &section->entry[j];
+				if (!st->intern)
+					p = cfg_shrink_str(st, &entry->key, p);
+				p = cfg_shrink_str(st, &entry->value, p);
+			}
+		}
+	}
+	CFG_FREE(st, st->strings);
+	st->strings = block;
+	st->strings_size = size;
+
+	if (st->lazy_buf && !pending) {
+		CFG_FREE(st, st->lazy_buf);
+		st->lazy_buf = NULL;
+	}
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
@@ -0,0 +1,336 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * merge.c:
+ *	merging the sections and entries of one object into another
+ */
+
+#include "defines.h"
+
+/* sections with up to this many entries are searched without a table */
+#define CFG_MERGE_SCAN_MAX 32
+
+/* not exposed in the API */
+void cfg_index_free(cfg_t *st);
+void cfg_sections_relink(cfg_t *st, cfg_uint32 n);
+
+/* not exposed in the API; also used by diff.c */
+cfg_status_t cfg_merge_table_init(cfg_t *st, cfg_merge_table_t *table, cfg_uint32 n)
+{
+	for (table->nslots = 16; table->nslots < n << 1; table->nslots <<= 1)
+		;
+	table->slot = (cfg_uint32 *)CFG_MALLOC(st, table->nslots * sizeof(cfg_uint32));
+	if (!table->slot)
+		return CFG_ERROR_ALLOC;
+	memset((void *)table->slot, 0, table->nslots * sizeof(cfg_uint32));
+	return CFG_STATUS_OK;
+}
+
+/* not exposed in the API; the slot of the first position with 'hash' in
+ * 'hashes', or an empty one */
+cfg_uint32 *cfg_merge_table_find(cfg_merge_table_t *table, const cfg_uint32 *hashes, cfg_uint32 hash)
+{
+	cfg_uint32 h = hash, mask = table->nslots - 1, *slot;
+
+	CFG_HASH_FMIX(h);
+	for (slot = &table->slot[h & mask]; *slot; slot = &table->slot[++h & mask]) {
+		if (hashes[*slot - 1] == hash)
+			break;
+	}
+	return slot;
+}
+
+/* state of one merge */
+typedef struct {
+	cfg_t *dst;
+	cfg_t *src;
+	cfg_merge_policy_t policy;
+	cfg_bool move;
+	cfg_bool check; /* only look for conflicts */
+	cfg_merge_table_t keys; /* positions in the section of 'dst' */
+	cfg_uchar *set; /* the entries of the section of 'dst' set by 'src' */
+} cfg_merge_t;
+
+/* the position of the first entry with 'hash' in 'section'; in 'nentries' if
+ * there is none. with a table an empty slot is returned in 'slot'. */
+static cfg_uint32 cfg_merge_entry_find(cfg_merge_t *m, cfg_section_t *section, cfg_uint32 hash, cfg_uint32 **slot)
+{
+	if (!m->keys.slot)
+		return cfg_hash_find(section->key_hash, section->nentries, hash);
+	*slot = cfg_merge_table_find(&m->keys, section->key_hash, hash);
+	return **slot ? **slot - 1 : section->nentries;
+}
+
+/* take a key or value from 'src' or copy it */
+static cfg_char *cfg_merge_str(cfg_t *dst, cfg_char **str, cfg_bool move, cfg_bool name)
+{
+	cfg_char *ret;
+
+	if (move) {
+		ret = *str;
+		*str = NULL;
+		return ret;
+	}
+	return name ? cfg_name_dup(dst, *str, NULL) : cfg_mem_strdup(dst, *str);
+}
+
+/* resize the sections of 'st' to 'n'; the entries are relinked if they move */
+static cfg_status_t cfg_merge_sections_resize(cfg_t *st, cfg_uint32 n)
+{
+	cfg_section_t *section, *old = st->section;
+
+	if (!n)
+		return CFG_STATUS_OK;
+	section = (cfg_section_t *)CFG_REALLOC(st, st->section, n * sizeof(cfg_section_t));
+	if (!section)
+		return CFG_ERROR_ALLOC;
+	st->section = section;
+	if (st->section != old)
+		cfg_sections_relink(st, 0);
+	return CFG_STATUS_OK;
+}
+
+/* a new section of 'dst' with the name of 'from'; there must be room for it */
+static cfg_section_t *cfg_merge_section_add(cfg_t *st, cfg_section_t *from)
+{
+	cfg_section_t *section = &st->section[st->nsections];
+
+	section->name = cfg_name_dup(st, from->name, &section->hash);
+	if (from->name && !section->name)
+		return NULL;
+	section->nentries = 0;
+	section->entry = NULL;
+	section->key_hash = NULL;
+	section->sorted = NULL;
+	section->raw = NULL;
+	section->nraw = 0;
+	section->shared = CFG_FALSE;
+	st->nsections++;
+	return section;
+}
+
+/* merge the entries of 'from' into 'to'. the key hashes of 'to' are put in a
+ * table first unless there are only a few of them; appended keys go to the
+ * table too, so that a key repeated in 'from' is found and merged only once. */
+static cfg_status_t cfg_merge_section(cfg_merge_t *m, cfg_section_t *to, cfg_section_t *from)
+{
+	cfg_t *dst = m->dst;
+	cfg_entry_t *entry, *src_entry;
+	cfg_uint32 i, k, base = to ? to->nentries : 0, *key_hash, *slot = NULL;
+	cfg_status_t ret = CFG_STATUS_OK;
+	cfg_bool changed;
+
+	if (!from->nentries || (m->check && !base))
+		return CFG_STATUS_OK;
+
+	m->keys.slot = NULL;
+	m->set = NULL;
+	if (base + from->nentries > CFG_MERGE_SCAN_MAX) {
+		if (cfg_merge_table_init(dst, &m->keys, base + from->nentries) != CFG_STATUS_OK)
+			return CFG_ERROR_ALLOC;
+		for (i = 0; i < base; i++) {
+			slot = cfg_merge_table_find(&m->keys, to->key_hash, to->key_hash[i]);
+			if (!*slot)
+				*slot = i + 1;
+		}
+	}
+	if (base && (m->check || m->policy == CFG_MERGE_OVERRIDE)) {
+		m->set = (cfg_uchar *)CFG_MALLOC(dst, base);
+		if (!m->set) {
+			CFG_FREE(dst, m->keys.slot);
+			return CFG_ERROR_ALLOC;
+		}
+		memset((void *)m->set, 0, base);
+	}
+
+	if (m->check) {
+		for (i = 0; i < from->nentries; i++) {
+			k = cfg_merge_entry_find(m, to, from->key_hash[i], &slot);
+			if (k >= base || m->set[k])
+				continue;
+			m->set[k] = CFG_TRUE;
+			if (strcmp(CFG_ENTRY_VALUE(&to->entry[k]), CFG_ENTRY_VALUE(&from->entry[i]))) {
+				ret = CFG_ERROR_CONFLICT;
+				break;
+			}
+		}
+		CFG_FREE(dst, m->keys.slot);
+		CFG_FREE(dst, m->set);
+		return ret;
+	}
+
+	/* room for all entries of 'from'; trimmed at the end */
+	if (cfg_section_unshare(dst, to) != CFG_STATUS_OK) {
+		CFG_FREE(dst, m->keys.slot);
+		CFG_FREE(dst, m->set);
+		return CFG_ERROR_ALLOC;
+	}
+	CFG_FREE(dst, to->sorted);
+	to->sorted = NULL;
+	key_hash = (cfg_uint32 *)CFG_REALLOC(dst, to->key_hash, (base + from->nentries) * sizeof(cfg_uint32));
+	if (key_hash)
+		to->key_hash = key_hash;
+	entry = (cfg_entry_t *)CFG_REALLOC(dst, to->entry, (base + from->nentries) * sizeof(cfg_entry_t));
+	if (entry)
+		to->entry = entry;
+	if (!key_hash || !entry) {
+		CFG_FREE(dst, m->keys.slot);
+		CFG_FREE(dst, m->set);
+		return CFG_ERROR_ALLOC;
+	}
+
+	for (i = 0; i < from->nentries; i++) {
+		src_entry = &from->entry[i];
+		k = cfg_merge_entry_find(m, to, from->key_hash[i], &slot);
+		if (k < base) {
+			if (m->policy != CFG_MERGE_OVERRIDE || m->set[k])
+				continue;
+			m->set[k] = CFG_TRUE;
+			entry = &to->entry[k];
+			changed = dst->subs && strcmp(CFG_ENTRY_VALUE(entry), CFG_ENTRY_VALUE(src_entry));
+			cfg_str_free(dst, entry->value);
+		} else if (k < to->nentries) {
+			continue; /* repeated in 'from' */
+		} else {
+			entry = &to->entry[to->nentries];
+			entry->section = to;
+			entry->key_hash = from->key_hash[i];
+			entry->key = cfg_merge_str(dst, &src_entry->key, m->move, CFG_TRUE);
+			to->key_hash[to->nentries] = entry->key_hash;
+			to->nentries++;
+			changed = dst->subs != NULL;
+			if (m->keys.slot)
+				*slot = to->nentries;
+			if (!entry->key && src_entry->key) {
+				entry->value = NULL;
+				ret = CFG_ERROR_ALLOC;
+				break;
+			}
+		}
+		entry->flags = src_entry->flags;
+		entry->value = cfg_merge_str(dst, &src_entry->value, m->move, CFG_FALSE);
+		if (!entry->value) {
+			ret = CFG_ERROR_ALLOC;
+			break;
+		}
+		if (changed)
+			cfg_change_notify(dst, to, entry, entry->value);
+	}
+	CFG_FREE(dst, m->keys.slot);
+	CFG_FREE(dst, m->set);
+
+	to->key_hash = (cfg_uint32 *)CFG_REALLOC(dst, to->key_hash, to->nentries * sizeof(cfg_uint32));
+	to->entry = (cfg_entry_t *)CFG_REALLOC(dst, to->entry, to->nentries * sizeof(cfg_entry_t));
+	if (to->nentries && (!to->key_hash || !to->entry))
+		return CFG_ERROR_ALLOC;
+	return ret;
+}
+
+/* one pass over the sections of 'src'; the sections of 'dst' are found
+ * through a table of their hashes. */
+static cfg_status_t cfg_merge_pass(cfg_merge_t *m)
+{
+	cfg_merge_table_t sections;
+	cfg_section_t *to;
+	cfg_uint32 i, *slot, *section_hash = NULL;
+	cfg_status_t ret = CFG_STATUS_OK;
+
+	if (cfg_merge_table_init(m->dst, &sections, m->dst->nsections + m->src->nsections) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	/* the section hashes in an array, as the table looks them up by position */
+	section_hash = (cfg_uint32 *)CFG_MALLOC(m->dst, (m->dst->nsections + m->src->nsections) * sizeof(cfg_uint32));
+	if (!section_hash) {
+		CFG_FREE(m->dst, sections.slot);
+		return CFG_ERROR_ALLOC;
+	}
+	for (i = 0; i < m->dst->nsections; i++) {
+		section_hash[i] = m->dst->section[i].hash;
+		slot = cfg_merge_table_find(&sections, section_hash, section_hash[i]);
+		if (!*slot)
+			*slot = i + 1;
+	}
+
+	/* room for all sections of 'src', as moving the sections means relinking
+	 * all entries; trimmed at the end */
+	if (!m->check)
+		ret = cfg_merge_sections_resize(m->dst, m->dst->nsections + m->src->nsections);
+
+	for (i = 0; i < m->src->nsections && ret == CFG_STATUS_OK; i++) {
+		slot = cfg_merge_table_find(&sections, section_hash, m->src->section[i].hash);
+		to = *slot ? &m->dst->section[*slot - 1] : NULL;
+		if (!to && !m->check) {
+			to = cfg_merge_section_add(m->dst, &m->src->section[i]);
+			if (!to) {
+				ret = CFG_ERROR_ALLOC;
+				break;
+			}
+			section_hash[m->dst->nsections - 1] = to->hash;
+			*slot = m->dst->nsections;
+		}
+		ret = cfg_merge_section(m, to, &m->src->section[i]);
+	}
+	CFG_FREE(m->dst, section_hash);
+	CFG_FREE(m->dst, sections.slot);
+	if (!m->check && cfg_merge_sections_resize(m->dst, m->dst->nsections) != CFG_STATUS_OK)
+		ret = CFG_ERROR_ALLOC;
+	return ret;
+}
+
+/* not exposed in the API; merge the sections and entries of 'src' into 'dst'.
+ * new sections and keys are appended in the order of 'src'. if a key repeats
+ * in a section of 'src' only the first one, which lookups return, is merged.
+ * with 'consume' the keys and values are moved out of 'src' if both objects
+ * use the same allocator. */
+cfg_status_t cfg_tree_merge(cfg_t *dst, cfg_t *src, cfg_merge_policy_t policy, cfg_bool consume)
+{
+	cfg_merge_t m;
+	cfg_status_t ret;
+
+	if (cfg_sections_materialize(dst) != CFG_STATUS_OK || cfg_sections_materialize(src) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	m.dst = dst;
+	m.src = src;
+	m.policy = policy;
+	m.move = consume && !dst->intern && !src->intern && !src->strings && !src->shared &&
+		dst->allocator.malloc_fn == src->allocator.malloc_fn &&
+		dst->allocator.free_fn == src->allocator.free_fn &&
+		dst->allocator.ctx == src->allocator.ctx;
+
+	/* look for conflicts before changing anything */
+	if (policy == CFG_MERGE_ERROR) {
+		m.check = CFG_TRUE;
+		ret = cfg_merge_pass(&m);
+		if (ret != CFG_STATUS_OK)
+			return ret;
+	}
+	m.check = CFG_FALSE;
+	cfg_index_free(dst);
+	cfg_cache_clear(dst);
+	return cfg_merge_pass(&m);
+}
+
+cfg_status_t cfg_merge(cfg_t *dst, cfg_t *src, cfg_merge_policy_t policy, cfg_bool consume)
+{
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(dst, "cfg_merge", CFG_ERROR_NULL_PTR);
+	if (!src)
+		CFG_SET_RETURN_STATUS(dst, CFG_ERROR_NULL_PTR);
+	if (src == dst)
+		CFG_SET_RETURN_STATUS(dst, CFG_ERROR_OUT_OF_RANGE);
+	CFG_CHECK_ASYNC_RETURN(dst, CFG_ERROR_BUSY);
+	/* both objects are read and can be changed */
+	if (src->async && cfg_parse_check(src) != CFG_STATUS_OK)
+		CFG_SET_RETURN_STATUS(dst, CFG_ERROR_BUSY);
+	ret = cfg_tree_merge(dst, src, policy, consume);
+	if (dst->subs)
+		cfg_changes_flush(dst);
+	if (ret == CFG_STATUS_OK && consume)
+		cfg_clear(src);
+	CFG_SET_RETURN_STATUS(dst, ret);
+}
@@ -0,0 +1,206 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * overlay.c:
+ *	lookups through a stack of library objects
+ */
+
+#include <stdio.h>
+#include "defines.h"
+
+#define CFG_CHECK_OVERLAY_RETURN(_overlay, _fname, _ret) \
+	if (!_overlay) { \
+		fprintf(stderr, "[cfg2] %s(): %s\n", _fname, "the cfg_overlay_t pointer cannot bet NULL!"); \
+		return _ret; \
+	}
+
+cfg_overlay_t *cfg_overlay_alloc(void)
+{
+	cfg_overlay_t *overlay = (cfg_overlay_t *)malloc(sizeof(cfg_overlay_t));
+
+	if (!overlay) {
+		fprintf(stderr, "[cfg2] cfg_overlay_alloc(): cannot allocate a cfg_overlay_t object!\n");
+		return NULL;
+	}
+	overlay->nlayers = 0;
+	overlay->nslots = 0;
+	overlay->slot = NULL;
+	return overlay;
+}
+
+static void cfg_overlay_table_free(cfg_overlay_t *overlay)
+{
+	free(overlay->slot);
+	overlay->slot = NULL;
+	overlay->nslots = 0;
+}
+
+cfg_status_t cfg_overlay_free(cfg_overlay_t *overlay)
+{
+	CFG_CHECK_OVERLAY_RETURN(overlay, "cfg_overlay_free", CFG_ERROR_NULL_PTR);
+	cfg_overlay_table_free(overlay);
+	free(overlay);
+	return CFG_STATUS_OK;
+}
+
+cfg_status_t cfg_overlay_push(cfg_overlay_t *overlay, cfg_t *layer)
+{
+	CFG_CHECK_OVERLAY_RETURN(overlay, "cfg_overlay_push", CFG_ERROR_NULL_PTR);
+	if (!layer)
+		return CFG_ERROR_NULL_PTR;
+	if (overlay->nlayers == CFG_OVERLAY_MAX)
+		return CFG_ERROR_OUT_OF_RANGE;
+	cfg_overlay_table_free(overlay);
+	overlay->layer[overlay->nlayers++] = layer;
+	return CFG_STATUS_OK;
+}
+
+cfg_status_t cfg_overlay_pop(cfg_overlay_t *overlay)
+{
+	CFG_CHECK_OVERLAY_RETURN(overlay, "cfg_overlay_pop", CFG_ERROR_NULL_PTR);
+	if (!overlay->nlayers)
+		return CFG_ERROR_OUT_OF_RANGE;
+	cfg_overlay_table_free(overlay);
+	overlay->nlayers--;
+	return CFG_STATUS_OK;
+}
+
+static cfg_uint32 cfg_overlay_slot_hash(cfg_uint32 section_hash, cfg_uint32 key_hash)
+{
+	cfg_uint32 h = section_hash ^ (key_hash * 0x9e3779b9);
+	CFG_HASH_FMIX(h);
+	return h;
+}
+
+/* build a table of the topmost entry of every section / key pair, so that a
+ * lookup costs one probe for any number of layers. the layers are walked from
+ * the top down and each keeps the first entry of a repeated key, like their
+ * lookups. only pointers to the entries of the layers are stored. */
+static cfg_status_t cfg_overlay_table_build(cfg_overlay_t *overlay)
+{
+	cfg_overlay_slot_t *slot;
+	cfg_section_t *section;
+	cfg_t *layer;
+	cfg_uint32 i, j, k, n = 0, mask;
+
+	cfg_overlay_table_free(overlay);
+	for (i = 0; i < overlay->nlayers; i++) {
+		layer = overlay->layer[i];
+		if (cfg_sections_materialize(layer) != CFG_STATUS_OK)
+			return CFG_ERROR_ALLOC;
+		for (j = 0; j < layer->nsections; j++)
+			n += layer->section[j].nentries;
+	}
+	/* at most half full */
+	for (overlay->nslots = 16; overlay->nslots < n << 1; overlay->nslots <<= 1)
+		;
+	overlay->slot = (cfg_overlay_slot_t *)calloc(overlay->nslots, sizeof(cfg_overlay_slot_t));
+	if (!overlay->slot) {
+		overlay->nslots = 0;
+		return CFG_ERROR_ALLOC;
+	}
+	mask = overlay->nslots - 1;
+
+	for (i = overlay->nlayers; i--;) {
+		layer = overlay->layer[i];
+		overlay->generation[i] = layer->generation;
+		for (j = 0; j < layer->nsections; j++) {
+			section = &layer->section[j];
+			for (k = 0; k < section->nentries; k++) {
+				slot = &overlay->slot[cfg_overlay_slot_hash(section->hash, section->key_hash[k]) & mask];
+				while (slot->entry && (slot->key_hash != section->key_hash[k] || slot->section_hash != section->hash))
+					slot = slot == &overlay->slot[mask] ? overlay->slot : slot + 1;
+				if (slot->entry)
+					continue;
+				slot->section_hash = section->hash;
+				slot->key_hash = section->key_hash[k];
+				slot->entry = &section->entry[k];
+			}
+		}
+	}
+	return CFG_STATUS_OK;
+}
+
+/* the table is dropped when a layer is pushed or popped and rebuilt when an
+ * entry of a layer moves or goes away, e.g. when a layer is parsed again or
+ * gets a new key. without memory for it each layer is probed in turn. */
+cfg_entry_t *cfg_overlay_key_entry_get(cfg_overlay_t *overlay, const cfg_key_t *key)
+{
+	cfg_overlay_slot_t *slot;
+	cfg_entry_t *entry;
+	cfg_uint32 i, mask;
+
+	CFG_CHECK_OVERLAY_RETURN(overlay, "cfg_overlay_key_entry_get", NULL);
+	if (!key)
+		return NULL;
+	for (i = 0; i < overlay->nlayers && overlay->slot; i++) {
+		if (overlay->generation[i] != overlay->layer[i]->generation)
+			break;
+	}
+	if ((!overlay->slot || i < overlay->nlayers) && cfg_overlay_table_build(overlay) != CFG_STATUS_OK) {
+		for (i = overlay->nlayers; i--;) {
+			entry = cfg_key_entry_get(overlay->layer[i], key);
+			if (entry)
+				return entry;
+		}
+		return NULL;
+	}
+
+	mask = overlay->nslots - 1;
+	slot = &overlay->slot[cfg_overlay_slot_hash(key->section_hash, key->key_hash) & mask];
+	while (slot->entry) {
+		if (slot->key_hash == key->key_hash && slot->section_hash == key->section_hash)
+			return slot->entry;
+		slot = slot == &overlay->slot[mask] ? overlay->slot : slot + 1;
+	}
+	return NULL;
+}
+
+cfg_char *cfg_overlay_key_value_get(cfg_overlay_t *overlay, const cfg_key_t *key)
+{
+	cfg_entry_t *entry = cfg_overlay_key_entry_get(overlay, key);
+	return entry ? CFG_ENTRY_VALUE(entry) : NULL;
+}
+
+cfg_entry_t *cfg_overlay_entry_get(cfg_overlay_t *overlay, const cfg_char *section, const cfg_char *key)
+{
+	cfg_key_t handle = cfg_key_make(section, key);
+	return cfg_overlay_key_entry_get(overlay, &handle);
+}
+
+cfg_char *cfg_overlay_value_get(cfg_overlay_t *overlay, const cfg_char *section, const cfg_char *key)
+{
+	cfg_key_t handle = cfg_key_make(section, key);
+	return cfg_overlay_key_value_get(overlay, &handle);
+}
+
+cfg_status_t cfg_overlay_value_set(cfg_overlay_t *overlay, const cfg_char *section, const cfg_char *key, const cfg_char *value)
+{
+	CFG_CHECK_OVERLAY_RETURN(overlay, "cfg_overlay_value_set", CFG_ERROR_NULL_PTR);
+	if (!overlay->nlayers)
+		return CFG_ERROR_NOT_FOUND;
+	return cfg_value_set(overlay->layer[overlay->nlayers - 1], section, key, value, CFG_TRUE);
+}
+
+cfg_t *cfg_overlay_flatten(cfg_overlay_t *overlay)
+{
+	cfg_t *st;
+	cfg_uint32 i;
+
+	CFG_CHECK_OVERLAY_RETURN(overlay, "cfg_overlay_flatten", NULL);
+	st = cfg_alloc();
+	if (!st)
+		return NULL;
+	for (i = 0; i < overlay->nlayers; i++) {
+		if (cfg_tree_merge(st, overlay->layer[i], CFG_MERGE_OVERRIDE, CFG_FALSE) != CFG_STATUS_OK) {
+			cfg_free(st);
+			return NULL;
+		}
+	}
+	return st;
+}
@@ -0,0 +1,329 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * snapshot.c:
+ *	pre-parsed snapshots of files, stored in a cache directory
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef _WIN32
+#	include <process.h>
+#	define getpid _getpid
+#else
+#	include <unistd.h>
+#endif
+#include "defines.h"
+
+#define CFG_SNAPSHOT_MAGIC "cfg2snap"
+#define CFG_SNAPSHOT_MAGIC_LEN 8
+#define CFG_SNAPSHOT_VERSION 1
+/* the stored entries depend on the duplicate key policy of the parse */
+#define CFG_SNAPSHOT_FORMAT(st) (CFG_SNAPSHOT_VERSION | (cfg_uint32)(st)->duplicates << 16)
+#define CFG_SNAPSHOT_NULL 0xffffffff
+#define CFG_SNAPSHOT_HEADER_LEN (CFG_SNAPSHOT_MAGIC_LEN + 2 * sizeof(cfg_uint32) + 3 * sizeof(cfg_long))
+
+/* numbers the temporary files of the snapshots written by this process */
+static volatile cfg_uint32 cfg_snapshot_count;
+
+/* a bounds checked read position in a snapshot buffer */
+typedef struct {
+	cfg_char *pos;
+	cfg_char *end;
+} cfg_snapshot_reader_t;
+
+cfg_status_t cfg_snapshot_dir_set(cfg_t *st, const cfg_char *dir)
+{
+	CFG_CHECK_ST_RETURN(st, "cfg_snapshot_dir_set", CFG_ERROR_NULL_PTR);
+	CFG_FREE(st, st->snapshot_dir);
+	st->snapshot_dir = NULL;
+	if (dir) {
+		st->snapshot_dir = cfg_mem_strdup(st, dir);
+		if (!st->snapshot_dir)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	}
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+/* the snapshot for a file is named after the hash of its path */
+static cfg_char *cfg_snapshot_path(cfg_t *st, const cfg_char *filename)
+{
+	cfg_char *path;
+	cfg_uint32 n;
+
+	n = strlen(st->snapshot_dir);
+	path = (cfg_char *)CFG_MALLOC(st, n + 16);
+	if (!path)
+		return NULL;
+	sprintf(path, "%s/%08x.snap", st->snapshot_dir, (unsigned int)cfg_hash_get(filename));
+	return path;
+}
+
+/* not exposed in the API */
+cfg_status_t cfg_snapshot_stamp_get(const cfg_char *filename, cfg_snapshot_stamp_t *stamp)
+{
+	struct stat info;
+	time_t now = time(NULL);
+
+	if (stat(filename, &info))
+		return CFG_ERROR_FILE;
+	stamp->size = (cfg_long)info.st_size;
+	stamp->mtime = (cfg_long)info.st_mtime;
+	stamp->inode = (cfg_long)info.st_ino;
+	/* the modification time has a resolution of a second, so an edit later in
+	 * the same second keeps the size and the stamp */
+	stamp->recent = info.st_mtime >= now;
+	return CFG_STATUS_OK;
+}
+
+static cfg_bool cfg_snapshot_read(cfg_snapshot_reader_t *rd, void *out, cfg_uint32 n)
+{
+	if ((size_t)(rd->end - rd->pos) < n)
+		return CFG_FALSE;
+	memcpy(out, (void *)rd->pos, n);
+	rd->pos += n;
+	return CFG_TRUE;
+}
+
+/* read a string; names (keys and sections) with a known hash are interned
+ * if interning is enabled */
+static cfg_bool cfg_snapshot_read_string(cfg_t *st, cfg_snapshot_reader_t *rd, cfg_char **out, const cfg_uint32 *name_hash)
+{
+	cfg_uint32 n;
+
+	*out = NULL;
+	if (!cfg_snapshot_read(rd, &n, sizeof(n)))
+		return CFG_FALSE;
+	if (n == CFG_SNAPSHOT_NULL)
+		return CFG_TRUE;
+	if ((size_t)(rd->end - rd->pos) < n)
+		return CFG_FALSE;
+	if (name_hash && st->intern) {
+		*out = cfg_intern_get(st, rd->pos, n, *name_hash);
+		rd->pos += n;
+		return *out != NULL;
+	}
+	*out = (cfg_char *)CFG_MALLOC(st, n + 1);
+	if (!*out)
+		return CFG_FALSE;
+	memcpy((void *)*out, (void *)rd->pos, n);
+	(*out)[n] = '\0';
+	rd->pos += n;
+	return CFG_TRUE;
+}
+
+/* not exposed in the API */
+cfg_status_t cfg_snapshot_load(cfg_t *st, const cfg_char *filename, const cfg_snapshot_stamp_t *stamp)
+{
+	cfg_snapshot_reader_t rd;
+	cfg_snapshot_stamp_t saved;
+	cfg_char *path, *buf = NULL, magic[CFG_SNAPSHOT_MAGIC_LEN];
+	cfg_uint32 version, path_len, nsections, n, i, j;
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	cfg_status_t ret = CFG_ERROR_NOT_FOUND;
+	size_t sz;
+	FILE *f;
+
+	path = cfg_snapshot_path(st, filename);
+	if (!path)
+		return CFG_ERROR_ALLOC;
+	f = fopen(path, "rb");
+	CFG_FREE(st, path);
+	if (!f)
+		return CFG_ERROR_NOT_FOUND;
+	sz = cfg_get_file_size(f);
+	if (!sz) {
+		fclose(f);
+		return CFG_ERROR_FREAD;
+	}
+	buf = (cfg_char *)CFG_MALLOC(st, sz);
+	if (!buf) {
+		fclose(f);
+		return CFG_ERROR_ALLOC;
+	}
+	if (fread(buf, 1, sz, f) != sz) {
+		fclose(f);
+		CFG_FREE(st, buf);
+		return CFG_ERROR_FREAD;
+	}
+	fclose(f);
+	rd.pos = buf;
+	rd.end = buf + sz;
+
+	/* the snapshot must belong to this exact file */
+	path_len = strlen(filename);
+	if (!cfg_snapshot_read(&rd, magic, CFG_SNAPSHOT_MAGIC_LEN) ||
+	    memcmp(magic, CFG_SNAPSHOT_MAGIC, CFG_SNAPSHOT_MAGIC_LEN) ||
+	    !cfg_snapshot_read(&rd, &version, sizeof(version)) || version != CFG_SNAPSHOT_FORMAT(st) ||
+	    !cfg_snapshot_read(&rd, &saved.size, sizeof(saved.size)) || saved.size != stamp->size ||
+	    !cfg_snapshot_read(&rd, &saved.mtime, sizeof(saved.mtime)) || saved.mtime != stamp->mtime ||
+	    !cfg_snapshot_read(&rd, &saved.inode, sizeof(saved.inode)) || saved.inode != stamp->inode ||
+	    !cfg_snapshot_read(&rd, &n, sizeof(n)) || n != path_len ||
+	    (size_t)(rd.end - rd.pos) < path_len || memcmp(rd.pos, filename, path_len))
+		goto exit;
+	rd.pos += path_len;
+
+	ret = CFG_ERROR_FREAD;
+	if (!cfg_snapshot_read(&rd, &nsections, sizeof(nsections)) || !nsections ||
+	    nsections > (size_t)(rd.end - rd.pos))
+		goto exit;
+
+	cfg_clear(st);
+	st->section = (cfg_section_t *)cfg_mem_calloc(st, nsections, sizeof(cfg_section_t));
+	if (!st->section) {
+		ret = CFG_ERROR_ALLOC;
+		goto exit;
+	}
+	st->nsections = nsections;
+	for (i = 0; i < nsections; i++) {
+		section = &st->section[i];
+		/* the entry count is set once the entries exist, so a partial section
+		 * stays freeable */
+		if (!cfg_snapshot_read(&rd, &section->hash, sizeof(section->hash)) ||
+		    !cfg_snapshot_read(&rd, &n, sizeof(n)) ||
+		    !cfg_snapshot_read_string(st, &rd, &section->name, &section->hash))
+			goto exit_clear;
+		if (!n)
+			continue;
+		if (n > (size_t)(rd.end - rd.pos))
+			goto exit_clear;
+		section->entry = (cfg_entry_t *)cfg_mem_calloc(st, n, sizeof(cfg_entry_t));
+		section->key_hash = (cfg_uint32 *)CFG_MALLOC(st, n * sizeof(cfg_uint32));
+		if (!section->entry || !section->key_hash)
+			goto exit_clear;
+		section->nentries = n;
+		for (j = 0; j < section->nentries; j++) {
+			entry = &section->entry[j];
+			entry->section = section;
+			if (!cfg_snapshot_read(&rd, &entry->key_hash, sizeof(entry->key_hash)) ||
+			    !cfg_snapshot_read_string(st, &rd, &entry->key, &entry->key_hash) ||
+			    !cfg_snapshot_read_string(st, &rd, &entry->value, NULL))
+				goto exit_clear;
+			section->key_hash[j] = entry->key_hash;
+		}
+	}
+	ret = CFG_STATUS_OK;
+	goto exit;
+
+exit_clear:
+	cfg_clear(st);
+exit:
+	CFG_FREE(st, buf);
+	return ret;
+}
+
+static cfg_uint32 cfg_snapshot_string_len(const cfg_char *str)
+{
+	return sizeof(cfg_uint32) + (str ? strlen(str) : 0);
+}
+
+static cfg_char *cfg_snapshot_write(cfg_char *pos, const void *data, cfg_uint32 n)
+{
+	memcpy((void *)pos, data, n);
+	return pos + n;
+}
+
+static cfg_char *cfg_snapshot_write_string(cfg_char *pos, const cfg_char *str)
+{
+	cfg_uint32 n = str ? strlen(str) : CFG_SNAPSHOT_NULL;
+
+	pos = cfg_snapshot_write(pos, &n, sizeof(n));
+	return str ? cfg_snapshot_write(pos, str, n) : pos;
+}
+
+/* not exposed in the API */
+cfg_status_t cfg_snapshot_save(cfg_t *st, const cfg_char *filename, const cfg_snapshot_stamp_t *stamp)
+{
+	cfg_char *path, *tmp_path, *buf, *pos;
+	cfg_uint32 i, j, path_len, version = CFG_SNAPSHOT_FORMAT(st);
+	size_t sz;
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	cfg_status_t ret = CFG_STATUS_OK;
+	FILE *f;
+
+	/* a snapshot of a file modified this second could be taken for a version
+	 * with the same stamp written later in that second */
+	if (stamp->recent)
+		return CFG_STATUS_OK;
+	if (cfg_sections_materialize(st) != CFG_STATUS_OK)
+		return CFG_ERROR_ALLOC;
+	/* size the buffer exactly */
+	path_len = strlen(filename);
+	sz = CFG_SNAPSHOT_HEADER_LEN + path_len + sizeof(cfg_uint32);
+	for (i = 0; i < st->nsections; i++) {
+		section = &st->section[i];
+		sz += 2 * sizeof(cfg_uint32) + cfg_snapshot_string_len(section->name);
+		for (j = 0; j < section->nentries; j++) {
+			entry = &section->entry[j];
+			sz += sizeof(cfg_uint32) + cfg_snapshot_string_len(entry->key) + cfg_snapshot_string_len(CFG_ENTRY_VALUE(entry));
+		}
+	}
+	buf = (cfg_char *)CFG_MALLOC(st, sz);
+	if (!buf)
+		return CFG_ERROR_ALLOC;
+
+	pos = cfg_snapshot_write(buf, CFG_SNAPSHOT_MAGIC, CFG_SNAPSHOT_MAGIC_LEN);
+	pos = cfg_snapshot_write(pos, &version, sizeof(version));
+	pos = cfg_snapshot_write(pos, &stamp->size, sizeof(stamp->size));
+	pos = cfg_snapshot_write(pos, &stamp->mtime, sizeof(stamp->mtime));
+	pos = cfg_snapshot_write(pos, &stamp->inode, sizeof(stamp->inode));
+	pos = cfg_snapshot_write_string(pos, filename);
+	pos = cfg_snapshot_write(pos, &st->nsections, sizeof(st->nsections));
+	for (i = 0; i < st->nsections; i++) {
+		section = &st->section[i];
+		pos = cfg_snapshot_write(pos, &section->hash, sizeof(section->hash));
+		pos = cfg_snapshot_write(pos, &section->nentries, sizeof(section->nentries));
+		pos = cfg_snapshot_write_string(pos, section->name);
+		for (j = 0; j < section->nentries; j++) {
+			entry = &section->entry[j];
+			pos = cfg_snapshot_write(pos, &entry->key_hash, sizeof(entry->key_hash));
+			pos = cfg_snapshot_write_string(pos, entry->key);
+			pos = cfg_snapshot_write_string(pos, CFG_ENTRY_VALUE(entry));
+		}
+	}
+
+	/* write to a temporary file and rename it, so that readers never see a
+	 * partial snapshot. the name is unique to the process and the call, as
+	 * many processes can start with the same file at once. */
+	path = cfg_snapshot_path(st, filename);
+	tmp_path = path ? (cfg_char *)CFG_MALLOC(st, strlen(path) + 32) : NULL;
+	if (!tmp_path) {
+		CFG_FREE(st, path);
+		CFG_FREE(st, buf);
+		return CFG_ERROR_ALLOC;
+	}
+	sprintf(tmp_path, "%s.%lu.%u.tmp", path, (unsigned long)getpid(),
+		(unsigned int)cfg_atomic_add(&cfg_snapshot_count, 1));
+	f = fopen(tmp_path, "wb");
+	if (!f) {
+		ret = CFG_ERROR_FILE;
+	} else {
+		if (fwrite(buf, 1, sz, f) != sz)
+			ret = CFG_ERROR_FWRITE;
+		if (fclose(f))
+			ret = CFG_ERROR_FWRITE;
+		if (ret == CFG_STATUS_OK) {
+#ifdef _WIN32
+			remove(path); /* rename() does not replace files on Win32 */
+#endif
+			if (rename(tmp_path, path))
+				ret = CFG_ERROR_FWRITE;
+		}
+		if (ret != CFG_STATUS_OK)
+			remove(tmp_path);
+	}
+	if (ret != CFG_STATUS_OK && st->verbose > 0)
+		fprintf(stderr, "[cfg2] cfg_snapshot_save(): cannot write snapshot %s\n", path);
+	CFG_FREE(st, tmp_path);
+	CFG_FREE(st, path);
+	CFG_FREE(st, buf);
+	return ret;
+}
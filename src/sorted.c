@@ -0,0 +1,136 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * sorted.c:
+ *	ordered iteration, key range and prefix queries
+ */
+
+#include "defines.h"
+
+#define CFG_SORTED_KEY(_entry) ((_entry)->key ? (_entry)->key : "")
+
+/* key order; entries with the same key keep their order in the section */
+static int cfg_sorted_cmp(const void *a, const void *b)
+{
+	const cfg_entry_t *ea = *(const cfg_entry_t * const *)a;
+	const cfg_entry_t *eb = *(const cfg_entry_t * const *)b;
+	int ret = strcmp(CFG_SORTED_KEY(ea), CFG_SORTED_KEY(eb));
+
+	if (ret)
+		return ret;
+	return ea < eb ? -1 : ea > eb;
+}
+
+/* build the sorted entry pointers of a section on first use. the array is
+ * freed when entries are added to or deleted from the section. */
+static cfg_status_t cfg_sorted_build(cfg_t *st, cfg_section_t *section)
+{
+	cfg_uint32 i;
+
+	if (section->sorted || !section->nentries)
+		return CFG_STATUS_OK;
+	section->sorted = (cfg_entry_t **)CFG_MALLOC(st, section->nentries * sizeof(cfg_entry_t *));
+	if (!section->sorted)
+		return CFG_ERROR_ALLOC;
+	for (i = 0; i < section->nentries; i++)
+		section->sorted[i] = &section->entry[i];
+	qsort((void *)section->sorted, section->nentries, sizeof(cfg_entry_t *), cfg_sorted_cmp);
+	return CFG_STATUS_OK;
+}
+
+/* the position of the first entry with a key not less than 'key' */
+static cfg_uint32 cfg_sorted_lower_bound(cfg_section_t *section, const cfg_char *key)
+{
+	cfg_uint32 lo = 0, hi = section->nentries, mid;
+
+	while (lo < hi) {
+		mid = lo + ((hi - lo) >> 1);
+		if (strcmp(CFG_SORTED_KEY(section->sorted[mid]), key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+cfg_entry_t *cfg_entry_sorted_nth(cfg_t *st, cfg_section_t *section, cfg_uint32 n)
+{
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_entry_sorted_nth", NULL);
+	if (!section) {
+		CFG_SET_STATUS(st, CFG_ERROR_NULL_PTR);
+		return NULL;
+	}
+	if (n >= section->nentries) {
+		CFG_SET_STATUS(st, CFG_ERROR_OUT_OF_RANGE);
+		return NULL;
+	}
+	ret = cfg_sorted_build(st, section);
+	if (ret != CFG_STATUS_OK) {
+		CFG_SET_STATUS(st, ret);
+		return NULL;
+	}
+	return section->sorted[n];
+}
+
+cfg_status_t cfg_entries_range(cfg_t *st, const cfg_char *section, const cfg_char *first, const cfg_char *last, cfg_entry_cb_t cb, void *ctx)
+{
+	cfg_section_t *section_ptr;
+	cfg_uint32 i;
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_entries_range", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
+	if (!cb)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	section_ptr = cfg_section_get(st, section);
+	if (!section_ptr)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
+	ret = cfg_sorted_build(st, section_ptr);
+	if (ret != CFG_STATUS_OK)
+		CFG_SET_RETURN_STATUS(st, ret);
+
+	for (i = first ? cfg_sorted_lower_bound(section_ptr, first) : 0; i < section_ptr->nentries; i++) {
+		if (last && strcmp(CFG_SORTED_KEY(section_ptr->sorted[i]), last) >= 0)
+			break;
+		if (!cb(ctx, section_ptr->sorted[i]))
+			break;
+	}
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+cfg_status_t cfg_entries_prefix(cfg_t *st, const cfg_char *section, const cfg_char *prefix, cfg_entry_cb_t cb, void *ctx)
+{
+	cfg_section_t *section_ptr;
+	cfg_uint32 i;
+	size_t len;
+	cfg_status_t ret;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_entries_prefix", CFG_ERROR_NULL_PTR);
+	CFG_CHECK_ASYNC_RETURN(st, CFG_ERROR_BUSY);
+	if (!cb)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	section_ptr = cfg_section_get(st, section);
+	if (!section_ptr)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
+	ret = cfg_sorted_build(st, section_ptr);
+	if (ret != CFG_STATUS_OK)
+		CFG_SET_RETURN_STATUS(st, ret);
+
+	if (!prefix)
+		prefix = "";
+	len = strlen(prefix);
+	for (i = cfg_sorted_lower_bound(section_ptr, prefix); i < section_ptr->nentries; i++) {
+		if (strncmp(CFG_SORTED_KEY(section_ptr->sorted[i]), prefix, len))
+			break;
+		if (!cb(ctx, section_ptr->sorted[i]))
+			break;
+	}
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
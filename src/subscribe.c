@@ -0,0 +1,409 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * subscribe.c:
+ *	callbacks for the keys changed by calls on an object and by reloads
+ */
+
+#include "defines.h"
+
+/* the bucket of the subscriptions to a key, or with 'key_hash' 0 of the prefix
+ * subscriptions of a section */
+static cfg_uint32 cfg_subs_bucket(cfg_subs_t *subs, cfg_uint32 section_hash, cfg_uint32 key_hash)
+{
+	cfg_uint32 h = section_hash ^ (key_hash * 0x9e3779b1);
+
+	CFG_HASH_FMIX(h);
+	return h & (subs->nbuckets - 1);
+}
+
+/* link the subscriptions into their buckets, each in the order they were
+ * made */
+static void cfg_subs_link(cfg_subs_t *subs)
+{
+	cfg_sub_t *sub;
+	cfg_uint32 i, b;
+
+	for (i = 0; i < subs->nbuckets; i++)
+		subs->bucket[i] = -1;
+	for (i = subs->nsubs; i--; ) {
+		sub = &subs->sub[i];
+		b = cfg_subs_bucket(subs, sub->section_hash, sub->key_hash);
+		sub->next = subs->bucket[b];
+		subs->bucket[b] = (cfg_int)i;
+	}
+}
+
+static cfg_subs_t *cfg_subs_get(cfg_t *st)
+{
+	cfg_subs_t *subs = st->subs;
+
+	if (subs)
+		return subs;
+	subs = (cfg_subs_t *)cfg_mem_calloc(st, 1, sizeof(cfg_subs_t));
+	if (!subs)
+		return NULL;
+	subs->mutex = cfg_mutex_alloc(st);
+	if (!subs->mutex) {
+		CFG_FREE(st, subs);
+		return NULL;
+	}
+	st->subs = subs;
+	return subs;
+}
+
+/* not exposed in the API */
+void cfg_subs_free(cfg_t *st)
+{
+	cfg_subs_t *subs = st->subs;
+	cfg_change_t *change, *next;
+	cfg_uint32 i;
+
+	if (!subs)
+		return;
+	st->subs = NULL;
+	for (i = 0; i < subs->nsubs; i++)
+		CFG_FREE(st, subs->sub[i].prefix);
+	CFG_FREE(st, subs->sub);
+	CFG_FREE(st, subs->bucket);
+	for (change = subs->first; change; change = next) {
+		next = change->next;
+		CFG_FREE(st, change->value);
+		CFG_FREE(st, change);
+	}
+	CFG_FREE(st, subs->slot);
+	if (subs->saved)
+		cfg_free(subs->saved);
+	cfg_mutex_free(st, subs->mutex);
+	CFG_FREE(st, subs);
+}
+
+cfg_status_t cfg_subscribe(cfg_t *st, const cfg_char *section, const cfg_char *key, cfg_change_cb_t cb, void *ctx)
+{
+	cfg_subs_t *subs;
+	cfg_sub_t *sub;
+	cfg_int *bucket, *link;
+	size_t len;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_subscribe", CFG_ERROR_NULL_PTR);
+	if (!cb)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NULL_PTR);
+	subs = cfg_subs_get(st);
+	if (!subs)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+
+	/* at most one subscription per bucket on average */
+	if (subs->nsubs == subs->nbuckets) {
+		bucket = (cfg_int *)CFG_MALLOC(st, (subs->nbuckets ? subs->nbuckets << 1 : 16) * sizeof(cfg_int));
+		if (!bucket)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+		CFG_FREE(st, subs->bucket);
+		subs->bucket = bucket;
+		subs->nbuckets = subs->nbuckets ? subs->nbuckets << 1 : 16;
+		cfg_subs_link(subs);
+	}
+	sub = (cfg_sub_t *)CFG_REALLOC(st, subs->sub, (subs->nsubs + 1) * sizeof(cfg_sub_t));
+	if (!sub)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	subs->sub = sub;
+
+	sub = &subs->sub[subs->nsubs];
+	sub->section_hash = cfg_hash_get(section);
+	sub->key_hash = 0;
+	sub->prefix = NULL;
+	sub->prefix_len = 0;
+	sub->cb = cb;
+	sub->ctx = ctx;
+	sub->next = -1;
+	len = key ? strlen(key) : 0;
+	if (!key || (len && key[len - 1] == '*')) {
+		sub->prefix_len = len ? len - 1 : 0;
+		sub->prefix = (cfg_char *)CFG_MALLOC(st, sub->prefix_len + 1);
+		if (!sub->prefix)
+			CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+		if (sub->prefix_len)
+			memcpy((void *)sub->prefix, (void *)key, sub->prefix_len);
+		sub->prefix[sub->prefix_len] = '\0';
+		subs->nprefix++;
+	} else {
+		sub->key_hash = cfg_hash_get(key);
+	}
+
+	/* append to the bucket, which keeps the order of the callbacks */
+	link = &subs->bucket[cfg_subs_bucket(subs, sub->section_hash, sub->key_hash)];
+	while (*link >= 0)
+		link = &subs->sub[*link].next;
+	*link = (cfg_int)subs->nsubs;
+	subs->nsubs++;
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+cfg_status_t cfg_unsubscribe(cfg_t *st, cfg_change_cb_t cb, void *ctx)
+{
+	cfg_subs_t *subs = st ? st->subs : NULL;
+	cfg_sub_t *sub;
+	cfg_change_t *change;
+	cfg_uint32 i, n = 0;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_unsubscribe", CFG_ERROR_NULL_PTR);
+	if (!subs)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
+	for (i = 0; i < subs->nsubs; i++) {
+		sub = &subs->sub[i];
+		if (sub->cb != cb || sub->ctx != ctx) {
+			subs->sub[n++] = *sub;
+			continue;
+		}
+		if (sub->prefix)
+			subs->nprefix--;
+		CFG_FREE(st, sub->prefix);
+	}
+	if (n == subs->nsubs)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_NOT_FOUND);
+	subs->nsubs = n;
+	cfg_subs_link(subs);
+
+	/* queued changes for the subscriber are dropped; a dispatch running on
+	 * another thread may still report the ones it took */
+	cfg_mutex_lock(subs->mutex);
+	for (change = subs->first; change; change = change->next) {
+		if (change->cb == cb && change->ctx == ctx)
+			change->cb = NULL;
+	}
+	cfg_mutex_unlock(subs->mutex);
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+/* the slot of the queued change for a subscriber and key, or of an empty
+ * slot */
+static cfg_change_t **cfg_changes_slot(cfg_subs_t *subs, cfg_change_cb_t cb, void *ctx, cfg_uint32 section_hash, cfg_uint32 key_hash)
+{
+	cfg_uint32 h = section_hash ^ (key_hash * 0x9e3779b1);
+	cfg_change_t *change;
+
+	CFG_HASH_FMIX(h);
+	for (h &= subs->nslots - 1; ; h = (h + 1) & (subs->nslots - 1)) {
+		change = subs->slot[h];
+		if (!change || (change->cb == cb && change->ctx == ctx &&
+		    change->section_hash == section_hash && change->key_hash == key_hash))
+			return &subs->slot[h];
+	}
+}
+
+/* double the table of queued changes; called with the lock held */
+static cfg_status_t cfg_changes_grow(cfg_t *st)
+{
+	cfg_subs_t *subs = st->subs;
+	cfg_change_t **slot, *change;
+	cfg_uint32 nslots = subs->nslots ? subs->nslots << 1 : 64;
+
+	slot = (cfg_change_t **)cfg_mem_calloc(st, nslots, sizeof(cfg_change_t *));
+	if (!slot)
+		return CFG_ERROR_ALLOC;
+	CFG_FREE(st, subs->slot);
+	subs->slot = slot;
+	subs->nslots = nslots;
+	for (change = subs->first; change; change = change->next)
+		*cfg_changes_slot(subs, change->cb, change->ctx, change->section_hash, change->key_hash) = change;
+	return CFG_STATUS_OK;
+}
+
+/* queue a change for a subscriber; a change of the same key still queued
+ * only gets the new value. a change which cannot be queued is dropped. */
+static void cfg_change_queue(cfg_t *st, cfg_sub_t *sub, cfg_section_t *section, cfg_entry_t *entry, const cfg_char *value)
+{
+	cfg_subs_t *subs = st->subs;
+	cfg_change_t **slot, *change;
+	cfg_char *copy = NULL;
+	size_t key_len, section_len;
+
+	if (value) {
+		copy = cfg_mem_strdup(st, value);
+		if (!copy)
+			return;
+	}
+	cfg_mutex_lock(subs->mutex);
+	if ((subs->nchanges + 1) << 1 > subs->nslots && cfg_changes_grow(st) != CFG_STATUS_OK)
+		goto exit;
+	slot = cfg_changes_slot(subs, sub->cb, sub->ctx, section->hash, entry->key_hash);
+	if (*slot) {
+		CFG_FREE(st, (*slot)->value);
+		(*slot)->value = copy;
+		cfg_mutex_unlock(subs->mutex);
+		return;
+	}
+
+	key_len = strlen(entry->key) + 1;
+	section_len = section->name ? strlen(section->name) + 1 : 0;
+	change = (cfg_change_t *)CFG_MALLOC(st, sizeof(cfg_change_t) + key_len + section_len);
+	if (!change)
+		goto exit;
+	change->next = NULL;
+	change->cb = sub->cb;
+	change->ctx = sub->ctx;
+	change->section_hash = section->hash;
+	change->key_hash = entry->key_hash;
+	change->key = (cfg_char *)(change + 1);
+	memcpy((void *)change->key, (void *)entry->key, key_len);
+	change->section = NULL;
+	if (section->name) {
+		change->section = change->key + key_len;
+		memcpy((void *)change->section, (void *)section->name, section_len);
+	}
+	change->value = copy;
+	if (subs->last)
+		subs->last->next = change;
+	else
+		subs->first = change;
+	subs->last = change;
+	subs->nchanges++;
+	*slot = change;
+	cfg_mutex_unlock(subs->mutex);
+	return;
+
+exit:
+	cfg_mutex_unlock(subs->mutex);
+	CFG_FREE(st, copy);
+}
+
+/* not exposed in the API; queue a change of 'entry' in 'section' for the
+ * subscribers of the key. 'value' is NULL for a removed key. */
+void cfg_change_notify(cfg_t *st, cfg_section_t *section, cfg_entry_t *entry, const cfg_char *value)
+{
+	cfg_subs_t *subs = st->subs;
+	cfg_sub_t *sub;
+	cfg_int i;
+
+	/* during a reload the changes are found at its end */
+	if (!subs->nsubs || subs->saved)
+		return;
+	for (i = subs->bucket[cfg_subs_bucket(subs, section->hash, entry->key_hash)]; i >= 0; i = sub->next) {
+		sub = &subs->sub[i];
+		if (!sub->prefix && sub->section_hash == section->hash && sub->key_hash == entry->key_hash)
+			cfg_change_queue(st, sub, section, entry, value);
+	}
+	if (!subs->nprefix)
+		return;
+	for (i = subs->bucket[cfg_subs_bucket(subs, section->hash, 0)]; i >= 0; i = sub->next) {
+		sub = &subs->sub[i];
+		if (sub->prefix && sub->section_hash == section->hash && !strncmp(entry->key, sub->prefix, sub->prefix_len))
+			cfg_change_queue(st, sub, section, entry, value);
+	}
+}
+
+/* take the queued changes and report them on the calling thread */
+static void cfg_changes_deliver(cfg_t *st)
+{
+	cfg_subs_t *subs = st->subs;
+	cfg_change_t *change, *next;
+
+	cfg_mutex_lock(subs->mutex);
+	change = subs->first;
+	if (change)
+		memset((void *)subs->slot, 0, subs->nslots * sizeof(cfg_change_t *));
+	subs->first = NULL;
+	subs->last = NULL;
+	subs->nchanges = 0;
+	cfg_mutex_unlock(subs->mutex);
+
+	for (; change; change = next) {
+		next = change->next;
+		if (change->cb)
+			change->cb(change->ctx, change->section, change->key, change->value);
+		CFG_FREE(st, change->value);
+		CFG_FREE(st, change);
+	}
+}
+
+/* not exposed in the API; report the queued changes at the end of a call
+ * unless they are batched or a reload is still running */
+void cfg_changes_flush(cfg_t *st)
+{
+	if (!st->subs->batch && !st->subs->reload)
+		cfg_changes_deliver(st);
+}
+
+/* not exposed in the API; a call which parses again starts. the changes are
+ * found when the outermost one ends. */
+void cfg_changes_begin(cfg_t *st)
+{
+	st->subs->reload++;
+}
+
+/* not exposed in the API; called by cfg_clear(). the keys of 'st' are moved
+ * into an object of their own until the end of the reload, instead of being
+ * freed. */
+void cfg_changes_save(cfg_t *st)
+{
+	cfg_subs_t *subs = st->subs;
+	cfg_t *saved;
+
+	if (subs->saved || !subs->nsubs)
+		return;
+	saved = cfg_alloc_ex(&st->allocator);
+	if (!saved)
+		return;
+	if (st->intern && cfg_intern_set(saved, CFG_TRUE) != CFG_STATUS_OK) {
+		cfg_free(saved);
+		return;
+	}
+	cfg_tree_move(saved, st);
+	subs->saved = saved;
+}
+
+static cfg_bool cfg_changes_diff(void *ctx, cfg_diff_type_t type, const cfg_char *section,
+	cfg_entry_t *old_entry, cfg_entry_t *new_entry)
+{
+	cfg_t *st = (cfg_t *)ctx;
+
+	(void)type, (void)section;
+	if (new_entry)
+		cfg_change_notify(st, new_entry->section, new_entry, CFG_ENTRY_VALUE(new_entry));
+	else
+		cfg_change_notify(st, old_entry->section, old_entry, NULL);
+	return CFG_TRUE;
+}
+
+/* not exposed in the API; a call which parses again ends. at the end of the
+ * outermost one the keys kept by cfg_changes_save() are compared to the new
+ * ones. */
+void cfg_changes_end(cfg_t *st)
+{
+	cfg_subs_t *subs = st->subs;
+	cfg_t *saved = subs->saved;
+
+	if (--subs->reload)
+		return;
+	if (saved) {
+		subs->saved = NULL;
+		cfg_diff(saved, st, cfg_changes_diff, (void *)st);
+		cfg_free(saved);
+	}
+	cfg_changes_flush(st);
+}
+
+cfg_status_t cfg_changes_batch_set(cfg_t *st, cfg_bool enable)
+{
+	cfg_subs_t *subs;
+
+	CFG_CHECK_ST_RETURN(st, "cfg_changes_batch_set", CFG_ERROR_NULL_PTR);
+	subs = cfg_subs_get(st);
+	if (!subs)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_ALLOC);
+	subs->batch = enable;
+	cfg_changes_flush(st);
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+cfg_status_t cfg_changes_dispatch(cfg_t *st)
+{
+	CFG_CHECK_ST_RETURN(st, "cfg_changes_dispatch", CFG_ERROR_NULL_PTR);
+	if (st->subs)
+		cfg_changes_deliver(st);
+	return CFG_STATUS_OK;
+}
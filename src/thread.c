@@ -0,0 +1,306 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * thread.c:
+ *	a minimal wrapper for POSIX and Win32 threads; define CFG_NO_THREADS to
+ *	run everything on the calling thread
+ */
+
+#include "defines.h"
+
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+#		include <windows.h>
+#	else
+#		include <pthread.h>
+#	endif
+#endif
+
+struct _cfg_thread_t {
+	cfg_thread_func_t func;
+	void *arg;
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+	HANDLE handle;
+#	else
+	pthread_t handle;
+#	endif
+#endif
+};
+
+struct _cfg_event_t {
+	cfg_bool set;
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+	HANDLE handle;
+#	else
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+#	endif
+#endif
+};
+
+struct _cfg_mutex_t {
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+	CRITICAL_SECTION cs;
+#	else
+	pthread_mutex_t mutex;
+#	endif
+#endif
+	cfg_bool unused; /* no empty struct without threads */
+};
+
+cfg_status_t cfg_threads_set(cfg_t *st, cfg_uint32 n)
+{
+	CFG_CHECK_ST_RETURN(st, "cfg_threads_set", CFG_ERROR_NULL_PTR);
+	if (n > CFG_THREADS_MAX)
+		CFG_SET_RETURN_STATUS(st, CFG_ERROR_OUT_OF_RANGE);
+	st->nthreads = n ? n : 1;
+	CFG_SET_RETURN_STATUS(st, CFG_STATUS_OK);
+}
+
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+static DWORD WINAPI cfg_thread_main(LPVOID ptr)
+{
+	cfg_thread_t *thread = (cfg_thread_t *)ptr;
+	thread->func(thread->arg);
+	return 0;
+}
+#	else
+static void *cfg_thread_main(void *ptr)
+{
+	cfg_thread_t *thread = (cfg_thread_t *)ptr;
+	thread->func(thread->arg);
+	return NULL;
+}
+#	endif
+#endif
+
+/* start a thread running func(arg); NULL if it cannot be started */
+cfg_thread_t *cfg_thread_start(cfg_t *st, cfg_thread_func_t func, void *arg)
+{
+#ifdef CFG_NO_THREADS
+	(void)st, (void)func, (void)arg;
+	return NULL;
+#else
+	cfg_thread_t *thread = (cfg_thread_t *)CFG_MALLOC(st, sizeof(cfg_thread_t));
+
+	if (!thread)
+		return NULL;
+	thread->func = func;
+	thread->arg = arg;
+#	ifdef _WIN32
+	thread->handle = CreateThread(NULL, 0, cfg_thread_main, (LPVOID)thread, 0, NULL);
+	if (!thread->handle) {
+#	else
+	if (pthread_create(&thread->handle, NULL, cfg_thread_main, (void *)thread)) {
+#	endif
+		CFG_FREE(st, thread);
+		return NULL;
+	}
+	return thread;
+#endif
+}
+
+/* wait for a thread from cfg_thread_start() to finish and release it */
+void cfg_thread_join(cfg_t *st, cfg_thread_t *thread)
+{
+#ifdef CFG_NO_THREADS
+	(void)st, (void)thread;
+#else
+#	ifdef _WIN32
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#	else
+	pthread_join(thread->handle, NULL);
+#	endif
+	CFG_FREE(st, thread);
+#endif
+}
+
+/* call 'func' for 'n' argument blocks of 'size' bytes at 'args', each on its
+ * own thread; the first block runs on the calling thread, as does any block
+ * whose thread cannot be started. returns when all calls are done. */
+void cfg_threads_run(cfg_t *st, cfg_thread_func_t func, void *args, size_t size, cfg_uint32 n)
+{
+	cfg_thread_t *thread[CFG_THREADS_MAX];
+	cfg_uint32 i;
+
+	for (i = 1; i < n; i++)
+		thread[i] = cfg_thread_start(st, func, (void *)((cfg_char *)args + i * size));
+	if (n)
+		func(args);
+	for (i = 1; i < n; i++) {
+		if (thread[i])
+			cfg_thread_join(st, thread[i]);
+		else
+			func((void *)((cfg_char *)args + i * size));
+	}
+}
+
+/* add 'delta' to a counter which other threads may change and return the new
+ * value; for reference counts */
+cfg_uint32 cfg_atomic_add(volatile cfg_uint32 *value, cfg_int delta)
+{
+#if defined(CFG_NO_THREADS)
+	return *value += delta;
+#elif defined(_WIN32)
+	return (cfg_uint32)InterlockedExchangeAdd((volatile LONG *)value, delta) + delta;
+#elif defined(__GNUC__)
+	return __sync_add_and_fetch(value, delta);
+#else
+	return *value += delta; /* not atomic */
+#endif
+}
+
+/* a flag which is set once and can be waited for by other threads; NULL if it
+ * cannot be created */
+cfg_event_t *cfg_event_alloc(cfg_t *st)
+{
+	cfg_event_t *event = (cfg_event_t *)CFG_MALLOC(st, sizeof(cfg_event_t));
+
+	if (!event)
+		return NULL;
+	event->set = CFG_FALSE;
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+	event->handle = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!event->handle) {
+#	else
+	if (pthread_mutex_init(&event->mutex, NULL)) {
+		CFG_FREE(st, event);
+		return NULL;
+	}
+	if (pthread_cond_init(&event->cond, NULL)) {
+		pthread_mutex_destroy(&event->mutex);
+#	endif
+		CFG_FREE(st, event);
+		return NULL;
+	}
+#endif
+	return event;
+}
+
+void cfg_event_free(cfg_t *st, cfg_event_t *event)
+{
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+	CloseHandle(event->handle);
+#	else
+	pthread_cond_destroy(&event->cond);
+	pthread_mutex_destroy(&event->mutex);
+#	endif
+#endif
+	CFG_FREE(st, event);
+}
+
+/* set the flag and wake all threads waiting for it */
+void cfg_event_set(cfg_event_t *event)
+{
+#if defined(CFG_NO_THREADS)
+	event->set = CFG_TRUE;
+#elif defined(_WIN32)
+	event->set = CFG_TRUE;
+	SetEvent(event->handle);
+#else
+	pthread_mutex_lock(&event->mutex);
+	event->set = CFG_TRUE;
+	pthread_cond_broadcast(&event->cond);
+	pthread_mutex_unlock(&event->mutex);
+#endif
+}
+
+/* is the flag set? does not wait */
+cfg_bool cfg_event_is_set(cfg_event_t *event)
+{
+#if defined(CFG_NO_THREADS)
+	return event->set;
+#elif defined(_WIN32)
+	return WaitForSingleObject(event->handle, 0) == WAIT_OBJECT_0;
+#else
+	cfg_bool set;
+
+	pthread_mutex_lock(&event->mutex);
+	set = event->set;
+	pthread_mutex_unlock(&event->mutex);
+	return set;
+#endif
+}
+
+/* wait until the flag is set; without threads nothing else could set it, so
+ * this returns at once */
+void cfg_event_wait(cfg_event_t *event)
+{
+#if defined(CFG_NO_THREADS)
+	(void)event;
+#elif defined(_WIN32)
+	WaitForSingleObject(event->handle, INFINITE);
+#else
+	pthread_mutex_lock(&event->mutex);
+	while (!event->set)
+		pthread_cond_wait(&event->cond, &event->mutex);
+	pthread_mutex_unlock(&event->mutex);
+#endif
+}
+
+/* a lock around data which more than one thread changes; NULL if it cannot be
+ * created */
+cfg_mutex_t *cfg_mutex_alloc(cfg_t *st)
+{
+	cfg_mutex_t *mutex = (cfg_mutex_t *)CFG_MALLOC(st, sizeof(cfg_mutex_t));
+
+	if (!mutex)
+		return NULL;
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+	InitializeCriticalSection(&mutex->cs);
+#	else
+	if (pthread_mutex_init(&mutex->mutex, NULL)) {
+		CFG_FREE(st, mutex);
+		return NULL;
+	}
+#	endif
+#endif
+	return mutex;
+}
+
+void cfg_mutex_free(cfg_t *st, cfg_mutex_t *mutex)
+{
+#ifndef CFG_NO_THREADS
+#	ifdef _WIN32
+	DeleteCriticalSection(&mutex->cs);
+#	else
+	pthread_mutex_destroy(&mutex->mutex);
+#	endif
+#endif
+	CFG_FREE(st, mutex);
+}
+
+void cfg_mutex_lock(cfg_mutex_t *mutex)
+{
+#if defined(CFG_NO_THREADS)
+	(void)mutex;
+#elif defined(_WIN32)
+	EnterCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+void cfg_mutex_unlock(cfg_mutex_t *mutex)
+{
+#if defined(CFG_NO_THREADS)
+	(void)mutex;
+#elif defined(_WIN32)
+	LeaveCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
@@ -12,10 +12,22 @@
 
 #include "defines.h"
 
+#if !defined(CFG_NO_SIMD) && defined(__AVX2__)
+#	include <immintrin.h>
+#	define CFG_SIMD_AVX2
+#	define CFG_SIMD_SSE2
+#elif !defined(CFG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	include <emmintrin.h>
+#	define CFG_SIMD_SSE2
+#endif
+
+/* below this many hashes the setup cost of AVX2 is not worth it */
+#define CFG_SIMD_AVX2_MIN 256
+
 /* local implementation of strdup() if missing on a specific C89 target */
 cfg_char *cfg_strdup(const cfg_char *str)
 {
-	cfg_uint32 n;
+	size_t n;
 	cfg_char *copy;
 
 	if (!str)
@@ -29,6 +41,74 @@ cfg_char *cfg_strdup(const cfg_char *str)
 	return copy;
 }
 
+/* not exposed in the API */
+void *cfg_mem_calloc(cfg_t *st, size_t n, size_t size)
+{
+	void *ptr = CFG_MALLOC(st, n * size);
+	if (ptr)
+		memset(ptr, 0, n * size);
+	return ptr;
+}
+
+/* not exposed in the API; cfg_strdup() using the allocator of a cfg_t */
+cfg_char *cfg_mem_strdup(cfg_t *st, const cfg_char *str)
+{
+	size_t n;
+	cfg_char *copy;
+
+	if (!str)
+		return NULL;
+	n = strlen(str);
+	copy = (cfg_char *)CFG_MALLOC(st, n + 1);
+	if (copy) {
+		memcpy((void *)copy, (void *)str, n);
+		copy[n] = '\0';
+	}
+	return copy;
+}
+
+/* not exposed in the API; free a key, value or section name unless it is in
+ * the string block of cfg_shrink() or shared with clones */
+void cfg_str_free(cfg_t *st, cfg_char *str)
+{
+	if ((!st->strings || str < st->strings || str >= st->strings + st->strings_size) && !cfg_shared_str(st, str))
+		CFG_FREE(st, str);
+}
+
+/* not exposed in the API; return the position of the first 'hash' in the
+ * 'hashes' array or 'n' if missing. compares 8 (AVX2) or 4 (SSE2) hashes at once. */
+cfg_uint32 cfg_hash_find(const cfg_uint32 *hashes, cfg_uint32 n, cfg_uint32 hash)
+{
+	cfg_uint32 i = 0;
+#if defined(CFG_SIMD_SSE2)
+	__m128i needle;
+#endif
+#if defined(CFG_SIMD_AVX2)
+	__m256i needle_avx;
+
+	if (n >= CFG_SIMD_AVX2_MIN) {
+		needle_avx = _mm256_set1_epi32((int)hash);
+		for (; i + 8 <= n; i += 8) {
+			if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(needle_avx, _mm256_loadu_si256((const __m256i *)(hashes + i)))))
+				break;
+		}
+	}
+#endif
+#if defined(CFG_SIMD_SSE2)
+	needle = _mm_set1_epi32((int)hash);
+	for (; i + 4 <= n; i += 4) {
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(needle, _mm_loadu_si128((const __m128i *)(hashes + i)))))
+			break;
+	}
+#endif
+	/* the remainder, or the lanes of a vector with a match */
+	for (; i < n; i++) {
+		if (hashes[i] == hash)
+			return i;
+	}
+	return n;
+}
+
 /* fast fnv-32 hash */
 cfg_uint32 cfg_hash_get(const cfg_char *str)
 {
@@ -82,78 +162,50 @@ cfg_double cfg_value_to_double(const cfg_char *value)
 	return strtod(value, NULL);
 }
 
-/* number -> string conversations */
+/* number -> string conversations; the largest output is a %lf of DBL_MAX */
+#define CFG_NUMBER_BUF_SZ 512
+
 cfg_char *cfg_bool_to_value(cfg_bool number)
 {
-	static const char *format = "%u";
-	cfg_char *buf;
-	int sz;
-
-	if (number != CFG_FALSE)
-		number = CFG_TRUE;
-	sz = sprintf(NULL, format, number);
-	if (sz < 0)
-		return NULL;
-	buf = (cfg_char *)malloc(sz + 1);
-	sprintf(buf, format, number);
-	return buf;
+	return cfg_strdup(number != CFG_FALSE ? "1" : "0");
 }
 
-/* number -> string conversations */
 cfg_char *cfg_int_to_value(cfg_int number)
 {
-	static const char *format = "%li";
-	cfg_char *buf;
-	int sz;
-
-	sz = sprintf(NULL, format, number);
-	if (sz < 0)
-		return NULL;
-	buf = (cfg_char *)malloc(sz + 1);
-	sprintf(buf, format, number);
-	return buf;
+	cfg_char buf[CFG_NUMBER_BUF_SZ];
+	sprintf(buf, "%li", (long)number);
+	return cfg_strdup(buf);
 }
 
 cfg_char *cfg_long_to_value(cfg_long number)
 {
-	static const char *format = "%lli";
-	cfg_char *buf;
-	int sz;
+	cfg_char buf[CFG_NUMBER_BUF_SZ];
+	/* C89 has no 64bit integer format; print the digits manually */
+	cfg_char *ptr = buf + CFG_NUMBER_BUF_SZ - 1;
+	cfg_bool negative = number < 0;
 
-	sz = sprintf(NULL, format, number);
-	if (sz < 0)
-		return NULL;
-	buf = (cfg_char *)malloc(sz + 1);
-	sprintf(buf, format, number);
-	return buf;
+	*ptr = '\0';
+	do {
+		*--ptr = (cfg_char)('0' + (negative ? -(number % 10) : number % 10));
+		number /= 10;
+	} while (number);
+	if (negative)
+		*--ptr = '-';
+	return cfg_strdup(ptr);
 }
 
 cfg_char *cfg_float_to_value(cfg_float number)
 {
-	static const char *format = "%f";
-	int sz;
-	cfg_char *buf;
-
-	sz = sprintf(NULL, format, number);
-	if (sz < 0)
-		return NULL;
-	buf = (cfg_char *)malloc(sz + 1);
-	sprintf(buf, format, number);
-	return buf;
+	cfg_char buf[CFG_NUMBER_BUF_SZ];
+	sprintf(buf, "%f", number);
+	return cfg_strdup(buf);
 }
 
 cfg_char *cfg_double_to_value(cfg_double number)
 {
-	static const char *format = "%lf";
-	int sz;
-	cfg_char *buf;
-
-	sz = sprintf(NULL, format, number);
-	if (sz < 0)
-		return NULL;
-	buf = (cfg_char *)malloc(sz + 1);
-	sprintf(buf, format, number);
-	return buf;
+	cfg_char buf[CFG_NUMBER_BUF_SZ];
+	sprintf(buf, "%f", number);
+	return cfg_strdup(buf);
 }
 
 /* the lookup table acts both as a toupper() converter and as a shifter of any
@@ -0,0 +1,1417 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * bench.c:
+ *	benchmarks for the api; pass the name of a benchmark to run only that one
+ */
+
+#ifndef _WIN32
+#	define _POSIX_C_SOURCE 200112L /* gettimeofday(), mkdir(), rmdir(), nanosleep() */
+#	include <sys/time.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	define BENCH_MKDIR(_dir) mkdir(_dir, 0755)
+#else
+#	include <windows.h>
+#	include <direct.h>
+#	define BENCH_MKDIR(_dir) _mkdir(_dir)
+#	define rmdir _rmdir
+#endif
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cfg2.h"
+#include "bench_gen.h" /* generated by cfg2-gen from bench_gen.cfg */
+
+#define BENCH_TIME(_begin) ((double)(clock() - (_begin)) / CLOCKS_PER_SEC)
+#define BENCH_WALL_TIME(_begin) (bench_wall_clock() - (_begin))
+
+typedef void (*bench_func_t)(void);
+
+typedef struct {
+	const char *name;
+	bench_func_t func;
+} bench_t;
+
+/* an allocator which counts the bytes in use; each block is prefixed by its size */
+typedef struct {
+	size_t bytes;
+	size_t allocations;
+} bench_counter_t;
+
+typedef union {
+	size_t size;
+	double align;
+} bench_counter_header_t;
+
+static void *bench_counter_malloc(void *ctx, size_t size)
+{
+	bench_counter_t *counter = (bench_counter_t *)ctx;
+	bench_counter_header_t *header = (bench_counter_header_t *)malloc(sizeof(*header) + size);
+	if (!header)
+		return NULL;
+	header->size = size;
+	counter->bytes += size;
+	counter->allocations++;
+	return (void *)(header + 1);
+}
+
+static void bench_counter_free(void *ctx, void *ptr)
+{
+	bench_counter_t *counter = (bench_counter_t *)ctx;
+	bench_counter_header_t *header = (bench_counter_header_t *)ptr - 1;
+	counter->bytes -= header->size;
+	counter->allocations--;
+	free(header);
+}
+
+static void *bench_counter_realloc(void *ctx, void *ptr, size_t size)
+{
+	bench_counter_header_t *header;
+	void *copy;
+
+	if (!ptr)
+		return bench_counter_malloc(ctx, size);
+	header = (bench_counter_header_t *)ptr - 1;
+	copy = bench_counter_malloc(ctx, size);
+	if (!copy)
+		return NULL;
+	memcpy(copy, ptr, header->size < size ? header->size : size);
+	bench_counter_free(ctx, ptr);
+	return copy;
+}
+
+static void bench_counter_init(cfg_allocator_t *allocator, bench_counter_t *counter)
+{
+	counter->bytes = 0;
+	counter->allocations = 0;
+	allocator->malloc_fn = bench_counter_malloc;
+	allocator->realloc_fn = bench_counter_realloc;
+	allocator->free_fn = bench_counter_free;
+	allocator->ctx = (void *)counter;
+}
+
+/* seconds of wall time; clock() sums the time of all threads on POSIX */
+static double bench_wall_clock(void)
+{
+#ifdef _WIN32
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+#endif
+}
+
+/* wait without using the CPU, like a program waiting for I/O */
+static void bench_sleep(double sec)
+{
+#ifdef _WIN32
+	Sleep((DWORD)(sec * 1000));
+#else
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)sec;
+	ts.tv_nsec = (long)((sec - (double)ts.tv_sec) * 1000000000.0);
+	nanosleep(&ts, NULL);
+#endif
+}
+
+/* generate a buffer with 'nsections' sections of 'nkeys' keys each */
+static char *bench_buffer_gen(cfg_uint32 nsections, cfg_uint32 nkeys, cfg_uint32 *len)
+{
+	cfg_uint32 i, j, allocated = 4096;
+	char *buf, *ptr;
+
+	*len = 0;
+	buf = (char *)malloc(allocated);
+	for (i = 0; i < nsections; i++) {
+		for (j = 0; j < nkeys + 1; j++) {
+			if (*len + 64 > allocated) {
+				allocated <<= 1;
+				buf = (char *)realloc(buf, allocated);
+			}
+			ptr = buf + *len;
+			if (!j)
+				*len += sprintf(ptr, "[section%u]\n", i);
+			else
+				*len += sprintf(ptr, "key%u=value%u\n", j - 1, i * nkeys + j - 1);
+		}
+	}
+	return buf;
+}
+
+/* lookups of all keys at 1M keys, linear search versus the perfect hash index */
+static void bench_index(void)
+{
+	static const cfg_uint32 nsections = 1000, nkeys = 1000;
+	cfg_uint32 i, j, len, found;
+	char *buf, section[32], key[32];
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(nsections, nkeys, &len);
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_FALSE);
+	free(buf);
+
+	found = 0;
+	begin = clock();
+	for (i = 0; i < nsections; i++) {
+		sprintf(section, "section%u", i);
+		for (j = 0; j < nkeys; j++) {
+			sprintf(key, "key%u", j);
+			found += cfg_entry_get(st, section, key) != NULL;
+		}
+	}
+	printf("index: %u lookups without index: %.4f sec (%u found)\n", nsections * nkeys, BENCH_TIME(begin), found);
+
+	begin = clock();
+	cfg_optimize(st);
+	printf("index: cfg_optimize(): %.4f sec\n", BENCH_TIME(begin));
+
+	found = 0;
+	begin = clock();
+	for (i = 0; i < nsections; i++) {
+		sprintf(section, "section%u", i);
+		for (j = 0; j < nkeys; j++) {
+			sprintf(key, "key%u", j);
+			found += cfg_entry_get(st, section, key) != NULL;
+		}
+	}
+	printf("index: %u lookups with index: %.4f sec (%u found)\n", nsections * nkeys, BENCH_TIME(begin), found);
+	cfg_free(st);
+}
+
+/* startup with and without a parse snapshot; 50k sections with 20 keys each */
+static void bench_snapshot(void)
+{
+	static const char *filename = "bench_snapshot.cfg";
+	cfg_uint32 len;
+	char *buf, path[32];
+	cfg_t *st;
+	clock_t begin;
+	FILE *f;
+
+	buf = bench_buffer_gen(50000, 20, &len);
+	f = fopen(filename, "wb");
+	fwrite(buf, 1, len, f);
+	fclose(f);
+	free(buf);
+
+	st = cfg_alloc();
+	begin = clock();
+	cfg_file_parse(st, (cfg_char *)filename);
+	printf("snapshot: parse without snapshots: %.4f sec\n", BENCH_TIME(begin));
+
+	/* no snapshot is written for a file modified in the current second */
+	bench_sleep(1.0);
+	cfg_snapshot_dir_set(st, ".");
+	begin = clock();
+	cfg_file_parse(st, (cfg_char *)filename);
+	printf("snapshot: cold parse (parse and write snapshot): %.4f sec\n", BENCH_TIME(begin));
+	cfg_free(st);
+
+	st = cfg_alloc();
+	cfg_snapshot_dir_set(st, ".");
+	begin = clock();
+	cfg_file_parse(st, (cfg_char *)filename);
+	printf("snapshot: warm parse (load snapshot): %.4f sec (%s)\n", BENCH_TIME(begin),
+		cfg_value_get(st, "section49999", "key19"));
+	cfg_free(st);
+
+	sprintf(path, "./%08x.snap", (unsigned int)cfg_hash_get(filename));
+	remove(path);
+	remove(filename);
+}
+
+/* parse and free 1M keys with the default and the bump pointer allocator */
+static void bench_alloc(void)
+{
+	cfg_uint32 len;
+	char *buf, *copy;
+	cfg_allocator_t *bump;
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(1000, 1000, &len);
+	copy = (char *)malloc(len);
+
+	memcpy(copy, buf, len);
+	begin = clock();
+	st = cfg_alloc();
+	cfg_buffer_parse(st, copy, len, CFG_FALSE);
+	cfg_free(st);
+	printf("alloc: parse and free with malloc(): %.4f sec\n", BENCH_TIME(begin));
+
+	memcpy(copy, buf, len);
+	begin = clock();
+	bump = cfg_bump_allocator_alloc(0);
+	st = cfg_alloc_ex(bump);
+	cfg_buffer_parse(st, copy, len, CFG_FALSE);
+	cfg_free(st);
+	cfg_bump_allocator_free(bump);
+	printf("alloc: parse and free with the bump allocator: %.4f sec\n", BENCH_TIME(begin));
+
+	free(copy);
+	free(buf);
+}
+
+/* memory and parse time with and without interning; 10k sections that share
+ * the same 20 keys */
+static void bench_intern(void)
+{
+	cfg_uint32 len, i;
+	char *buf, *copy;
+	cfg_allocator_t allocator;
+	bench_counter_t counter;
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(10000, 20, &len);
+	copy = (char *)malloc(len);
+	for (i = 0; i < 2; i++) {
+		bench_counter_init(&allocator, &counter);
+		st = cfg_alloc_ex(&allocator);
+		cfg_intern_set(st, i == 1);
+		memcpy(copy, buf, len);
+		begin = clock();
+		cfg_buffer_parse(st, copy, len, CFG_FALSE);
+		printf("intern: %s: parse %.4f sec, %lu bytes in %lu allocations\n",
+			i ? "interned" : "not interned", BENCH_TIME(begin),
+			(unsigned long)counter.bytes, (unsigned long)counter.allocations);
+		cfg_free(st);
+	}
+	free(copy);
+	free(buf);
+}
+
+/* missed lookups in a single section of growing size; the cache is disabled
+ * so every lookup scans all key hashes of the section */
+static void bench_simd(void)
+{
+	static const cfg_uint32 sizes[] = { 8, 64, 512, 4096, 32768, 100000 };
+	cfg_uint32 i, j, len, n, found;
+	char *buf, key[32];
+	cfg_t *st;
+	clock_t begin;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		buf = bench_buffer_gen(1, sizes[i], &len);
+		st = cfg_alloc();
+		cfg_cache_size_set(st, 0);
+		cfg_buffer_parse(st, buf, len, CFG_FALSE);
+		free(buf);
+
+		/* keep the number of scanned hashes about the same for each size */
+		n = 200000000 / sizes[i];
+		found = 0;
+		begin = clock();
+		for (j = 0; j < n; j++) {
+			sprintf(key, "missing%u", j & 1023);
+			found += cfg_entry_get(st, "section0", key) != NULL;
+		}
+		printf("simd: %u entries, %u missed lookups: %.4f sec (%u found)\n", sizes[i], n, BENCH_TIME(begin), found);
+		cfg_free(st);
+	}
+}
+
+/* 10M lookups of 30 keys by name versus by pre-hashed handle */
+static void bench_key(void)
+{
+	static const cfg_uint32 nkeys = 30, n = 10000000;
+	cfg_uint32 i, j, len, found;
+	char *buf, names[30][32];
+	cfg_key_t keys[30];
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(100, nkeys, &len);
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_FALSE);
+	free(buf);
+	for (i = 0; i < nkeys; i++) {
+		sprintf(names[i], "key%u", i);
+		keys[i] = cfg_key_make("section50", names[i]);
+	}
+
+	for (j = 0; j < 2; j++) {
+		if (j)
+			cfg_optimize(st);
+		found = 0;
+		begin = clock();
+		for (i = 0; i < n; i++)
+			found += cfg_value_get(st, "section50", names[i % nkeys]) != NULL;
+		printf("key: %s: %u lookups by name: %.4f sec (%u found)\n", j ? "index" : "no index", n, BENCH_TIME(begin), found);
+
+		found = 0;
+		begin = clock();
+		for (i = 0; i < n; i++)
+			found += cfg_key_value_get(st, &keys[i % nkeys]) != NULL;
+		printf("key: %s: %u lookups by handle: %.4f sec (%u found)\n", j ? "index" : "no index", n, BENCH_TIME(begin), found);
+	}
+	cfg_free(st);
+}
+
+/* 100 keys from one section (1000 sections of 200 keys) looked up 100k times,
+ * one by one versus in one batch */
+static void bench_batch(void)
+{
+	static const cfg_uint32 nkeys = 100, n = 100000;
+	cfg_uint32 i, j, k, len, found;
+	char *buf, names[100][32];
+	const cfg_char *keys[100];
+	cfg_char *values[100];
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(1000, 200, &len);
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_FALSE);
+	free(buf);
+	for (i = 0; i < nkeys; i++) {
+		sprintf(names[i], "key%u", i * 2);
+		keys[i] = names[i];
+	}
+
+	for (j = 0; j < 2; j++) {
+		if (j)
+			cfg_optimize(st);
+		found = 0;
+		begin = clock();
+		for (i = 0; i < n; i++) {
+			for (k = 0; k < nkeys; k++)
+				found += cfg_value_get(st, "section500", keys[k]) != NULL;
+		}
+		printf("batch: %s: %u x %u cfg_value_get(): %.4f sec (%u found)\n", j ? "index" : "no index", n, nkeys, BENCH_TIME(begin), found);
+
+		found = 0;
+		begin = clock();
+		for (i = 0; i < n; i++) {
+			cfg_values_get_many(st, "section500", keys, nkeys, values);
+			found += values[nkeys - 1] != NULL;
+		}
+		printf("batch: %s: %u x cfg_values_get_many(%u): %.4f sec (%u found)\n", j ? "index" : "no index", n, nkeys, BENCH_TIME(begin), found * nkeys);
+	}
+	cfg_free(st);
+}
+
+/* fill a struct of 200 int fields from a section of 200 keys 10k times, one
+ * lookup and conversion per field versus cfg_section_bind() */
+typedef struct {
+	cfg_int field[200];
+} bench_bind_t;
+
+static void bench_bind(void)
+{
+	static const cfg_uint32 nfields = 200, n = 10000;
+	cfg_uint32 i, j, len;
+	char *buf, names[200][32];
+	cfg_bind_t table[200];
+	bench_bind_t data;
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(10, nfields, &len);
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_FALSE);
+	free(buf);
+	for (i = 0; i < nfields; i++) {
+		sprintf(names[i], "key%u", i);
+		table[i].key = names[i];
+		table[i].type = CFG_BIND_INT;
+		table[i].offset = offsetof(bench_bind_t, field) + i * sizeof(cfg_int);
+		table[i].def = NULL;
+	}
+
+	begin = clock();
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < nfields; j++)
+			data.field[j] = cfg_value_to_int(cfg_value_get(st, "section5", names[j]));
+	}
+	printf("bind: %u x %u cfg_value_get() + cfg_value_to_int(): %.4f sec (%d)\n", n, nfields, BENCH_TIME(begin), data.field[nfields - 1]);
+
+	begin = clock();
+	for (i = 0; i < n; i++)
+		cfg_section_bind(st, "section5", table, nfields, &data);
+	printf("bind: %u x cfg_section_bind(%u): %.4f sec (%d)\n", n, nfields, BENCH_TIME(begin), data.field[nfields - 1]);
+	cfg_free(st);
+}
+
+static cfg_bool bench_prefix_count(void *ctx, cfg_entry_t *entry)
+{
+	(void)entry;
+	(*(cfg_uint32 *)ctx)++;
+	return CFG_TRUE;
+}
+
+/* 1000 prefix queries ("key100" .. "key1099") on a section of 100k keys, a
+ * linear scan versus cfg_entries_prefix() */
+static void bench_prefix(void)
+{
+	static const cfg_uint32 nkeys = 100000, n = 1000;
+	cfg_uint32 i, j, len, plen, found;
+	char *buf, prefix[32];
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(1, nkeys, &len);
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_FALSE);
+	free(buf);
+	section = cfg_section_get(st, "section0");
+
+	found = 0;
+	begin = clock();
+	for (i = 0; i < n; i++) {
+		plen = (cfg_uint32)sprintf(prefix, "key%u", i + 100);
+		for (j = 0; j < nkeys; j++) {
+			entry = cfg_entry_nth(st, section, j);
+			found += !strncmp(cfg_entry_key_get(st, entry), prefix, plen);
+		}
+	}
+	printf("prefix: %u x linear scan of %u keys: %.4f sec (%u found)\n", n, nkeys, BENCH_TIME(begin), found);
+
+	begin = clock();
+	cfg_entry_sorted_nth(st, section, 0);
+	printf("prefix: sorting %u keys: %.4f sec\n", nkeys, BENCH_TIME(begin));
+
+	found = 0;
+	begin = clock();
+	for (i = 0; i < n; i++) {
+		sprintf(prefix, "key%u", i + 100);
+		cfg_entries_prefix(st, "section0", prefix, bench_prefix_count, (void *)&found);
+	}
+	printf("prefix: %u x cfg_entries_prefix(): %.4f sec (%u found)\n", n, BENCH_TIME(begin), found);
+	cfg_free(st);
+}
+
+/* parse 5000 sections of 20 keys and read 5 of them, with and without lazy
+ * parsing; the memory is what the library object holds afterwards */
+static void bench_lazy(void)
+{
+	static const cfg_uint32 nsections = 5000, nkeys = 20;
+	static const char *sections[] = { "section10", "section999", "section2500", "section4000", "section4999" };
+	cfg_uint32 i, j, len, found;
+	char *buf, key[32];
+	cfg_allocator_t allocator;
+	bench_counter_t counter;
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(nsections, nkeys, &len);
+	for (i = 0; i < 2; i++) {
+		bench_counter_init(&allocator, &counter);
+		st = cfg_alloc_ex(&allocator);
+		cfg_lazy_set(st, i == 1);
+		found = 0;
+		begin = clock();
+		cfg_buffer_parse(st, buf, len, CFG_TRUE);
+		for (j = 0; j < 5 * nkeys; j++) {
+			sprintf(key, "key%u", j % nkeys);
+			found += cfg_value_get(st, sections[j / nkeys], key) != NULL;
+		}
+		printf("lazy: %s: parse and read 5 sections: %.4f sec, %lu bytes in %lu allocations (%u found)\n",
+			i ? "lazy" : "not lazy", BENCH_TIME(begin),
+			(unsigned long)counter.bytes, (unsigned long)counter.allocations, found);
+		cfg_free(st);
+	}
+	free(buf);
+}
+
+/* a catalog of 50k keys with quoted 200 byte values holding escapes: the
+ * parse and the first read of all values, which unescapes them */
+static void bench_unescape(void)
+{
+	static const cfg_uint32 nkeys = 50000;
+	cfg_uint32 i, j, len, allocated, sum;
+	char *buf;
+	cfg_section_t *section;
+	cfg_t *st;
+	clock_t begin;
+
+	allocated = nkeys * 256;
+	buf = (char *)malloc(allocated);
+	for (i = 0, len = 0; i < nkeys; i++) {
+		len += sprintf(buf + len, "msg%u = \"", i);
+		for (j = 0; j < 19; j++)
+			len += sprintf(buf + len, "%s", j % 4 ? "word word " : "line\\n\\\" ");
+		len += sprintf(buf + len, "%u\"\n", i);
+	}
+	st = cfg_alloc();
+
+	begin = clock();
+	cfg_buffer_parse(st, buf, len, CFG_TRUE);
+	printf("unescape: parse %u keys (%u bytes): %.4f sec\n", nkeys, len, BENCH_TIME(begin));
+
+	for (j = 0; j < 2; j++) {
+		sum = 0;
+		begin = clock();
+		section = cfg_section_nth(st, 0);
+		for (i = 0; i < nkeys; i++)
+			sum += (cfg_uint32)strlen(cfg_entry_value_get(st, cfg_entry_nth(st, section, i)));
+		printf("unescape: %s read of all values: %.4f sec (%u bytes)\n", j ? "second" : "first", BENCH_TIME(begin), sum);
+	}
+	cfg_free(st);
+	free(buf);
+}
+
+/* write 1000 sections of 1000 keys with 1 to 32 threads; the output must not
+ * change with the number of threads */
+static void bench_write(void)
+{
+	static const cfg_uint32 nsections = 1000, nkeys = 1000;
+	cfg_uint32 i, len, out_len, serial_len = 0;
+	char *buf, *out, *serial = NULL;
+	cfg_t *st;
+	double begin;
+
+	buf = bench_buffer_gen(nsections, nkeys, &len);
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_TRUE);
+	for (i = 1; i <= 32; i <<= 1) {
+		cfg_threads_set(st, i);
+		begin = bench_wall_clock();
+		cfg_buffer_write(st, &out, &out_len);
+		printf("write: %u bytes, %u threads: %.4f sec", out_len, i, BENCH_WALL_TIME(begin));
+		if (!serial) {
+			serial = out;
+			serial_len = out_len;
+			puts("");
+			continue;
+		}
+		printf(" (%s)\n", out_len == serial_len && !memcmp(out, serial, out_len) ? "same" : "DIFFERENT");
+		free(out);
+	}
+	free(serial);
+	cfg_free(st);
+	free(buf);
+}
+
+/* 1000 files of a conf.d directory, each with a section of its own and an
+ * override of a shared section: a loop of cfg_file_parse() and
+ * cfg_value_set() versus cfg_dir_parse() with 1 to 8 threads */
+static void bench_dir(void)
+{
+	static const char *dir = "bench_conf.d";
+	static const cfg_uint32 nfiles = 1000, nkeys = 20;
+	cfg_uint32 i, j, k, threads;
+	char path[64];
+	FILE *f;
+	cfg_t *st, *file;
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	double begin;
+
+	BENCH_MKDIR(dir);
+	for (i = 0; i < nfiles; i++) {
+		sprintf(path, "%s/%04u-service.cfg", dir, i);
+		f = fopen(path, "w");
+		fprintf(f, "[global]\nlast=%u\n[service%u]\n", i, i);
+		for (j = 0; j < nkeys; j++)
+			fprintf(f, "key%u = \"value %u\"\n", j, i * nkeys + j);
+		fclose(f);
+	}
+
+	st = cfg_alloc();
+	begin = bench_wall_clock();
+	for (i = 0; i < nfiles; i++) {
+		sprintf(path, "%s/%04u-service.cfg", dir, i);
+		file = cfg_alloc();
+		cfg_file_parse(file, path);
+		for (j = 0; j < cfg_total_sections(file); j++) {
+			section = cfg_section_nth(file, j);
+			for (k = 0; k < cfg_total_entries(file, section); k++) {
+				entry = cfg_entry_nth(file, section, k);
+				cfg_value_set(st, cfg_section_name_get(file, section), cfg_entry_key_get(file, entry),
+					cfg_entry_value_get(file, entry), CFG_TRUE);
+			}
+		}
+		cfg_free(file);
+	}
+	printf("dir: %u files, parse and cfg_value_set() loop: %.4f sec (last: %s)\n", nfiles,
+		BENCH_WALL_TIME(begin), cfg_value_get(st, "global", "last"));
+	cfg_free(st);
+
+	for (threads = 1; threads <= 8; threads <<= 1) {
+		st = cfg_alloc();
+		begin = bench_wall_clock();
+		cfg_dir_parse(st, dir, "*.cfg", threads);
+		printf("dir: %u files, cfg_dir_parse(), %u threads: %.4f sec (last: %s)\n", nfiles, threads,
+			BENCH_WALL_TIME(begin), cfg_value_get(st, "global", "last"));
+		cfg_free(st);
+	}
+
+	for (i = 0; i < nfiles; i++) {
+		sprintf(path, "%s/%04u-service.cfg", dir, i);
+		remove(path);
+	}
+	rmdir(dir);
+}
+
+/* a base of 100 sections of 1000 keys with 3 layers overriding 100, 10 and 1
+ * keys per section: copying the layers into one object, flattening them and
+ * lookups of all keys through 1 to 4 indexed layers */
+static void bench_overlay(void)
+{
+	static const cfg_uint32 nsections = 100, nkeys[4] = { 1000, 100, 10, 1 }, rounds = 10;
+	cfg_uint32 i, j, k, len, found;
+	char *buf, section[32], key[32];
+	cfg_key_t *keys;
+	cfg_t *layer[4], *st;
+	cfg_section_t *section_ptr;
+	cfg_entry_t *entry;
+	cfg_overlay_t *overlay;
+	clock_t begin;
+
+	for (i = 0; i < 4; i++) {
+		buf = bench_buffer_gen(nsections, nkeys[i], &len);
+		layer[i] = cfg_alloc();
+		cfg_buffer_parse(layer[i], buf, len, CFG_FALSE);
+		free(buf);
+	}
+	keys = (cfg_key_t *)malloc(nsections * nkeys[0] * sizeof(cfg_key_t));
+	for (i = 0; i < nsections * nkeys[0]; i++) {
+		sprintf(section, "section%u", i / nkeys[0]);
+		sprintf(key, "key%u", i % nkeys[0]);
+		keys[i] = cfg_key_make(section, key);
+	}
+
+	st = cfg_alloc();
+	begin = clock();
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < cfg_total_sections(layer[i]); j++) {
+			section_ptr = cfg_section_nth(layer[i], j);
+			for (k = 0; k < cfg_total_entries(layer[i], section_ptr); k++) {
+				entry = cfg_entry_nth(layer[i], section_ptr, k);
+				cfg_entry_add(st, cfg_section_name_get(layer[i], section_ptr),
+					cfg_entry_key_get(layer[i], entry), cfg_entry_value_get(layer[i], entry));
+			}
+		}
+	}
+	printf("overlay: copy 4 layers with cfg_entry_add(): %.4f sec\n", BENCH_TIME(begin));
+	cfg_free(st);
+
+	overlay = cfg_overlay_alloc();
+	for (i = 0; i < 4; i++) {
+		cfg_optimize(layer[i]);
+		cfg_overlay_push(overlay, layer[i]);
+	}
+	begin = clock();
+	st = cfg_overlay_flatten(overlay);
+	printf("overlay: cfg_overlay_flatten() of 4 layers: %.4f sec\n", BENCH_TIME(begin));
+	cfg_optimize(st);
+
+	found = 0;
+	begin = clock();
+	for (j = 0; j < rounds; j++) {
+		for (i = 0; i < nsections * nkeys[0]; i++)
+			found += cfg_key_value_get(st, &keys[i]) != NULL;
+	}
+	printf("overlay: %u lookups, flattened: %.4f sec (%u found)\n", rounds * nsections * nkeys[0], BENCH_TIME(begin), found);
+	cfg_free(st);
+
+	for (k = 1; k <= 4; k++) {
+		while (cfg_overlay_pop(overlay) == CFG_STATUS_OK)
+			;
+		for (i = 0; i < k; i++)
+			cfg_overlay_push(overlay, layer[i]);
+		begin = clock();
+		cfg_overlay_key_value_get(overlay, &keys[0]);
+		printf("overlay: %u layers, lookup table: %.4f sec\n", k, BENCH_TIME(begin));
+		found = 0;
+		begin = clock();
+		for (j = 0; j < rounds; j++) {
+			for (i = 0; i < nsections * nkeys[0]; i++)
+				found += cfg_overlay_key_value_get(overlay, &keys[i]) != NULL;
+		}
+		printf("overlay: %u lookups, %u layers: %.4f sec (%u found)\n", rounds * nsections * nkeys[0], k, BENCH_TIME(begin), found);
+	}
+	cfg_overlay_free(overlay);
+	for (i = 0; i < 4; i++)
+		cfg_free(layer[i]);
+	free(keys);
+}
+
+/* merge 2000 sections of 500 keys into 1000 sections of 1000 keys (1M keys
+ * each, 500k in both): a loop of cfg_entry_add() versus cfg_merge() */
+static void bench_merge(void)
+{
+	static const char *policies[] = { "override", "keep", "error" };
+	cfg_uint32 i, j, dst_len, src_len;
+	char *dst_buf, *src_buf;
+	cfg_t *dst, *src;
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	cfg_status_t ret;
+	clock_t begin;
+
+	dst_buf = bench_buffer_gen(1000, 1000, &dst_len);
+	src_buf = bench_buffer_gen(2000, 500, &src_len);
+
+	dst = cfg_alloc();
+	src = cfg_alloc();
+	cfg_buffer_parse(dst, dst_buf, dst_len, CFG_TRUE);
+	cfg_buffer_parse(src, src_buf, src_len, CFG_TRUE);
+	begin = clock();
+	for (i = 0; i < cfg_total_sections(src); i++) {
+		section = cfg_section_nth(src, i);
+		for (j = 0; j < cfg_total_entries(src, section); j++) {
+			entry = cfg_entry_nth(src, section, j);
+			cfg_entry_add(dst, cfg_section_name_get(src, section), cfg_entry_key_get(src, entry), cfg_entry_value_get(src, entry));
+		}
+	}
+	printf("merge: cfg_entry_add() loop: %.4f sec\n", BENCH_TIME(begin));
+	cfg_free(dst);
+	cfg_free(src);
+
+	for (i = 0; i < 4; i++) {
+		dst = cfg_alloc();
+		src = cfg_alloc();
+		cfg_buffer_parse(dst, dst_buf, dst_len, CFG_TRUE);
+		cfg_buffer_parse(src, src_buf, src_len, CFG_TRUE);
+		begin = clock();
+		ret = cfg_merge(dst, src, i < 3 ? (cfg_merge_policy_t)i : CFG_MERGE_OVERRIDE, i == 3);
+		printf("merge: cfg_merge(), %s%s: %.4f sec (status %d, %u sections)\n", i < 3 ? policies[i] : "override",
+			i == 3 ? ", consume" : "", BENCH_TIME(begin), ret, cfg_total_sections(dst));
+		cfg_free(dst);
+		cfg_free(src);
+	}
+	free(dst_buf);
+	free(src_buf);
+}
+
+/* parse 1000 sections of 1000 lines where each of 100 keys repeats 10
+ * times, with each duplicate key policy */
+static void bench_duplicates(void)
+{
+	static const char *policies[] = { "keep", "first", "last" };
+	cfg_uint32 i, j, len, allocated = 4096, nentries;
+	char *buf;
+	cfg_t *st;
+	clock_t begin;
+
+	len = 0;
+	buf = (char *)malloc(allocated);
+	for (i = 0; i < 1000; i++) {
+		for (j = 0; j < 1001; j++) {
+			if (len + 64 > allocated) {
+				allocated <<= 1;
+				buf = (char *)realloc(buf, allocated);
+			}
+			if (!j)
+				len += sprintf(buf + len, "[section%u]\n", i);
+			else
+				len += sprintf(buf + len, "key%u=value%u\n", (j - 1) % 100, i * 1000 + j - 1);
+		}
+	}
+
+	for (i = CFG_DUPLICATES_KEEP; i <= CFG_DUPLICATES_LAST; i++) {
+		st = cfg_alloc();
+		cfg_duplicates_set(st, (cfg_duplicates_t)i);
+		begin = clock();
+		cfg_buffer_parse(st, buf, len, CFG_TRUE);
+		nentries = 0;
+		for (j = 0; j < cfg_total_sections(st); j++)
+			nentries += cfg_total_entries(st, cfg_section_nth(st, j));
+		printf("duplicates: parse, %s: %.4f sec (%u entries, section999/key5: %s)\n", policies[i], BENCH_TIME(begin),
+			nentries, cfg_value_get(st, "section999", "key5"));
+		begin = clock();
+		cfg_free(st);
+		printf("duplicates: free, %s: %.4f sec\n", policies[i], BENCH_TIME(begin));
+	}
+	free(buf);
+}
+
+/* count the changes passed by cfg_diff() */
+static cfg_bool bench_diff_count(void *ctx, cfg_diff_type_t type, const cfg_char *section,
+	cfg_entry_t *old_entry, cfg_entry_t *new_entry)
+{
+	(void)section, (void)old_entry, (void)new_entry;
+	((cfg_uint32 *)ctx)[type]++;
+	return CFG_TRUE;
+}
+
+/* the changes between two configs of 1M keys with 0.1% churn: nested
+ * cfg_section_nth() / cfg_entry_nth() loops with lookups versus cfg_diff() */
+static void bench_diff(void)
+{
+	cfg_uint32 i, j, len, count[3];
+	char *buf, section[32], key[32];
+	cfg_t *old_st, *new_st, *a, *b;
+	cfg_section_t *section_ptr;
+	cfg_entry_t *entry, *other;
+	cfg_char *name;
+	clock_t begin;
+
+	buf = bench_buffer_gen(1000, 1000, &len);
+	old_st = cfg_alloc();
+	new_st = cfg_alloc();
+	cfg_buffer_parse(old_st, buf, len, CFG_TRUE);
+	cfg_buffer_parse(new_st, buf, len, CFG_TRUE);
+	/* change 500 keys, remove 250 and add 250 */
+	for (i = 0; i < 1000; i++) {
+		sprintf(section, "section%u", i * 7 % 1000);
+		sprintf(key, "key%u", i * 13 % 1000);
+		if (i < 500)
+			cfg_value_set(new_st, section, key, "changed", CFG_FALSE);
+		else if (i < 750)
+			cfg_entry_delete(new_st, cfg_entry_get(new_st, section, key));
+		else
+			cfg_value_set(new_st, section, "added", "1", CFG_TRUE);
+	}
+	free(buf);
+
+	begin = clock();
+	memset(count, 0, sizeof(count));
+	for (j = 0; j < 2; j++) {
+		a = j ? new_st : old_st;
+		b = j ? old_st : new_st;
+		for (i = 0; i < cfg_total_sections(a); i++) {
+			section_ptr = cfg_section_nth(a, i);
+			name = cfg_section_name_get(a, section_ptr);
+			for (len = 0; len < cfg_total_entries(a, section_ptr); len++) {
+				entry = cfg_entry_nth(a, section_ptr, len);
+				other = cfg_entry_get(b, name, cfg_entry_key_get(a, entry));
+				if (!other)
+					count[j ? CFG_DIFF_ADDED : CFG_DIFF_REMOVED]++;
+				else if (!j && strcmp(cfg_entry_value_get(a, entry), cfg_entry_value_get(b, other)))
+					count[CFG_DIFF_CHANGED]++;
+			}
+		}
+	}
+	printf("diff: nested loops: %.4f sec (+%u -%u ~%u)\n", BENCH_TIME(begin),
+		count[CFG_DIFF_ADDED], count[CFG_DIFF_REMOVED], count[CFG_DIFF_CHANGED]);
+
+	begin = clock();
+	memset(count, 0, sizeof(count));
+	cfg_diff(old_st, new_st, bench_diff_count, (void *)count);
+	printf("diff: cfg_diff(): %.4f sec (+%u -%u ~%u)\n", BENCH_TIME(begin),
+		count[CFG_DIFF_ADDED], count[CFG_DIFF_REMOVED], count[CFG_DIFF_CHANGED]);
+
+	cfg_free(old_st);
+	cfg_free(new_st);
+}
+
+/* parse a buffer of more than 4GB in place: mostly comment lines, with
+ * sections before and after the 4GB mark. needs about 4.5GB of memory, so it
+ * only runs with CFG_BENCH_LARGE set. */
+static void bench_large(void)
+{
+	static const size_t len = ((size_t)1 << 32) + ((size_t)1 << 28);
+	size_t n, pos, out_len;
+	char *buf, *out;
+	cfg_t *st;
+	cfg_status_t ret;
+	clock_t begin;
+
+	if (!getenv("CFG_BENCH_LARGE")) {
+		puts("large: skipped, set CFG_BENCH_LARGE=1 to run");
+		return;
+	}
+	buf = (char *)malloc(len);
+	if (!buf) {
+		puts("large: cannot allocate the buffer");
+		return;
+	}
+	pos = sprintf(buf, "key=root\n[head]\nkey=head\n");
+	/* comment lines of up to 1MB until the tail */
+	while (pos < len - 64) {
+		n = len - 64 - pos < (1 << 20) ? len - 64 - pos : (1 << 20);
+		memset(buf + pos, ';', n - 1);
+		buf[pos + n - 1] = '\n';
+		pos += n;
+	}
+	pos += sprintf(buf + pos, "[tail]\nkey=\"tail value\"\n");
+	memset(buf + pos, '\n', len - pos);
+
+	st = cfg_alloc();
+	begin = clock();
+	ret = cfg_buffer_parse64(st, buf, len, CFG_FALSE);
+	printf("large: cfg_buffer_parse64() of %.2f GB: %.4f sec (status %d)\n", (double)len / (1 << 30), BENCH_TIME(begin), ret);
+	printf("large: root: %s, head: %s, tail: %s\n", cfg_root_value_get(st, "key"), cfg_value_get(st, "head", "key"),
+		cfg_value_get(st, "tail", "key"));
+	free(buf);
+
+	ret = cfg_buffer_write64(st, &out, &out_len);
+	printf("large: cfg_buffer_write64() (status %d, %lu bytes):\n%s", ret, (unsigned long)out_len, out);
+	free(out);
+	cfg_free(st);
+}
+
+/* read all values of an object; returns their total length */
+static size_t bench_memory_walk(cfg_t *st)
+{
+	cfg_section_t *section;
+	cfg_uint32 i, j;
+	size_t sum = 0;
+
+	for (i = 0; i < cfg_total_sections(st); i++) {
+		section = cfg_section_nth(st, i);
+		for (j = 0; j < cfg_total_entries(st, section); j++)
+			sum += strlen(cfg_entry_value_get(st, cfg_entry_nth(st, section, j)));
+	}
+	return sum;
+}
+
+static void bench_memory_print(cfg_t *st, const char *when, bench_counter_t *counter)
+{
+	cfg_memory_stats_t stats;
+
+	cfg_memory_stats(st, &stats);
+	printf("memory: %s: stats %lu bytes (strings %lu, entries %lu, wasted %lu) in %lu allocations, "
+		"allocator %lu bytes in %lu allocations\n", when, (unsigned long)stats.total, (unsigned long)stats.strings,
+		(unsigned long)stats.entries, (unsigned long)stats.wasted, (unsigned long)stats.allocations,
+		(unsigned long)counter->bytes, (unsigned long)counter->allocations);
+}
+
+/* memory stats of 1M keys against the counting allocator, before and after
+ * editing 10% of the values and compacting the strings */
+static void bench_memory(void)
+{
+	cfg_uint32 len, i;
+	char *buf, value[32];
+	cfg_allocator_t allocator;
+	bench_counter_t counter;
+	cfg_t *st;
+	clock_t begin;
+	size_t sum;
+
+	buf = bench_buffer_gen(10000, 100, &len);
+	bench_counter_init(&allocator, &counter);
+	st = cfg_alloc_ex(&allocator);
+	cfg_buffer_parse(st, buf, len, CFG_FALSE);
+	free(buf);
+	bench_memory_print(st, "parsed", &counter);
+
+	for (i = 0; i < 100000; i++) {
+		sprintf(value, "key%u", i % 100);
+		sprintf(value + 16, "edited%u", i);
+		/* spread over all sections */
+		cfg_value_set(st, cfg_section_name_get(st, cfg_section_nth(st, (i * 7919) % 10000)), value, value + 16, CFG_FALSE);
+	}
+	bench_memory_print(st, "edited", &counter);
+
+	begin = clock();
+	sum = bench_memory_walk(st);
+	printf("memory: read all values: %.4f sec (%lu bytes)\n", BENCH_TIME(begin), (unsigned long)sum);
+	begin = clock();
+	cfg_shrink(st);
+	printf("memory: cfg_shrink(): %.4f sec\n", BENCH_TIME(begin));
+	bench_memory_print(st, "shrunk", &counter);
+	begin = clock();
+	sum = bench_memory_walk(st);
+	printf("memory: read all values: %.4f sec (%lu bytes)\n", BENCH_TIME(begin), (unsigned long)sum);
+	cfg_free(st);
+}
+
+/* private copies of a config of 1M keys: parsing it again, a deep copy with
+ * cfg_merge() and copy-on-write clones */
+static void bench_clone(void)
+{
+	cfg_uint32 len, i;
+	char *buf, key[16];
+	cfg_allocator_t allocator;
+	bench_counter_t counter;
+	cfg_t *st, *copy, *clone[100];
+	clock_t begin;
+	size_t bytes;
+
+	buf = bench_buffer_gen(10000, 100, &len);
+	bench_counter_init(&allocator, &counter);
+	st = cfg_alloc_ex(&allocator);
+	cfg_buffer_parse(st, buf, len, CFG_TRUE);
+
+	copy = cfg_alloc_ex(&allocator);
+	bytes = counter.bytes;
+	begin = clock();
+	cfg_buffer_parse(copy, buf, len, CFG_TRUE);
+	printf("clone: parse again: %.4f sec, %lu bytes\n", BENCH_TIME(begin), (unsigned long)(counter.bytes - bytes));
+	cfg_free(copy);
+
+	copy = cfg_alloc_ex(&allocator);
+	bytes = counter.bytes;
+	begin = clock();
+	cfg_merge(copy, st, CFG_MERGE_OVERRIDE, CFG_FALSE);
+	printf("clone: cfg_merge() into an empty object: %.4f sec, %lu bytes\n", BENCH_TIME(begin),
+		(unsigned long)(counter.bytes - bytes));
+	cfg_free(copy);
+	free(buf);
+
+	begin = clock();
+	clone[0] = cfg_clone(st);
+	printf("clone: first cfg_clone(), freezing the source: %.4f sec\n", BENCH_TIME(begin));
+	bytes = counter.bytes;
+	begin = clock();
+	for (i = 1; i < 100; i++)
+		clone[i] = cfg_clone(st);
+	printf("clone: cfg_clone(): %.6f sec, %lu bytes per clone\n", BENCH_TIME(begin) / 99,
+		(unsigned long)((counter.bytes - bytes) / 99));
+
+	/* one edit in each of 100 sections of a clone */
+	bytes = counter.bytes;
+	begin = clock();
+	for (i = 0; i < 100; i++) {
+		sprintf(key, "section%u", i * 100);
+		cfg_value_set(clone[1], key, "key0", "edited", CFG_FALSE);
+	}
+	printf("clone: 100 edits in 100 sections: %.6f sec, %lu bytes (section0/key0: %s / %s)\n", BENCH_TIME(begin),
+		(unsigned long)(counter.bytes - bytes), cfg_value_get(st, "section0", "key0"), cfg_value_get(clone[1], "section0", "key0"));
+
+	begin = clock();
+	for (i = 0; i < 100; i++)
+		cfg_free(clone[i]);
+	printf("clone: cfg_free() of a clone: %.6f sec\n", BENCH_TIME(begin) / 100);
+	cfg_free(st);
+}
+
+/* the startup of a program which parses its config and also waits as long
+ * for other work, e.g. connecting to services: first one after the other,
+ * then with the parse in the background until the first lookup */
+static void bench_async(void)
+{
+	static const char *filename = "bench_async.cfg";
+	cfg_uint32 len;
+	char *buf;
+	cfg_t *st;
+	cfg_parse_t *parse;
+	double begin, parse_time;
+	FILE *f;
+
+	buf = bench_buffer_gen(2000, 100, &len);
+	f = fopen(filename, "wb");
+	fwrite(buf, 1, len, f);
+	fclose(f);
+	free(buf);
+
+	st = cfg_alloc();
+	begin = bench_wall_clock();
+	cfg_file_parse(st, (cfg_char *)filename);
+	parse_time = BENCH_WALL_TIME(begin);
+	printf("async: cfg_file_parse(): %.4f sec\n", parse_time);
+	cfg_free(st);
+
+	st = cfg_alloc();
+	begin = bench_wall_clock();
+	cfg_file_parse(st, (cfg_char *)filename);
+	bench_sleep(parse_time);
+	printf("async: startup, parse then wait: %.4f sec (%s)\n", BENCH_WALL_TIME(begin),
+		cfg_value_get(st, "section1999", "key99"));
+	cfg_free(st);
+
+	st = cfg_alloc();
+	begin = bench_wall_clock();
+	cfg_parse_async(st, filename, CFG_ASYNC_THREAD | CFG_ASYNC_BLOCK, &parse);
+	bench_sleep(parse_time);
+	printf("async: startup, cfg_parse_async() while waiting: %.4f sec (%s)\n", BENCH_WALL_TIME(begin),
+		cfg_value_get(st, "section1999", "key99"));
+	cfg_parse_wait(parse);
+	cfg_free(st);
+	remove(filename);
+}
+
+static void bench_subscribe_count(void *ctx, const cfg_char *section, const cfg_char *key, const cfg_char *value)
+{
+	(void)section, (void)key, (void)value;
+	(*(cfg_uint32 *)ctx)++;
+}
+
+/* 1000 watched keys with 10 changes per tick: polling all of them every tick
+ * versus subscriptions, and the cost of a change with and without batching */
+static void bench_subscribe(void)
+{
+	static const cfg_uint32 nsections = 100, nkeys = 10, nticks = 10000, nchanges = 10;
+	cfg_uint32 i, j, t, len, count = 0;
+	char *buf, section[32], key[32];
+	const cfg_char *value;
+	cfg_t *st;
+	clock_t begin;
+
+	buf = bench_buffer_gen(nsections, nkeys, &len);
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_TRUE);
+	cfg_optimize(st);
+
+	begin = clock();
+	for (t = 0; t < nticks; t++) {
+		value = t & 1 ? "b" : "a";
+		for (i = 0; i < nchanges; i++) {
+			sprintf(section, "section%u", i * 10);
+			cfg_value_set(st, section, "key0", value, CFG_FALSE);
+		}
+		for (i = 0; i < nsections; i++) {
+			sprintf(section, "section%u", i);
+			for (j = 0; j < nkeys; j++) {
+				sprintf(key, "key%u", j);
+				count += !strcmp(cfg_value_get(st, section, key), value);
+			}
+		}
+	}
+	printf("subscribe: %u ticks, polling %u keys: %.4f sec (%u changes)\n", nticks, nsections * nkeys,
+		BENCH_TIME(begin), count);
+
+	begin = clock();
+	for (t = 0; t < nticks; t++) {
+		value = t & 1 ? "b" : "a";
+		for (i = 0; i < nchanges; i++) {
+			sprintf(section, "section%u", i * 10);
+			cfg_value_set(st, section, "key0", value, CFG_FALSE);
+		}
+	}
+	printf("subscribe: %u ticks, changes without subscribers: %.4f sec\n", nticks, BENCH_TIME(begin));
+
+	count = 0;
+	for (i = 0; i < nsections; i++) {
+		sprintf(section, "section%u", i);
+		for (j = 0; j < nkeys; j++) {
+			sprintf(key, "key%u", j);
+			cfg_subscribe(st, section, key, bench_subscribe_count, &count);
+		}
+	}
+	begin = clock();
+	for (t = 0; t < nticks; t++) {
+		value = t & 1 ? "b" : "a";
+		for (i = 0; i < nchanges; i++) {
+			sprintf(section, "section%u", i * 10);
+			cfg_value_set(st, section, "key0", value, CFG_FALSE);
+		}
+	}
+	printf("subscribe: %u ticks, %u subscribed keys: %.4f sec (%u changes)\n", nticks, nsections * nkeys,
+		BENCH_TIME(begin), count);
+
+	/* the same key changes 10 times per tick, delivered once */
+	count = 0;
+	cfg_changes_batch_set(st, CFG_TRUE);
+	begin = clock();
+	for (t = 0; t < nticks; t++) {
+		for (i = 0; i < nchanges; i++)
+			cfg_value_set(st, "section0", "key0", i & 1 ? "b" : "a", CFG_FALSE);
+		cfg_changes_dispatch(st);
+	}
+	printf("subscribe: %u ticks, batched changes of one key: %.4f sec (%u changes)\n", nticks,
+		BENCH_TIME(begin), count);
+
+	cfg_free(st);
+	free(buf);
+}
+
+/* parse 100K lines of which every other one has no equal sign, with the
+ * warnings not kept and kept in a ring */
+static void bench_diagnostics(void)
+{
+	static const cfg_uint32 nlines = 100000, n = 10;
+	cfg_uint32 i, len = 0, total;
+	char *buf;
+	cfg_t *st;
+	clock_t begin;
+
+	buf = (char *)malloc(nlines * 32);
+	for (i = 0; i < nlines; i++)
+		len += sprintf(buf + len, i & 1 ? "broken line %u\n" : "key%u=value\n", i);
+	st = cfg_alloc();
+	cfg_verbose_set(st, 1);
+
+	begin = clock();
+	for (i = 0; i < n; i++)
+		cfg_buffer_parse(st, buf, len, CFG_TRUE);
+	i = 0;
+	cfg_diagnostics_get(st, NULL, &i, &total);
+	printf("diagnostics: %u x cfg_buffer_parse(), not kept: %.4f sec (%u warnings)\n", n, BENCH_TIME(begin), total);
+
+	cfg_diagnostics_set(st, 1024);
+	begin = clock();
+	for (i = 0; i < n; i++)
+		cfg_buffer_parse(st, buf, len, CFG_TRUE);
+	i = 0;
+	cfg_diagnostics_get(st, NULL, &i, &total);
+	printf("diagnostics: %u x cfg_buffer_parse(), ring of 1024: %.4f sec (%u warnings)\n", n, BENCH_TIME(begin), total);
+
+	cfg_free(st);
+	free(buf);
+}
+
+static cfg_bool bench_scan_count(void *ctx, const cfg_char *section, cfg_uint32 section_hash,
+	const cfg_char *key, cfg_uint32 key_hash, const cfg_char *value)
+{
+	(void)section, (void)section_hash, (void)key, (void)key_hash, (void)value;
+	(*(cfg_uint32 *)ctx)++;
+	return CFG_TRUE;
+}
+
+/* the fields of bench_gen_t, for checking bench_gen_load() against lookups */
+typedef struct {
+	const char *section;
+	const char *key;
+	char type; /* 'i'nt, 'd'ouble or 's'tring */
+	size_t offset;
+} bench_gen_field_t;
+
+static const bench_gen_field_t bench_gen_fields[] = {
+	{ CFG_ROOT_SECTION, "name", 's', offsetof(bench_gen_t, name) },
+	{ CFG_ROOT_SECTION, "debug", 'i', offsetof(bench_gen_t, debug) },
+	{ CFG_ROOT_SECTION, "log_file", 's', offsetof(bench_gen_t, log_file) },
+	{ "server", "host", 's', offsetof(bench_gen_t, server.host) },
+	{ "server", "port", 'i', offsetof(bench_gen_t, server.port) },
+	{ "server", "threads", 'i', offsetof(bench_gen_t, server.threads) },
+	{ "server", "backlog", 'i', offsetof(bench_gen_t, server.backlog) },
+	{ "server", "timeout", 'd', offsetof(bench_gen_t, server.timeout) },
+	{ "server", "keepalive", 'i', offsetof(bench_gen_t, server.keepalive) },
+	{ "server", "max_body", 'i', offsetof(bench_gen_t, server.max_body) },
+	{ "server", "root", 's', offsetof(bench_gen_t, server.root) },
+	{ "database", "host", 's', offsetof(bench_gen_t, database.host) },
+	{ "database", "port", 'i', offsetof(bench_gen_t, database.port) },
+	{ "database", "user", 's', offsetof(bench_gen_t, database.user) },
+	{ "database", "password", 's', offsetof(bench_gen_t, database.password) },
+	{ "database", "pool_min", 'i', offsetof(bench_gen_t, database.pool_min) },
+	{ "database", "pool_max", 'i', offsetof(bench_gen_t, database.pool_max) },
+	{ "database", "connect_timeout", 'd', offsetof(bench_gen_t, database.connect_timeout) },
+	{ "database", "statement_timeout", 'd', offsetof(bench_gen_t, database.statement_timeout) },
+	{ "cache", "enabled", 'i', offsetof(bench_gen_t, cache.enabled) },
+	{ "cache", "size", 'i', offsetof(bench_gen_t, cache.size) },
+	{ "cache", "ttl", 'i', offsetof(bench_gen_t, cache.ttl) },
+	{ "cache", "eviction", 's', offsetof(bench_gen_t, cache.eviction) },
+	{ "cache", "ratio", 'd', offsetof(bench_gen_t, cache.ratio) },
+	{ "cache", "shards", 'i', offsetof(bench_gen_t, cache.shards) }
+};
+
+/* load 'buf' with bench_gen_load() and count the fields which differ from a
+ * lookup in the same buffer, or in the sample 'defaults' for missing keys.
+ * the numbers are converted with strtol() and strtod() like by the loader. */
+static cfg_uint32 bench_gen_check(const char *buf, cfg_t *defaults)
+{
+	cfg_uint32 i, len = (cfg_uint32)strlen(buf), mismatch = 0;
+	const bench_gen_field_t *field;
+	cfg_char *copy, *value;
+	bench_gen_t data;
+	cfg_t *st;
+	char *ptr;
+
+	copy = (cfg_char *)malloc(len);
+	memcpy(copy, buf, len);
+	st = cfg_alloc();
+	bench_gen_load(st, copy, len, CFG_TRUE, &data);
+	cfg_buffer_parse(st, copy, len, CFG_TRUE);
+	for (i = 0; i < sizeof(bench_gen_fields) / sizeof(bench_gen_fields[0]); i++) {
+		field = &bench_gen_fields[i];
+		ptr = (char *)&data + field->offset;
+		value = cfg_value_get(st, field->section, field->key);
+		if (!value)
+			value = cfg_value_get(defaults, field->section, field->key);
+		if (!value ||
+		    (field->type == 'i' && *(cfg_int *)ptr != (cfg_int)strtol(value, NULL, 0)) ||
+		    (field->type == 'd' && *(cfg_double *)ptr != strtod(value, NULL)) ||
+		    (field->type == 's' && strcmp(*(cfg_char **)ptr, value))) {
+			printf("gen: %s/%s differs from \"%s\"\n", field->section ? field->section : "", field->key, value ? value : "(null)");
+			mismatch++;
+		}
+	}
+	bench_gen_free(&data);
+	cfg_free(st);
+	free(copy);
+	return mismatch;
+}
+
+/* load bench_gen.cfg 100k times: parsing into a tree, a bare scan and the
+ * loader generated by cfg2-gen. first the loader is checked on the sample and
+ * on an edit of it with missing keys and hex and octal numbers. */
+static void bench_gen(void)
+{
+	static const cfg_uint32 n = 100000;
+	cfg_uint32 i, len, count = 0, differ, edited;
+	char *buf;
+	bench_gen_t data;
+	cfg_t *st;
+	clock_t begin;
+	FILE *f;
+
+	f = fopen("bench_gen.cfg", "rb");
+	if (!f) {
+		puts("gen: cannot open bench_gen.cfg");
+		return;
+	}
+	buf = (char *)malloc(4096);
+	len = (cfg_uint32)fread(buf, 1, 4095, f);
+	fclose(f);
+	buf[len] = '\0';
+	st = cfg_alloc();
+	cfg_buffer_parse(st, buf, len, CFG_TRUE);
+	differ = bench_gen_check(buf, st);
+	edited = bench_gen_check(
+		"name=edited\nunknown=1\n" \
+		"[server]\nport=0x1f91\nthreads=010\nroot=\"/tmp\"\n" \
+		"[database]\npool_max=0X40\nstatement_timeout=12.5\n" \
+		"[cache]\nsize=0777\nratio=-1e-3\n", st);
+	printf("gen: bench_gen_load() against cfg_value_get(), sample: %u differ, edited: %u differ\n", differ, edited);
+
+	begin = clock();
+	for (i = 0; i < n; i++)
+		cfg_buffer_parse(st, buf, len, CFG_TRUE);
+	printf("gen: %u x cfg_buffer_parse(): %.4f sec\n", n, BENCH_TIME(begin));
+
+	begin = clock();
+	for (i = 0; i < n; i++)
+		cfg_buffer_scan(st, buf, len, CFG_TRUE, bench_scan_count, (void *)&count);
+	printf("gen: %u x cfg_buffer_scan() (%u entries): %.4f sec\n", n, count / n, BENCH_TIME(begin));
+
+	begin = clock();
+	for (i = 0; i < n; i++) {
+		bench_gen_load(st, buf, len, CFG_TRUE, &data);
+		bench_gen_free(&data);
+	}
+	printf("gen: %u x bench_gen_load(): %.4f sec\n", n, BENCH_TIME(begin));
+
+	cfg_free(st);
+	free(buf);
+}
+
+static const bench_t benches[] = {
+	{ "index", bench_index },
+	{ "snapshot", bench_snapshot },
+	{ "alloc", bench_alloc },
+	{ "intern", bench_intern },
+	{ "simd", bench_simd },
+	{ "key", bench_key },
+	{ "batch", bench_batch },
+	{ "bind", bench_bind },
+	{ "gen", bench_gen },
+	{ "prefix", bench_prefix },
+	{ "lazy", bench_lazy },
+	{ "unescape", bench_unescape },
+	{ "write", bench_write },
+	{ "dir", bench_dir },
+	{ "overlay", bench_overlay },
+	{ "merge", bench_merge },
+	{ "diff", bench_diff },
+	{ "duplicates", bench_duplicates },
+	{ "large", bench_large },
+	{ "memory", bench_memory },
+	{ "clone", bench_clone },
+	{ "async", bench_async },
+	{ "subscribe", bench_subscribe },
+	{ "diagnostics", bench_diagnostics },
+	{ NULL, NULL }
+};
+
+int main(int argc, char **argv)
+{
+	const bench_t *bench;
+
+	puts("[cfg2 bench]");
+	for (bench = benches; bench->name; bench++) {
+		if (argc > 1 && strcmp(argv[1], bench->name))
+			continue;
+		printf("* %s\n", bench->name);
+		bench->func();
+	}
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * bench_cpp.cpp:
+ *	the C++ wrapper (cfg2.hpp) versus the raw C calls
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include "cfg2.hpp"
+
+#define BENCH_TIME(_begin) ((double)(clock() - (_begin)) / CLOCKS_PER_SEC)
+
+static const cfg_uint32 nsections = 1000, nkeys = 30, n = 10000000;
+
+static std::string bench_buffer_gen()
+{
+	std::string buf;
+	char line[64];
+	cfg_uint32 i, j;
+
+	for (i = 0; i < nsections; i++) {
+		std::sprintf(line, "[section%u]\n", i);
+		buf += line;
+		for (j = 0; j < nkeys; j++) {
+			std::sprintf(line, "key%u=%u\n", j, i * nkeys + j);
+			buf += line;
+		}
+	}
+	return buf;
+}
+
+/* the hashes from cfg2.hpp are computed at compile time and match the C API */
+static_assert(cfg::hash(CFG_ROOT_SECTION) == CFG_HASH_SEED, "cfg::hash() of the root section");
+static_assert(cfg::hash("port") == 0x57dc3e10u, "cfg::hash() differs from cfg_hash_get()");
+static_assert(cfg::key("server", "port").section_hash == 0x4115c562u, "cfg::key() differs from cfg_key_make()");
+
+/* check the wrapper against the C calls; returns the number of failed checks */
+static cfg_uint32 bench_check()
+{
+	static const char *names[] = { CFG_ROOT_SECTION, "", "port", "section500", "\xd0\xbf\xd1\x80\xd0\xbe" };
+	cfg::config config, other;
+	cfg_t *st;
+	cfg_key_t key;
+	std::string walk;
+	cfg_uint32 i, failed = 0;
+
+	for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		key = cfg_key_make(names[i], names[4 - i]);
+		if (cfg::hash(names[i]) != cfg_hash_get(names[i]) ||
+		    cfg::key(names[i], names[4 - i]).section_hash != key.section_hash ||
+		    cfg::key(names[i], names[4 - i]).key_hash != key.key_hash) {
+			printf("check: the hash of \"%s\" differs\n", names[i] ? names[i] : "(root)");
+			failed++;
+		}
+	}
+
+	config.parse("k=1\n[a]\nx=0x10\ny=2\n[b]\nz=3\n");
+	if (config.value("a", "missing") != std::nullopt || config.get<cfg_int>(cfg::key("c", "x")) != std::nullopt ||
+	    config.value(cfg::key("a", "y")) != "2" || config.get<cfg_int>("a", "x") != 16) {
+		puts("check: lookups differ");
+		failed++;
+	}
+
+	for (const cfg::section section : config) {
+		for (const cfg::entry entry : section)
+			walk += std::string(section.name()) + "/" + std::string(entry.key()) + "=" + std::string(entry.value()) + " ";
+	}
+	if (walk != "/k=1 a/x=0x10 a/y=2 b/z=3 ") {
+		printf("check: range-for differs: %s\n", walk.c_str());
+		failed++;
+	}
+
+	other.parse("k=2\n");
+	st = config.get();
+	other = std::move(config);
+	cfg::config moved(std::move(other));
+	if (config.get() || other.get() || moved.get() != st || moved.value(CFG_ROOT_SECTION, "k") != "1") {
+		puts("check: move differs");
+		failed++;
+	}
+	return failed;
+}
+
+int main()
+{
+	static constexpr cfg_key_t keys[] = {
+		cfg::key("section500", "key0"), cfg::key("section500", "key1"),
+		cfg::key("section500", "key2"), cfg::key("section500", "key3"),
+		cfg::key("section500", "key4"), cfg::key("section500", "key5"),
+		cfg::key("section500", "key6"), cfg::key("section500", "key7")
+	};
+	static const char *names[] = { "key0", "key1", "key2", "key3", "key4", "key5", "key6", "key7" };
+	cfg::config config;
+	cfg_t *st;
+	const cfg_char *value;
+	cfg_uint32 i, sum;
+	clock_t begin;
+
+	puts("[cfg2 bench_cpp]");
+	if (bench_check()) {
+		puts("checks failed");
+		return 1;
+	}
+	puts("checks passed");
+	config.parse(bench_buffer_gen());
+	config.optimize();
+	st = config.get();
+
+	sum = 0;
+	begin = clock();
+	for (i = 0; i < n; i++) {
+		value = cfg_value_get(st, "section500", names[i & 7]);
+		sum += value ? (cfg_uint32)std::strlen(value) : 0;
+	}
+	printf("C: %u cfg_value_get() + strlen(): %.4f sec (%u)\n", n, BENCH_TIME(begin), sum);
+
+	sum = 0;
+	begin = clock();
+	for (i = 0; i < n; i++)
+		sum += (cfg_uint32)config.value("section500", names[i & 7]).value_or("").size();
+	printf("C++: %u config.value(): %.4f sec (%u)\n", n, BENCH_TIME(begin), sum);
+
+	sum = 0;
+	begin = clock();
+	for (i = 0; i < n; i++) {
+		value = cfg_key_value_get(st, &keys[i & 7]);
+		sum += value ? (cfg_uint32)cfg_value_to_int(value) : 0;
+	}
+	printf("C: %u cfg_key_value_get() + cfg_value_to_int(): %.4f sec (%u)\n", n, BENCH_TIME(begin), sum);
+
+	sum = 0;
+	begin = clock();
+	for (i = 0; i < n; i++)
+		sum += (cfg_uint32)config.get<cfg_int>(keys[i & 7]).value_or(0);
+	printf("C++: %u config.get<cfg_int>(): %.4f sec (%u)\n", n, BENCH_TIME(begin), sum);
+
+	sum = 0;
+	begin = clock();
+	for (i = 0; i < 100; i++) {
+		cfg_uint32 s, e, nentries, total = cfg_total_sections(st);
+		cfg_section_t *section;
+		for (s = 0; s < total; s++) {
+			section = cfg_section_nth(st, s);
+			nentries = cfg_total_entries(st, section);
+			for (e = 0; e < nentries; e++)
+				sum += (cfg_uint32)std::strlen(cfg_entry_value_get(st, cfg_entry_nth(st, section, e)));
+		}
+	}
+	printf("C: 100 iterations with cfg_section_nth() / cfg_entry_nth(): %.4f sec (%u)\n", BENCH_TIME(begin), sum);
+
+	sum = 0;
+	begin = clock();
+	for (i = 0; i < 100; i++) {
+		for (const cfg::section section : config) {
+			for (const cfg::entry entry : section)
+				sum += (cfg_uint32)entry.value().size();
+		}
+	}
+	printf("C++: 100 iterations with range-for: %.4f sec (%u)\n", BENCH_TIME(begin), sum);
+	return 0;
+}
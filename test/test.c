@@ -10,6 +10,7 @@
  *	test file for the api
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +21,123 @@
 #define PRINT_TESTS       1
 #define PRINT_WRITE_BUF   0
 
+/* a struct for testing cfg_section_bind() */
+typedef struct {
+	cfg_char *key1;
+	cfg_double key6;
+	cfg_int missing;
+} test_bind_t;
+
+/* count the entries passed by cfg_buffer_scan() */
+static cfg_bool test_scan(void *ctx, const cfg_char *section, cfg_uint32 section_hash,
+	const cfg_char *key, cfg_uint32 key_hash, const cfg_char *value)
+{
+	(void)section, (void)section_hash, (void)key, (void)key_hash, (void)value;
+	(*(cfg_uint32 *)ctx)++;
+	return CFG_TRUE;
+}
+
+/* print the keys passed by cfg_entries_prefix() */
+static cfg_bool test_prefix(void *ctx, cfg_entry_t *entry)
+{
+	printf(" %s", cfg_entry_key_get((cfg_t *)ctx, entry));
+	return CFG_TRUE;
+}
+
+/* print the changes passed by cfg_diff() */
+static cfg_bool test_diff(void *ctx, cfg_diff_type_t type, const cfg_char *section,
+	cfg_entry_t *old_entry, cfg_entry_t *new_entry)
+{
+	static const cfg_char type_char[] = { '+', '-', '~' };
+	cfg_t *st = (cfg_t *)ctx;
+
+	printf(" %c%s/%s", type_char[type], section ? section : "", cfg_entry_key_get(st, old_entry ? old_entry : new_entry));
+	return CFG_TRUE;
+}
+
+/* print the changes passed to a subscriber */
+static void test_change(void *ctx, const cfg_char *section, const cfg_char *key, const cfg_char *value)
+{
+	printf(" %s%s/%s=%s", (const char *)ctx, section ? section : "", key, value ? value : "(removed)");
+}
+
+/* a counting allocator for cfg_alloc_ex(); forwards to 'next' or to malloc() */
+typedef struct {
+	const cfg_allocator_t *next;
+	cfg_uint32 allocs;
+	cfg_uint32 frees;
+} test_alloc_t;
+
+static void *test_malloc(void *ctx, size_t size)
+{
+	test_alloc_t *a = (test_alloc_t *)ctx;
+
+	a->allocs++;
+	return a->next ? a->next->malloc_fn(a->next->ctx, size) : malloc(size);
+}
+
+static void *test_realloc(void *ctx, void *ptr, size_t size)
+{
+	test_alloc_t *a = (test_alloc_t *)ctx;
+
+	if (!ptr)
+		a->allocs++;
+	return a->next ? a->next->realloc_fn(a->next->ctx, ptr, size) : realloc(ptr, size);
+}
+
+static void test_free(void *ctx, void *ptr)
+{
+	test_alloc_t *a = (test_alloc_t *)ctx;
+
+	a->frees++;
+	if (a->next)
+		a->next->free_fn(a->next->ctx, ptr);
+	else
+		free(ptr);
+}
+
+/* parse, edit and write 'in_file' with the counting allocator 'a' */
+static void test_allocator(test_alloc_t *a, cfg_char *in_file)
+{
+	cfg_allocator_t allocator;
+	cfg_char *out = NULL, *value;
+	cfg_uint32 len = 0;
+	cfg_t *st;
+
+	allocator.malloc_fn = test_malloc;
+	allocator.realloc_fn = test_realloc;
+	allocator.free_fn = test_free;
+	allocator.ctx = (void *)a;
+	a->allocs = a->frees = 0;
+	st = cfg_alloc_ex(&allocator);
+	cfg_file_parse(st, in_file);
+	cfg_value_set(st, "section1", "key1", "a value longer than the old one", CFG_FALSE);
+	cfg_value_set(st, "new", "key", "value", CFG_TRUE);
+	cfg_entry_add(st, "new", "key2", "value2");
+	cfg_section_delete(st, "section2");
+	cfg_buffer_write(st, &out, &len);
+	value = cfg_value_get(st, "section1", "key1");
+	printf("%s, written: %u, allocs == frees: ", value ? value : "(null)", len);
+	free(out);
+	cfg_free(st);
+	printf("%d (%u)", a->allocs == a->frees, a->allocs);
+}
+
+/* if the key 'name' of the sections 'a' and 'b' is stored once */
+static cfg_bool test_interned(cfg_t *st)
+{
+	cfg_char *a = cfg_entry_key_get(st, cfg_entry_get(st, "a", "name"));
+	cfg_char *b = cfg_entry_key_get(st, cfg_entry_get(st, "b", "name"));
+
+	return a && a == b;
+}
+
+static const cfg_bind_t test_bind_table[] = {
+	{ "key1", CFG_BIND_STRING, offsetof(test_bind_t, key1), NULL },
+	{ "key6", CFG_BIND_DOUBLE, offsetof(test_bind_t, key6), NULL },
+	{ "missing", CFG_BIND_INT, offsetof(test_bind_t, missing), "42" }
+};
+
 /*
  * test parsing a file or a buffer directly. when calling a parsing method
  * the memory pointed by the cfg_t will be released automatically.
@@ -30,6 +148,11 @@ int main(void)
 	cfg_status_t err;
 	cfg_t *st;
 	cfg_entry_t *entry;
+	cfg_key_t key;
+	const cfg_char *batch_keys[] = { "key1", "key6", "missing" };
+	cfg_char *batch_values[3];
+	test_bind_t bind;
+	cfg_uint32 scanned = 0;
 	char buf[] =
 "key1=value1\n\n\n\n" \
 "[s]\n" \
@@ -38,8 +161,19 @@ int main(void)
 "key4=value4\n";
 	char in_file[] = "test.cfg";
 	char out_file[] = "out.cfg";
-	cfg_char *write_buf, *ptr;
-	cfg_uint32 write_len;
+	cfg_overlay_t *overlay;
+	cfg_t *layer, *flat;
+	cfg_char *write_buf, *parallel_buf, *ptr;
+	cfg_uint32 write_len, parallel_len;
+	size_t large_len;
+	cfg_memory_stats_t stats, shrunk;
+	cfg_parse_t *parse, *parse2;
+	cfg_diagnostic_t diag[8];
+	cfg_uint32 ndiag, ntotal, i;
+	char snap_path[32];
+	FILE *f;
+	test_alloc_t counting;
+	cfg_allocator_t *bump;
 
 	clock_t begin, end;
 	double time_spent;
@@ -54,6 +188,8 @@ int main(void)
 	err = cfg_verbose_set(st, VERBOSE);
 	err = cfg_cache_size_set(st, 4);
 	puts("* parse");
+	err = cfg_buffer_scan(st, buf, strlen(buf), CFG_TRUE, test_scan, (void *)&scanned);
+	printf("scanned entries: %u\n", scanned);
 	err = cfg_buffer_parse(st, buf, strlen(buf), CFG_TRUE);
 
 	begin = clock();
@@ -98,6 +234,31 @@ int main(void)
 	entry = cfg_entry_get(st, "section1", "key9");
 	printf("test entry from section: %s\n", (entry) ? cfg_entry_value_get(st, entry) : "not found");
 
+	/* test a pre-hashed key handle */
+	puts("");
+	key = cfg_key_make("section1", "key1");
+	printf("find value by key handle (key1): %s\n", cfg_key_value_get(st, &key));
+	key = cfg_key_make(CFG_ROOT_SECTION, "some_new_key");
+	printf("find value by root key handle (some_new_key): %s\n", cfg_key_value_get(st, &key));
+
+	/* test a batch lookup */
+	puts("");
+	err = cfg_values_get_many(st, "section1", batch_keys, 3, batch_values);
+	printf("batch lookup (%d): %s, %s, %s\n", err, batch_values[0], batch_values[1], batch_values[2] ? "ERROR" : "not found");
+
+	/* test binding a section to a struct */
+	puts("");
+	err = cfg_section_bind(st, "section1", test_bind_table, 3, &bind);
+	printf("bind section (%d): %s, %f, %d\n", err, bind.key1, bind.key6, bind.missing);
+
+	/* test a prefix query and ordered iteration */
+	puts("");
+	printf("keys with prefix 'key1' in key order:");
+	err = cfg_entries_prefix(st, "section1", "key1", test_prefix, (void *)st);
+	printf(" (%d)\n", err);
+	entry = cfg_entry_sorted_nth(st, cfg_section_get(st, "section1"), 0);
+	printf("first key in key order: %s\n", entry ? cfg_entry_key_get(st, entry) : "ERROR");
+
 	puts("");
 	puts("test conversations:");
 	printf("%u\n", cfg_value_to_bool("0"));
@@ -108,6 +269,25 @@ int main(void)
 	ptr = cfg_hex_to_char(cfg_entry_value_get(st, entry));
 	puts(ptr);
 	puts(cfg_char_to_hex(ptr));
+
+	/* test the perfect hash index */
+	puts("");
+	err = cfg_optimize(st);
+	printf("optimize: %d\n", err);
+	printf("find value by key with index (key1): %s\n", cfg_value_get(st, "section1", "key1"));
+	printf("find value by key with index (key00): %s\n", cfg_root_value_get(st, "key00"));
+	printf("find missing key with index: %s\n", cfg_value_get(st, "section1", "missing") ? "ERROR" : "OK");
+	key = cfg_key_make("section1", "key1");
+	printf("find value by key handle with index (key1): %s\n", cfg_key_value_get(st, &key));
+	err = cfg_values_get_many(st, "section1", batch_keys, 3, batch_values);
+	printf("batch lookup with index (%d): %s, %s, %s\n", err, batch_values[0], batch_values[1], batch_values[2] ? "ERROR" : "not found");
+
+	/* test lazy parsing; the sections are parsed on first use */
+	puts("");
+	cfg_lazy_set(st, CFG_TRUE);
+	err = cfg_file_parse(st, in_file);
+	printf("lazy parse (%d), find value by key (key1): %s\n", err, cfg_value_get(st, "section1", "key1"));
+	printf("lazy parse, find value by root key (key00): %s\n", cfg_root_value_get(st, "key00"));
 #endif
 
 	puts("");
@@ -121,10 +301,29 @@ int main(void)
 		puts(write_buf);
 		free(write_buf);
 	}
-#else
-	(void)write_buf, (void)write_len;
 #endif
 
+	/* test parallel writing; the output does not depend on the threads */
+	cfg_buffer_write(st, &write_buf, &write_len);
+	cfg_threads_set(st, 4);
+	err = cfg_buffer_write(st, &parallel_buf, &parallel_len);
+	cfg_threads_set(st, 1);
+	printf("parallel write (%d), same output: %d\n", err, write_buf && parallel_buf &&
+		write_len == parallel_len && !memcmp(write_buf, parallel_buf, write_len));
+	free(parallel_buf);
+
+	/* test the 64bit size API on the same output */
+	layer = cfg_alloc();
+	err = cfg_buffer_parse64(layer, write_buf, write_len, CFG_TRUE);
+	free(write_buf);
+	cfg_buffer_write(layer, &write_buf, &write_len);
+	err = cfg_buffer_write64(layer, &parallel_buf, &large_len);
+	printf("64bit parse and write (%d), same output: %d\n", err, write_buf && parallel_buf &&
+		write_len == large_len && !memcmp(write_buf, parallel_buf, write_len));
+	free(write_buf);
+	free(parallel_buf);
+	cfg_free(layer);
+
 	begin = clock();
 	err = cfg_file_write(st, out_file);
 	end = clock();
@@ -132,6 +331,296 @@ int main(void)
 	time_spent = (double)(end - begin) / CLOCKS_PER_SEC;
 	printf("time spent writing %s: %.4f sec\n", out_file, time_spent);
 
+	/* test parsing a directory; later files override earlier ones */
+	puts("");
+	cfg_clear(st);
+	cfg_root_value_set(st, "name", "default", CFG_TRUE);
+	err = cfg_dir_parse(st, "conf.d", "*.cfg", 2);
+	printf("dir parse (%d), name: %s, level: %s\n", err, cfg_root_value_get(st, "name"), cfg_root_value_get(st, "level"));
+	printf("dir parse, net port: %s, extra key: %s\n", cfg_value_get(st, "net", "port"), cfg_value_get(st, "extra", "key"));
+
+	/* test an overlay of the directory over the test file */
+	layer = cfg_alloc();
+	cfg_file_parse(layer, in_file);
+	overlay = cfg_overlay_alloc();
+	cfg_overlay_push(overlay, layer);
+	cfg_overlay_push(overlay, st);
+	cfg_overlay_value_set(overlay, "section1", "key1", "overlay");
+	printf("overlay, name: %s, key1: %s, key3: %s\n", cfg_overlay_value_get(overlay, CFG_ROOT_SECTION, "name"),
+		cfg_overlay_value_get(overlay, "section1", "key1"), cfg_overlay_value_get(overlay, "section1", "key3"));
+	flat = cfg_overlay_flatten(overlay);
+	printf("overlay flatten, key1: %s, key3: %s, sections: %u\n", cfg_value_get(flat, "section1", "key1"),
+		cfg_value_get(flat, "section1", "key3"), flat ? cfg_total_sections(flat) : 0);
+	cfg_free(flat);
+	cfg_file_parse(layer, in_file);
+	printf("overlay after a reload of the base, key3: %s\n", cfg_overlay_value_get(overlay, "section1", "key3"));
+	cfg_overlay_free(overlay);
+
+	/* test merging with the three policies */
+	err = cfg_merge(st, layer, CFG_MERGE_ERROR, CFG_FALSE);
+	printf("merge, error on conflict: %d\n", err);
+	err = cfg_merge(st, layer, CFG_MERGE_KEEP, CFG_FALSE);
+	printf("merge, keep (%d), key1: %s, key3: %s\n", err, cfg_value_get(st, "section1", "key1"), cfg_value_get(st, "section1", "key3"));
+	err = cfg_merge(st, layer, CFG_MERGE_OVERRIDE, CFG_TRUE);
+	printf("merge, override (%d), key1: %s, source sections: %u\n", err, cfg_value_get(st, "section1", "key1"), cfg_total_sections(layer));
+
+	/* test a diff of the test file and a changed copy */
+	cfg_file_parse(layer, in_file);
+	flat = cfg_alloc();
+	cfg_file_parse(flat, in_file);
+	cfg_value_set(flat, "section1", "key1", "changed", CFG_FALSE);
+	cfg_value_set(flat, "section1", "added", "1", CFG_TRUE);
+	cfg_entry_delete(flat, cfg_entry_get(flat, "section1", "key3"));
+	printf("diff:");
+	err = cfg_diff(layer, flat, test_diff, (void *)layer);
+	printf(" (%d)\n", err);
+	cfg_free(flat);
+
+	/* test the duplicate key policies, with the last one lazy */
+	for (scanned = CFG_DUPLICATES_KEEP; scanned <= CFG_DUPLICATES_LAST; scanned++) {
+		cfg_duplicates_set(layer, (cfg_duplicates_t)scanned);
+		cfg_lazy_set(layer, scanned == CFG_DUPLICATES_LAST);
+		err = cfg_buffer_parse(layer, "k=1\nk=2\n[s]\nk=3\nj=4\nk=\" 5 \"\n", 28, CFG_TRUE);
+		printf("duplicates %u (%d), k: %s, s/k: %s, s entries: %u\n", scanned, err, cfg_root_value_get(layer, "k"),
+			cfg_value_get(layer, "s", "k"), cfg_total_entries(layer, cfg_section_get(layer, "s")));
+	}
+
+	/* test the memory stats before and after a shrink; the index stays valid */
+	cfg_duplicates_set(layer, CFG_DUPLICATES_KEEP);
+	cfg_lazy_set(layer, CFG_FALSE);
+	cfg_file_parse(layer, in_file);
+	cfg_value_set(layer, "section1", "key1", "edited", CFG_FALSE);
+	cfg_optimize(layer);
+	cfg_memory_stats(layer, &stats);
+	err = cfg_shrink(layer);
+	cfg_memory_stats(layer, &shrunk);
+	printf("shrink (%d), allocations: %lu -> %lu, strings: %lu -> %lu, key1: %s\n", err,
+		(unsigned long)stats.allocations, (unsigned long)shrunk.allocations, (unsigned long)stats.strings,
+		(unsigned long)shrunk.strings, cfg_value_get(layer, "section1", "key1"));
+	cfg_value_set(layer, "section1", "key1", "again", CFG_FALSE);
+	cfg_memory_stats(layer, &stats);
+	printf("after an edit, key1: %s, wasted: %lu, total: %lu\n", cfg_value_get(layer, "section1", "key1"),
+		(unsigned long)stats.wasted, (unsigned long)stats.total);
+
+	/* test a copy-on-write clone; the base does not see its changes */
+	flat = cfg_clone(layer);
+	cfg_value_set(flat, "section1", "key1", "cloned", CFG_FALSE);
+	cfg_entry_delete(flat, cfg_entry_get(flat, "section1", "key3"));
+	cfg_memory_stats(flat, &stats);
+	printf("clone (%d), key1: %s / %s, key3: %s / %s, shared: %d\n", flat ? cfg_status_get(layer) : -1,
+		cfg_value_get(layer, "section1", "key1"), cfg_value_get(flat, "section1", "key1"),
+		cfg_value_get(layer, "section1", "key3"), cfg_value_get(flat, "section1", "key3"), stats.shared > 0);
+	cfg_free(layer);
+	printf("clone after freeing the base, key1: %s, key6: %s\n", cfg_value_get(flat, "section1", "key1"),
+		cfg_value_get(flat, "section1", "key6"));
+	cfg_free(flat);
+
+	/* test a parse in the background; with CFG_ASYNC_BLOCK a lookup waits for
+	 * it, otherwise it fails until the parse run by the caller is done */
+	layer = cfg_alloc();
+	err = cfg_parse_async(layer, in_file, CFG_ASYNC_THREAD | CFG_ASYNC_BLOCK, &parse);
+	ptr = cfg_value_get(layer, "section1", "key1");
+	printf("async parse (%d), key1: %s", err, ptr ? ptr : "(null)");
+	printf(", wait: %d\n", cfg_parse_wait(parse));
+	cfg_parse_async(layer, in_file, 0, &parse);
+	ptr = cfg_value_get(layer, "section1", "key1");
+	printf("async parse on the caller's thread, key1: %s", ptr ? ptr : "(null)");
+	printf(" (%d)", cfg_status_get(layer));
+	printf(", poll: %d", cfg_parse_poll(parse));
+	printf(", run: %d", cfg_parse_run(parse));
+	printf(", poll: %d", cfg_parse_poll(parse));
+	printf(", run again: %d", cfg_parse_run(parse));
+	ptr = cfg_value_get(layer, "section1", "key1");
+	printf(", key1: %s", ptr ? ptr : "(null)");
+	printf(", wait: %d\n", cfg_parse_wait(parse));
+	/* a waiting lookup runs a parse which the caller did not run yet */
+	cfg_clear(layer);
+	cfg_parse_async(layer, in_file, CFG_ASYNC_BLOCK, &parse);
+	ptr = cfg_value_get(layer, "section1", "key1");
+	printf("async parse run by a lookup, key1: %s", ptr ? ptr : "(null)");
+	printf(", run: %d", cfg_parse_run(parse));
+	printf(", wait: %d\n", cfg_parse_wait(parse));
+	/* an edit while a parse is pending fails or waits, as it would be lost */
+	cfg_parse_async(layer, in_file, 0, &parse);
+	entry = cfg_entry_add(layer, "section1", "x", "1");
+	printf("async parse pending, add: %s (%d)", entry ? "added" : "(null)", cfg_status_get(layer));
+	printf(", set: %d", cfg_value_set(layer, "section1", "key1", "edited", CFG_FALSE));
+	cfg_parse_run(parse);
+	printf(", wait: %d", cfg_parse_wait(parse));
+	cfg_parse_async(layer, in_file, CFG_ASYNC_BLOCK, &parse);
+	entry = cfg_entry_add(layer, "section1", "x", "1");
+	ptr = cfg_value_get(layer, "section1", "x");
+	printf(", add with CFG_ASYNC_BLOCK: %s", ptr ? ptr : "(null)");
+	printf(", wait: %d\n", cfg_parse_wait(parse));
+	cfg_parse_async(layer, "missing.cfg", CFG_ASYNC_THREAD, &parse);
+	err = cfg_parse_wait(parse);
+	ptr = cfg_value_get(layer, "section1", "key1");
+	printf("async parse of a missing file (%d), key1: %s\n", err, ptr ? ptr : "(null)");
+	cfg_parse_async(layer, in_file, CFG_ASYNC_THREAD, &parse);
+	flat = cfg_alloc();
+	cfg_parse_async(flat, in_file, 0, &parse2);
+	cfg_free(layer);
+	cfg_free(flat);
+	printf("async parse after freeing the object: %d", cfg_parse_wait(parse));
+	printf(", not run: %d", cfg_parse_run(parse2));
+	printf(", wait: %d\n", cfg_parse_wait(parse2));
+
+	/* test subscriptions to a key, a prefix and a section; a reload only
+	 * reports what changed, and a batch is coalesced until it is dispatched */
+	layer = cfg_alloc();
+	cfg_buffer_parse(layer, "[s]\nkey1=a\nkey2=b\nother=c\n", 26, CFG_TRUE);
+	err = cfg_subscribe(layer, "s", "key1", test_change, "exact:");
+	cfg_subscribe(layer, "s", "key*", test_change, "prefix:");
+	cfg_subscribe(layer, "s", NULL, test_change, "all:");
+	printf("subscribe (%d), set:", err);
+	cfg_value_set(layer, "s", "key1", "x", CFG_FALSE);
+	printf("\nsame value:");
+	cfg_value_set(layer, "s", "key1", "x", CFG_FALSE);
+	printf("\nadd and delete:");
+	cfg_value_set(layer, "s", "key3", "d", CFG_TRUE);
+	cfg_entry_delete(layer, cfg_entry_get(layer, "s", "other"));
+	printf("\nreload:");
+	cfg_buffer_parse(layer, "[s]\nkey1=x\nkey2=e\nkey4=f\n", 25, CFG_TRUE);
+	printf("\nunsubscribe (%d", cfg_unsubscribe(layer, test_change, "all:"));
+	printf(", %d):", cfg_unsubscribe(layer, test_change, "all:"));
+	cfg_changes_batch_set(layer, CFG_TRUE);
+	cfg_value_set(layer, "s", "key1", "y", CFG_FALSE);
+	cfg_value_set(layer, "s", "key1", "z", CFG_FALSE);
+	cfg_value_set(layer, "s", "key2", "g", CFG_FALSE);
+	printf(" batch:");
+	printf(" (%d)\n", cfg_changes_dispatch(layer));
+	cfg_changes_batch_set(layer, CFG_FALSE);
+	flat = cfg_alloc();
+	cfg_buffer_parse(flat, "[s]\nkey1=z\nkey2=merged\nkey5=h\n", 30, CFG_TRUE);
+	printf("merge:");
+	cfg_merge(layer, flat, CFG_MERGE_OVERRIDE, CFG_FALSE);
+	cfg_subscribe(layer, CFG_ROOT_SECTION, "name", test_change, "dir:");
+	printf(", dir parse:");
+	cfg_dir_parse(layer, "conf.d", "*.cfg", 1);
+	printf("\n");
+	cfg_free(flat);
+	cfg_free(layer);
+
+	/* test the warnings of a parse kept in a ring; a smaller ring keeps the
+	 * newest ones and a scan does not change them */
+	layer = cfg_alloc();
+	cfg_diagnostics_set(layer, 8);
+	cfg_file_parse(layer, in_file);
+	ndiag = 8;
+	err = cfg_diagnostics_get(layer, diag, &ndiag, &ntotal);
+	printf("diagnostics (%d), %u of %u:", err, ndiag, ntotal);
+	for (i = 0; i < ndiag; i++)
+		printf(" %d@%u:%u", diag[i].code, diag[i].line, diag[i].column);
+	cfg_diagnostics_set(layer, 2);
+	cfg_file_parse(layer, in_file);
+	cfg_buffer_scan(layer, "k\n", 2, CFG_TRUE, test_scan, (void *)&scanned);
+	ndiag = 8;
+	cfg_diagnostics_get(layer, diag, &ndiag, &ntotal);
+	printf("\nring of 2, %u of %u:", ndiag, ntotal);
+	for (i = 0; i < ndiag; i++)
+		printf(" %d@%u:%u", diag[i].code, diag[i].line, diag[i].column);
+	/* a file with warnings gets no snapshot, so they are the same every time */
+	cfg_snapshot_dir_set(layer, ".");
+	cfg_file_parse(layer, in_file);
+	ndiag = 0;
+	cfg_diagnostics_get(layer, NULL, &ndiag, &ntotal);
+	printf("\nwith snapshots, warnings: %u", ntotal);
+	cfg_file_parse(layer, in_file);
+	cfg_diagnostics_get(layer, NULL, &ndiag, &ntotal);
+	printf(", parsed again: %u", ntotal);
+	sprintf(snap_path, "%08x.snap", (unsigned int)cfg_hash_get(in_file));
+	f = fopen(snap_path, "rb");
+	printf(", snapshot: %s", f ? "written" : "none");
+	if (f)
+		fclose(f);
+	remove(snap_path);
+	cfg_free(layer);
+	puts("");
+
+	/* test that a parse writes a snapshot and a new object loads it */
+	layer = cfg_alloc();
+	cfg_snapshot_dir_set(layer, ".");
+	err = cfg_file_parse(layer, "conf.d/10-base.cfg");
+	cfg_free(layer);
+	sprintf(snap_path, "%08x.snap", (unsigned int)cfg_hash_get("conf.d/10-base.cfg"));
+	f = fopen(snap_path, "rb");
+	printf("snapshot (%d): %s", err, f ? "written" : "none");
+	if (f)
+		fclose(f);
+	layer = cfg_alloc();
+	cfg_snapshot_dir_set(layer, ".");
+	err = cfg_file_parse(layer, "conf.d/10-base.cfg");
+	ptr = cfg_root_value_get(layer, "name");
+	printf(", loaded (%d), name: %s", err, ptr ? ptr : "(null)");
+	ptr = cfg_value_get(layer, "net", "port");
+	printf(", net port: %s, sections: %u\n", ptr ? ptr : "(null)", cfg_total_sections(layer));
+	cfg_free(layer);
+	remove(snap_path);
+
+	/* test that an edit which keeps the size invalidates a snapshot, even in
+	 * the second the snapshot was taken */
+	f = fopen("snapshot.cfg", "wb");
+	fputs("k=1\n", f);
+	fclose(f);
+	layer = cfg_alloc();
+	cfg_snapshot_dir_set(layer, ".");
+	cfg_file_parse(layer, "snapshot.cfg");
+	f = fopen("snapshot.cfg", "wb");
+	fputs("k=2\n", f);
+	fclose(f);
+	err = cfg_file_parse(layer, "snapshot.cfg");
+	printf("snapshot after an edit (%d), k: %s\n", err, cfg_root_value_get(layer, "k"));
+	cfg_free(layer);
+	sprintf(snap_path, "%08x.snap", (unsigned int)cfg_hash_get("snapshot.cfg"));
+	remove(snap_path);
+	remove("snapshot.cfg");
+
+	/* test a custom allocator, by itself and over a bump allocator with blocks
+	 * small enough to overflow; all blocks taken must be given back */
+	counting.next = NULL;
+	printf("custom allocator, section1/key1: ");
+	test_allocator(&counting, in_file);
+	bump = cfg_bump_allocator_alloc(256);
+	counting.next = bump;
+	printf("\nbump allocator, section1/key1: ");
+	test_allocator(&counting, in_file);
+	cfg_bump_allocator_free(bump);
+	puts("");
+
+	/* test interning turned on and off for an object which has keys, and kept
+	 * through a shrink, a clone and a merge which cannot move interned keys */
+	layer = cfg_alloc();
+	cfg_buffer_parse(layer, "[a]\nname=1\nport=2\n[b]\nname=3\n", 29, CFG_TRUE);
+	printf("intern, shared before: %d", test_interned(layer));
+	err = cfg_intern_set(layer, CFG_TRUE);
+	cfg_memory_stats(layer, &stats);
+	printf(", on (%d): %d, table: %d", err, test_interned(layer), stats.intern > 0);
+	err = cfg_shrink(layer);
+	printf(", shrink (%d): %d", err, test_interned(layer));
+	flat = cfg_clone(layer);
+	printf(", clone: %d", test_interned(flat));
+	cfg_free(flat);
+	flat = cfg_alloc();
+	cfg_intern_set(flat, CFG_TRUE);
+	cfg_buffer_parse(flat, "[b]\nname=4\nhost=h\n", 18, CFG_TRUE);
+	err = cfg_merge(layer, flat, CFG_MERGE_OVERRIDE, CFG_TRUE);
+	cfg_free(flat);
+	ptr = cfg_value_get(layer, "b", "host");
+	printf(", merge (%d): %d, b/host: %s", err, test_interned(layer), ptr ? ptr : "(null)");
+	flat = cfg_alloc();
+	cfg_buffer_parse(flat, "[a]\nname=5\n", 11, CFG_TRUE);
+	err = cfg_merge(flat, layer, CFG_MERGE_OVERRIDE, CFG_TRUE);
+	cfg_free(layer);
+	ptr = cfg_value_get(flat, "b", "name");
+	printf(", into no interning (%d): b/name: %s", err, ptr ? ptr : "(null)");
+	cfg_intern_set(flat, CFG_TRUE);
+	printf(", on: %d", test_interned(flat));
+	err = cfg_intern_set(flat, CFG_FALSE);
+	cfg_memory_stats(flat, &stats);
+	ptr = cfg_value_get(flat, "a", "name");
+	printf(", off (%d): %d, table: %d, a/name: %s\n", err, test_interned(flat), stats.intern > 0, ptr ? ptr : "(null)");
+	cfg_free(flat);
+
 exit:
 	puts("");
 	puts("* free");
@@ -0,0 +1,422 @@
+/*
+ * cfg2
+ * a simplistic configuration parser for INI like syntax in C
+ *
+ * author: lubomir i. ivanov (neolit123 at gmail)
+ * this code is released in the public domain without warranty of any kind.
+ * providing credit to the original author is recommended but not mandatory.
+ *
+ * cfg2-gen.c:
+ *	generates a C header with a typed struct and a loader from a sample file.
+ *	usage: cfg2-gen <sample.cfg> <name> [output.h]
+ *
+ *	each key of the sample becomes a field; the type is taken from the value
+ *	(cfg_int, cfg_double or a string) and the value becomes the default. the
+ *	loader uses cfg_buffer_scan() and a switch over the precomputed hashes,
+ *	so no tree is built and no hashing is done besides the tokenizer's.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cfg2.h"
+
+#define GEN_NAME_SZ 256
+
+typedef enum {
+	GEN_TYPE_INT,
+	GEN_TYPE_DOUBLE,
+	GEN_TYPE_STRING
+} gen_type_t;
+
+static const char *gen_keywords[] = {
+	"auto", "break", "case", "char", "const", "continue", "default", "do",
+	"double", "else", "enum", "extern", "float", "for", "goto", "if", "int",
+	"long", "register", "return", "short", "signed", "sizeof", "static",
+	"struct", "switch", "typedef", "union", "unsigned", "void", "volatile",
+	"while", NULL
+};
+
+static gen_type_t gen_type_get(const cfg_char *value)
+{
+	char *end;
+	long number;
+	double real;
+
+	if (!value || !*value)
+		return GEN_TYPE_STRING;
+	number = strtol(value, &end, 0);
+	if (!*end && number >= -2147483647L - 1 && number <= 2147483647L)
+		return GEN_TYPE_INT;
+	/* no infinity or NaN, which have no C literal */
+	real = strtod(value, &end);
+	if (!*end && real - real == 0)
+		return GEN_TYPE_DOUBLE;
+	return GEN_TYPE_STRING;
+}
+
+/* turn a key or section name into a C identifier */
+static void gen_ident(const cfg_char *str, char *out)
+{
+	const char **keyword;
+	size_t i = 0;
+
+	if (isdigit((unsigned char)*str))
+		out[i++] = '_';
+	for (; *str && i < GEN_NAME_SZ - 2; str++)
+		out[i++] = isalnum((unsigned char)*str) ? *str : '_';
+	out[i] = '\0';
+	for (keyword = gen_keywords; *keyword; keyword++) {
+		if (!strcmp(out, *keyword)) {
+			out[i++] = '_';
+			out[i] = '\0';
+			break;
+		}
+	}
+	if (!i)
+		strcpy(out, "_");
+}
+
+/* print a string as a C string literal */
+static void gen_literal(FILE *f, const cfg_char *str)
+{
+	fputc('"', f);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(f, "\\%c", *str);
+		else if (*str == '\n')
+			fputs("\\n", f);
+		else if (*str == '\t')
+			fputs("\\t", f);
+		else if ((unsigned char)*str < 0x20 || (unsigned char)*str > 0x7e)
+			fprintf(f, "\\%03o", (unsigned char)*str);
+		else
+			fputc(*str, f);
+	}
+	fputc('"', f);
+}
+
+/* print a name inside a C comment */
+static void gen_comment(FILE *f, const cfg_char *str)
+{
+	cfg_char last = 0;
+
+	for (; *str; last = *str++) {
+		if ((unsigned char)*str < 0x20 || (unsigned char)*str > 0x7e || (last == '*' && *str == '/'))
+			fputc('?', f);
+		else
+			fputc(*str, f);
+	}
+}
+
+/* check that no earlier entry of a section has the same key hash */
+static int gen_entry_is_first(cfg_t *st, cfg_section_t *section, cfg_uint32 n)
+{
+	cfg_uint32 i, hash = cfg_hash_get(cfg_entry_key_get(st, cfg_entry_nth(st, section, n)));
+
+	for (i = 0; i < n; i++) {
+		if (cfg_hash_get(cfg_entry_key_get(st, cfg_entry_nth(st, section, i))) == hash)
+			return 0;
+	}
+	return 1;
+}
+
+/* check that a section gets a struct: it has entries and no earlier section
+ * has the same hash */
+static int gen_section_is_first(cfg_t *st, cfg_uint32 n)
+{
+	cfg_uint32 i, hash = cfg_hash_get(cfg_section_name_get(st, cfg_section_nth(st, n)));
+
+	if (!n)
+		return 1;
+	/* a section named "" has the hash of the root section */
+	if (!cfg_total_entries(st, cfg_section_nth(st, n)) || hash == CFG_ROOT_SECTION_HASH)
+		return 0;
+	for (i = 1; i < n; i++) {
+		if (cfg_hash_get(cfg_section_name_get(st, cfg_section_nth(st, i))) == hash &&
+		    cfg_total_entries(st, cfg_section_nth(st, i)))
+			return 0;
+	}
+	return 1;
+}
+
+/* the C expression of a field, like 'cfg->section.key' */
+static void gen_field(cfg_t *st, cfg_section_t *section, cfg_entry_t *entry, char *out)
+{
+	char ident[GEN_NAME_SZ];
+
+	strcpy(out, "cfg->");
+	if (section != cfg_section_nth(st, 0)) {
+		gen_ident(cfg_section_name_get(st, section), ident);
+		strcat(out, ident);
+		strcat(out, ".");
+	}
+	gen_ident(cfg_entry_key_get(st, entry), ident);
+	strcat(out, ident);
+}
+
+/* check that no two members of the struct get the same C name */
+static int gen_check_names(cfg_t *st)
+{
+	char (*names)[GEN_NAME_SZ * 2 + 8];
+	cfg_uint32 i, j, n = 0, total = 0;
+	cfg_section_t *section;
+	int ret = 1;
+
+	for (i = 0; i < cfg_total_sections(st); i++)
+		total += cfg_total_entries(st, cfg_section_nth(st, i)) + 1;
+	names = malloc(total * sizeof(*names));
+	if (!names)
+		return 0;
+
+	/* the fields and the section members, which live next to the root keys */
+	for (i = 0; i < cfg_total_sections(st); i++) {
+		if (!gen_section_is_first(st, i))
+			continue;
+		section = cfg_section_nth(st, i);
+		if (i) {
+			strcpy(names[n], "cfg->");
+			gen_ident(cfg_section_name_get(st, section), names[n] + 5);
+			n++;
+		}
+		for (j = 0; j < cfg_total_entries(st, section); j++) {
+			if (gen_entry_is_first(st, section, j))
+				gen_field(st, section, cfg_entry_nth(st, section, j), names[n++]);
+		}
+	}
+	if (n == 0) {
+		fprintf(stderr, "cfg2-gen: the sample has no keys\n");
+		ret = 0;
+	}
+	for (i = 0; ret && i < n; i++) {
+		for (j = 0; j < i; j++) {
+			if (!strcmp(names[i], names[j])) {
+				fprintf(stderr, "cfg2-gen: '%s' is used twice\n", names[i] + 5);
+				ret = 0;
+				break;
+			}
+		}
+	}
+	free(names);
+	return ret;
+}
+
+static void gen_struct(FILE *f, cfg_t *st, const char *name)
+{
+	static const char *types[] = { "cfg_int ", "cfg_double ", "cfg_char *" };
+	cfg_uint32 i, j;
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	char ident[GEN_NAME_SZ];
+
+	fputs("typedef struct {\n", f);
+	for (i = 0; i < cfg_total_sections(st); i++) {
+		if (!gen_section_is_first(st, i))
+			continue;
+		section = cfg_section_nth(st, i);
+		if (i) {
+			fputs("\tstruct { /* [", f);
+			gen_comment(f, cfg_section_name_get(st, section));
+			fputs("] */\n", f);
+		}
+		for (j = 0; j < cfg_total_entries(st, section); j++) {
+			if (!gen_entry_is_first(st, section, j))
+				continue;
+			entry = cfg_entry_nth(st, section, j);
+			gen_ident(cfg_entry_key_get(st, entry), ident);
+			fprintf(f, "%s\t%s%s;\n", i ? "\t" : "", types[gen_type_get(cfg_entry_value_get(st, entry))], ident);
+		}
+		if (i) {
+			gen_ident(cfg_section_name_get(st, section), ident);
+			fprintf(f, "\t} %s;\n", ident);
+		}
+	}
+	fprintf(f, "} %s_t;\n\n", name);
+}
+
+/* the code that stores 'value' (or a default) in a field */
+static void gen_store(FILE *f, cfg_t *st, cfg_section_t *section, cfg_entry_t *entry, const char *indent, const char *value)
+{
+	char field[GEN_NAME_SZ * 2 + 8];
+	const cfg_char *sample = cfg_entry_value_get(st, entry);
+
+	gen_field(st, section, entry, field);
+	switch (gen_type_get(sample)) {
+	case GEN_TYPE_INT:
+		if (value)
+			fprintf(f, "%s%s = cfg_value_to_int(%s);\n", indent, field, value);
+		else
+			fprintf(f, "%s%s = %ld;\n", indent, field, strtol(sample, NULL, 0));
+		break;
+	case GEN_TYPE_DOUBLE:
+		if (value)
+			fprintf(f, "%s%s = cfg_value_to_double(%s);\n", indent, field, value);
+		else
+			fprintf(f, "%s%s = %.17g;\n", indent, field, strtod(sample, NULL));
+		break;
+	case GEN_TYPE_STRING:
+		if (value) {
+			fprintf(f, "%sfree(%s);\n", indent, field);
+			fprintf(f, "%s%s = cfg_strdup(%s);\n", indent, field, value);
+		} else {
+			fprintf(f, "%sif (!%s)\n%s\t%s = cfg_strdup(", indent, field, indent, field);
+			gen_literal(f, sample ? sample : "");
+			fputs(");\n", f);
+		}
+		break;
+	}
+}
+
+static void gen_functions(FILE *f, cfg_t *st, const char *name)
+{
+	cfg_uint32 i, j, strings = 0;
+	cfg_section_t *section;
+	cfg_entry_t *entry;
+	char field[GEN_NAME_SZ * 2 + 8];
+
+	/* defaults; strings are only duplicated if missing after the scan */
+	fprintf(f, "/* set the numbers to the values of the sample and the strings to NULL */\n");
+	fprintf(f, "static void %s_init(%s_t *cfg)\n{\n", name, name);
+	for (i = 0; i < cfg_total_sections(st); i++) {
+		if (!gen_section_is_first(st, i))
+			continue;
+		section = cfg_section_nth(st, i);
+		for (j = 0; j < cfg_total_entries(st, section); j++) {
+			if (!gen_entry_is_first(st, section, j))
+				continue;
+			entry = cfg_entry_nth(st, section, j);
+			if (gen_type_get(cfg_entry_value_get(st, entry)) != GEN_TYPE_STRING) {
+				gen_store(f, st, section, entry, "\t", NULL);
+				continue;
+			}
+			gen_field(st, section, entry, field);
+			fprintf(f, "\t%s = NULL;\n", field);
+		}
+	}
+	fputs("}\n\n", f);
+
+	fprintf(f, "/* set the strings which are still NULL to the values of the sample */\n");
+	fprintf(f, "static void %s_strings_set(%s_t *cfg)\n{\n", name, name);
+	for (i = 0; i < cfg_total_sections(st); i++) {
+		if (!gen_section_is_first(st, i))
+			continue;
+		section = cfg_section_nth(st, i);
+		for (j = 0; j < cfg_total_entries(st, section); j++) {
+			entry = cfg_entry_nth(st, section, j);
+			if (gen_entry_is_first(st, section, j) && gen_type_get(cfg_entry_value_get(st, entry)) == GEN_TYPE_STRING) {
+				gen_store(f, st, section, entry, "\t", NULL);
+				strings++;
+			}
+		}
+	}
+	fputs(strings ? "}\n\n" : "\t(void)cfg;\n}\n\n", f);
+
+	/* free */
+	fprintf(f, "/* free the strings of a struct */\n");
+	fprintf(f, "static void %s_free(%s_t *cfg)\n{\n", name, name);
+	for (i = 0; i < cfg_total_sections(st); i++) {
+		if (!gen_section_is_first(st, i))
+			continue;
+		section = cfg_section_nth(st, i);
+		for (j = 0; j < cfg_total_entries(st, section); j++) {
+			entry = cfg_entry_nth(st, section, j);
+			if (!gen_entry_is_first(st, section, j) || gen_type_get(cfg_entry_value_get(st, entry)) != GEN_TYPE_STRING)
+				continue;
+			gen_field(st, section, entry, field);
+			fprintf(f, "\tfree(%s);\n\t%s = NULL;\n", field, field);
+		}
+	}
+	fputs(strings ? "}\n\n" : "\t(void)cfg;\n}\n\n", f);
+
+	/* scan callback */
+	fprintf(f, "static cfg_bool %s_scan(void *ctx, const cfg_char *section, cfg_uint32 section_hash,\n", name);
+	fprintf(f, "\tconst cfg_char *key, cfg_uint32 key_hash, const cfg_char *value)\n{\n");
+	fprintf(f, "\t%s_t *cfg = (%s_t *)ctx;\n\n", name, name);
+	fprintf(f, "\t(void)section, (void)key;\n");
+	fprintf(f, "\tswitch (section_hash) {\n");
+	for (i = 0; i < cfg_total_sections(st); i++) {
+		if (!gen_section_is_first(st, i))
+			continue;
+		section = cfg_section_nth(st, i);
+		if (!cfg_total_entries(st, section))
+			continue;
+		fprintf(f, "\tcase 0x%08lxu: /* ", (unsigned long)cfg_hash_get(cfg_section_name_get(st, section)));
+		if (i) {
+			fputc('[', f);
+			gen_comment(f, cfg_section_name_get(st, section));
+			fputs("] */\n", f);
+		} else {
+			fputs("root */\n", f);
+		}
+		fprintf(f, "\t\tswitch (key_hash) {\n");
+		for (j = 0; j < cfg_total_entries(st, section); j++) {
+			if (!gen_entry_is_first(st, section, j))
+				continue;
+			entry = cfg_entry_nth(st, section, j);
+			fprintf(f, "\t\tcase 0x%08lxu: /* ", (unsigned long)cfg_hash_get(cfg_entry_key_get(st, entry)));
+			gen_comment(f, cfg_entry_key_get(st, entry));
+			fputs(" */\n", f);
+			gen_store(f, st, section, entry, "\t\t\t", "value");
+			fprintf(f, "\t\t\tbreak;\n");
+		}
+		fprintf(f, "\t\t}\n\t\tbreak;\n");
+	}
+	fprintf(f, "\t}\n\treturn CFG_TRUE;\n}\n\n");
+
+	/* loader */
+	fprintf(f, "/* read a buffer into 'cfg', using the sample values for missing keys;\n * see cfg_buffer_scan(). free the strings with %s_free(). */\n", name);
+	fprintf(f, "static cfg_status_t %s_load(cfg_t *st, cfg_char *buf, cfg_uint32 sz, cfg_bool copy, %s_t *cfg)\n{\n", name, name);
+	fprintf(f, "\tcfg_status_t ret;\n\n");
+	fprintf(f, "\t%s_init(cfg);\n", name);
+	fprintf(f, "\tret = cfg_buffer_scan(st, buf, sz, copy, %s_scan, (void *)cfg);\n", name);
+	fprintf(f, "\t%s_strings_set(cfg);\n\treturn ret;\n}\n\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	char guard[GEN_NAME_SZ], *p;
+	cfg_status_t ret;
+	cfg_t *st;
+	FILE *f;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: cfg2-gen <sample.cfg> <name> [output.h]\n");
+		return 1;
+	}
+	st = cfg_alloc();
+	if (!st)
+		return 1;
+	ret = cfg_file_parse(st, argv[1]);
+	if (ret != CFG_STATUS_OK) {
+		fprintf(stderr, "cfg2-gen: cannot parse '%s' (%d)\n", argv[1], ret);
+		cfg_free(st);
+		return 1;
+	}
+	if (!gen_check_names(st)) {
+		cfg_free(st);
+		return 1;
+	}
+
+	f = argc > 3 ? fopen(argv[3], "w") : stdout;
+	if (!f) {
+		fprintf(stderr, "cfg2-gen: cannot open '%s'\n", argv[3]);
+		cfg_free(st);
+		return 1;
+	}
+	gen_ident(argv[2], guard);
+	for (p = guard; *p; p++)
+		*p = (char)toupper((unsigned char)*p);
+
+	fprintf(f, "/* generated by cfg2-gen from %s; do not edit */\n\n", argv[1]);
+	fprintf(f, "#ifndef %s_CFG_H\n#define %s_CFG_H\n\n", guard, guard);
+	fprintf(f, "#include <stdlib.h>\n#include \"cfg2.h\"\n\n");
+	gen_struct(f, st, argv[2]);
+	gen_functions(f, st, argv[2]);
+	fprintf(f, "#endif /* %s_CFG_H */\n", guard);
+
+	if (f != stdout)
+		fclose(f);
+	cfg_free(st);
+	return 0;
+}